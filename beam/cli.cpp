@@ -380,6 +380,13 @@ int main(int argc, char* argv[])
 					}
 
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
+					node.m_Cfg.m_TxPipeline.m_MaxInFlight = vm[cli::TX_PIPELINE_INFLIGHT].as<uint32_t>();
+					node.m_Cfg.m_DbReaders = vm[cli::DB_READERS].as<uint32_t>();
+					node.m_Cfg.m_SealOffloadThreshold = vm[cli::SEAL_OFFLOAD_THRESHOLD].as<uint32_t>();
+					node.m_Cfg.m_CompressThreshold = vm[cli::COMPRESS_THRESHOLD].as<uint32_t>();
+					node.m_Cfg.m_TxReconcile.m_Enabled = vm[cli::TX_RECONCILE].as<bool>();
+					node.m_Cfg.m_TxReconcile.m_FloodPeers = vm[cli::TX_RECONCILE_FLOOD_PEERS].as<uint32_t>();
+					node.m_Cfg.m_CompactBlocks.m_Enabled = vm[cli::COMPACT_BLOCKS].as<bool>();
 
 					node.m_Cfg.m_LogEvents = vm[cli::LOG_UTXOS].as<bool>();
 
@@ -475,6 +482,11 @@ int main(int argc, char* argv[])
 					if (vm.count(cli::ERASE_ID))
 						node.m_Cfg.m_ProcessorParams.m_EraseSelfID = vm[cli::ERASE_ID].as<bool>();
 
+					node.m_Cfg.m_ProcessorParams.m_MmrCache.m_Entries = vm[cli::MMR_CACHE].as<uint32_t>();
+					node.m_Cfg.m_ProcessorParams.m_MmrCache.m_hPinned = static_cast<uint8_t>(std::min<uint32_t>(vm[cli::MMR_CACHE_PINNED].as<uint32_t>(), Merkle::Position::HMax));
+					node.m_Cfg.m_ProcessorParams.m_ParallelContracts = vm[cli::CONTRACTS_PARALLEL].as<uint32_t>();
+					node.m_Cfg.m_ProcessorParams.m_BvmProfile = vm[cli::BVM_PROFILE].as<bool>();
+
 					if (!vm[cli::BBS_ENABLE].as<bool>())
 						ZeroObject(node.m_Cfg.m_Bbs.m_Limit);
 
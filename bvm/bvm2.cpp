@@ -160,6 +160,7 @@ namespace bvm2 {
 		ZeroObject(m_Code);
 		ZeroObject(m_Data);
 		ZeroObject(m_LinearMem);
+		m_DataShared = false;
 		m_Instruction.m_p0 = m_Instruction.m_p1 = nullptr;
 
 		m_vStack.resize((nStackBytes + sizeof(Wasm::Word) - 1) / sizeof(Wasm::Word), 0);
@@ -183,6 +184,97 @@ namespace bvm2 {
 		InitBase(Limits::StackSize + nStackBytes);
 	}
 
+	ProcessorContract::~ProcessorContract()
+	{
+		if (!m_pProfiler)
+			return;
+
+		// frames left after a failure
+		while (!m_FarCalls.m_Stack.empty())
+		{
+			auto& x = m_FarCalls.m_Stack.back();
+			ProfilerLeave(x);
+			m_FarCalls.m_Stack.Delete(x);
+		}
+
+		if (!m_ProfilerData.empty())
+			m_pProfiler->Merge(m_ProfilerData);
+	}
+
+	void ProcessorContract::ProfilerEnter(FarCalls::Frame& x)
+	{
+		x.m_Prof0 = m_ProfTotal;
+		x.m_Prof0.m_Charge = m_Charge;
+		x.m_Prof0.m_Time_us = GetTime_us();
+	}
+
+	void ProcessorContract::ProfilerLeave(const FarCalls::Frame& x)
+	{
+		Profiler::Key key;
+		key.m_Cid = x.m_CidCode;
+		key.m_iMethod = x.m_iMethod;
+
+		auto& s = m_ProfilerData[key];
+		s.m_Calls++;
+		s.m_Instructions += m_ProfTotal.m_Instructions - x.m_Prof0.m_Instructions;
+		s.m_Reads += m_ProfTotal.m_Reads - x.m_Prof0.m_Reads;
+		s.m_Writes += m_ProfTotal.m_Writes - x.m_Prof0.m_Writes;
+		if (x.m_Prof0.m_Charge > m_Charge)
+			s.m_Charge += x.m_Prof0.m_Charge - m_Charge;
+		s.m_Time_us += GetTime_us() - x.m_Prof0.m_Time_us;
+		std::setmax(s.m_DepthMax, static_cast<uint32_t>(m_FarCalls.m_Stack.size()));
+	}
+
+	void Profiler::Stats::operator += (const Stats& x)
+	{
+		m_Calls += x.m_Calls;
+		m_Instructions += x.m_Instructions;
+		m_Charge += x.m_Charge;
+		m_Reads += x.m_Reads;
+		m_Writes += x.m_Writes;
+		m_Time_us += x.m_Time_us;
+		std::setmax(m_DepthMax, x.m_DepthMax);
+	}
+
+	void Profiler::Merge(const Map& m)
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		for (const auto& x : m)
+			m_Map[x.first] += x.second;
+	}
+
+	void Profiler::get_Data(Map& m) const
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		m = m_Map;
+	}
+
+	void Profiler::Reset()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		m_Map.clear();
+	}
+
+	void Profiler::Dump(std::ostream& os) const
+	{
+		Map m;
+		get_Data(m);
+
+		for (const auto& x : m)
+		{
+			const Stats& s = x.second;
+			os << x.first.m_Cid << " method=" << x.first.m_iMethod
+				<< " calls=" << s.m_Calls
+				<< " insns=" << s.m_Instructions
+				<< " charge=" << s.m_Charge
+				<< " reads=" << s.m_Reads
+				<< " writes=" << s.m_Writes
+				<< " depth=" << s.m_DepthMax
+				<< " time_us=" << s.m_Time_us
+				<< std::endl;
+		}
+	}
+
 	void ProcessorManager::InitMem()
 	{
 		InitBase(0x20000); // 128K
@@ -191,26 +283,58 @@ namespace bvm2 {
 		m_NeedComma = false;
 	}
 
-	const Processor::Header& Processor::ParseMod()
+	void Processor::ModLayout::Parse(const Blob& code)
 	{
-		Wasm::Test(m_Code.n >= sizeof(Header));
-		const Header& hdr = *reinterpret_cast<const Header*>(m_Code.p);
+		Wasm::Test(code.n >= sizeof(Header));
+		const Header& hdr = *reinterpret_cast<const Header*>(code.p);
 
 		Wasm::Test(ByteOrder::from_le(hdr.m_Version) == hdr.s_Version);
-		uint32_t nMethods = ByteOrder::from_le(hdr.m_NumMethods);
-		Wasm::Test((nMethods - Header::s_MethodsMin <= Header::s_MethodsMax - Header::s_MethodsMin));
+		m_NumMethods = ByteOrder::from_le(hdr.m_NumMethods);
+		Wasm::Test((m_NumMethods - Header::s_MethodsMin <= Header::s_MethodsMax - Header::s_MethodsMin));
 
-		uint32_t nHdrSize = sizeof(Header) + sizeof(Wasm::Word) * (nMethods - Header::s_MethodsMin);
-		Wasm::Test(nHdrSize <= m_Code.n);
+		m_nHdrSize = sizeof(Header) + sizeof(Wasm::Word) * (m_NumMethods - Header::s_MethodsMin);
+		Wasm::Test(m_nHdrSize <= code.n);
 
-		m_Data.n = m_Code.n - nHdrSize;
-		m_Data.p = reinterpret_cast<const uint8_t*>(m_Code.p) + nHdrSize;
 		m_prData0 = ByteOrder::from_le(hdr.m_hdrData0);
 
 		m_prTable0 = ByteOrder::from_le(hdr.m_hdrTable0);
-		Wasm::Test(m_prTable0 <= m_Code.n);
+		Wasm::Test(m_prTable0 <= code.n);
+	}
+
+	const Processor::Header& Processor::SetMod(const Blob& code, const ModLayout& lt)
+	{
+		m_Code = code;
+		m_Data.n = m_Code.n - lt.m_nHdrSize;
+		m_Data.p = reinterpret_cast<const uint8_t*>(m_Code.p) + lt.m_nHdrSize;
+		m_prData0 = lt.m_prData0;
+		m_prTable0 = lt.m_prTable0;
+
+		return *reinterpret_cast<const Header*>(m_Code.p);
+	}
 
-		return hdr;
+	const Processor::Header& Processor::ParseMod()
+	{
+		ModLayout lt;
+		lt.Parse(m_Code);
+		return SetMod(m_Code, lt);
+	}
+
+	Processor::Module::Ptr Processor::Module::Create(const Blob& code)
+	{
+		auto pMod = std::make_shared<Module>();
+		pMod->Parse(code);
+		code.Export(pMod->m_Body);
+
+		// the compiled functions are between the header and the indirect calls table
+		pMod->m_Threaded.Build(pMod->m_Body, pMod->m_nHdrSize, pMod->m_prTable0);
+		return pMod;
+	}
+
+	Processor::Module::Ptr ProcessorContract::LoadModule(const ContractID& cid)
+	{
+		Blob code;
+		LoadVar(cid, code);
+		return Module::Create(code);
 	}
 
 	void ProcessorContract::CallFar(const ContractID& cid, uint32_t iMethod, Wasm::Word pArgs, uint8_t bInheritContext)
@@ -243,6 +367,9 @@ namespace bvm2 {
 		auto& x = *m_FarCalls.m_Stack.Create_back();
 		x.m_Local.m_Missing = 0;
 		x.m_Cid = cid;
+		x.m_CidCode = cid;
+		x.m_iMethod = iMethod;
+		x.m_Resumed = false;
 		x.m_FarRetAddr = nRetAddr;
 		x.m_StackBytesMax = m_Stack.m_BytesMax;
 		x.m_StackBytesRet = m_Stack.m_BytesCurrent;
@@ -250,11 +377,14 @@ namespace bvm2 {
 		x.m_StackPosMin = m_Stack.m_PosMin;
 		m_Stack.m_PosMin = m_Stack.m_Pos;
 
-		LoadVar(cid, m_Code);
-		m_Code.Export(x.m_Body);
+		if (m_pProfiler)
+			ProfilerEnter(x);
 
-		const Header& hdr = ParseMod();
-		Wasm::Test(iMethod < ByteOrder::from_le(hdr.m_NumMethods));
+		x.m_pMod = LoadModule(cid);
+
+		const Header& hdr = SetMod(*x.m_pMod);
+		m_DataShared = true;
+		Wasm::Test(iMethod < x.m_pMod->m_NumMethods);
 
 		if (bInheritContext)
 			x.m_Cid = pPrev->m_Cid;
@@ -295,17 +425,82 @@ namespace bvm2 {
 		m_Stack.m_PosMin = x.m_StackPosMin;
 		m_Stack.m_BytesMax = x.m_StackBytesMax;
 
+		if (m_pProfiler)
+			ProfilerLeave(x);
+
 		m_FarCalls.m_Stack.Delete(x);
 
-		if (!m_FarCalls.m_Stack.empty())
+		if (m_FarCalls.m_Stack.empty())
+			m_DataShared = false;
+		else
 		{
-			m_Code = m_FarCalls.m_Stack.back().m_Body;
-			ParseMod(); // restore code/data sections
+			// restore code/data sections
+			auto& xPrev = m_FarCalls.m_Stack.back();
+			xPrev.m_Resumed = true;
+
+			m_DataShared = xPrev.m_Body.empty();
+			if (m_DataShared)
+				SetMod(*xPrev.m_pMod);
+			else
+				SetMod(xPrev.m_Body, *xPrev.m_pMod);
 
 			Processor::OnRet(nRetAddr);
 		}
 	}
 
+	void ProcessorContract::OnDataWrite()
+	{
+		// The module is shared, but the data section is writable (that's how the global variables work). Keep the historical semantics:
+		// before the 1st return from a nested far call the contract code variable itself is modified, afterwards - the frame's own copy of the code.
+		Wasm::Test(!m_FarCalls.m_Stack.empty());
+		auto& x = m_FarCalls.m_Stack.back();
+		const Module& mod = *x.m_pMod;
+
+		m_DataShared = false;
+		Wasm::Word nIp = get_Ip();
+
+		Blob code;
+		if (!x.m_Resumed)
+		{
+			LoadVar(x.m_CidCode, code);
+			// if the code was replaced meanwhile - it's not what's being executed
+		}
+
+		if (Blob(mod.m_Body) != code)
+		{
+			Blob(mod.m_Body).Export(x.m_Body);
+			code = x.m_Body;
+		}
+
+		SetMod(code, mod);
+
+		// continue in the same place of the new copy
+		m_Instruction.m_p0 = reinterpret_cast<const uint8_t*>(m_Code.p) + nIp;
+		m_Instruction.m_p1 = reinterpret_cast<const uint8_t*>(m_Code.p) + m_Code.n;
+	}
+
+	uint32_t ProcessorContract::RunBatch()
+	{
+#ifndef WASM_INTERPRETER_DEBUG // the debug output is per-instruction
+		if (m_ThreadedDispatch && m_DataShared)
+		{
+			// the frame runs the module code as-is. Keep it alive, the frame may be gone on return
+			Module::Ptr pMod = m_FarCalls.m_Stack.back().m_pMod;
+			uint32_t nDone = RunThreaded(pMod->m_Threaded, m_Charge, Limits::Cost::Cycle);
+			if (nDone)
+			{
+				m_ProfTotal.m_Instructions += nDone;
+				return nDone;
+			}
+		}
+#endif // WASM_INTERPRETER_DEBUG
+
+		DischargeUnits(Limits::Cost::Cycle);
+		RunOnce();
+		m_ProfTotal.m_Instructions++;
+		return 1;
+	}
+
 	void ProcessorContract::OnCall(Wasm::Word nAddr)
 	{
 		if (m_FarCalls.m_SaveLocal)
@@ -335,7 +530,10 @@ namespace bvm2 {
 			const auto& fr = *itF;
 
 			bvm2::ShaderID sid;
-			bvm2::get_ShaderID(sid, fr.m_Body); // theoretically m_Body may be different, the contract code may modify itself. Never mind.
+			if (fr.m_pMod)
+				bvm2::get_ShaderID(sid, fr.m_pMod->m_Body);
+			else
+				sid = Zero;
 
 			os << std::endl << "Cid=" << fr.m_Cid << ", Sid=" << sid;
 
@@ -1231,6 +1429,7 @@ namespace bvm2 {
 
 		Blob res;
 		LoadVar(vk.ToBlob(), res);
+		m_ProfTotal.m_Reads++;
 
 		memcpy(pVal, res.p, std::min(nVal, res.n));
 		return res.n;
@@ -1266,6 +1465,7 @@ namespace bvm2 {
 		LoadVarEx(key, res,
 			!!(Shaders::KeySearchFlags::Exact & nSearchFlag),
 			!!(Shaders::KeySearchFlags::Bigger & nSearchFlag));
+		m_ProfTotal.m_Reads++;
 
 		if (key.n > ContractID::nBytes)
 		{
@@ -1300,7 +1500,7 @@ namespace bvm2 {
 		VarKey vk;
 		SetVarKeyFromShader(vk, nType, Blob(pKey, nKey), true);
 
-		return SaveVar(vk.ToBlob(), Blob(pVal, nVal));
+		return WriteVar(vk.ToBlob(), Blob(pVal, nVal));
 	}
 
 	BVM_METHOD(EmitLog)
@@ -1496,7 +1696,7 @@ namespace bvm2 {
 			ProcessorPlus_Contract::From(*this).HandleAmountOuter(Rules::get().CA.DepositForList, Zero, true);
 
 			SetAssetKey(av, ret);
-			SaveVar(av.m_vk.ToBlob(), av.m_Owner);
+			WriteVar(av.m_vk.ToBlob(), av.m_Owner);
 		}
 
 		return ret;
@@ -1554,7 +1754,7 @@ namespace bvm2 {
 		if (b)
 		{
 			HandleAmountOuter(Rules::get().CA.DepositForList, Zero, false);
-			SaveVar(av.m_vk.ToBlob(), Blob(nullptr, 0));
+			WriteVar(av.m_vk.ToBlob(), Blob(nullptr, 0));
 		}
 
 		return !!b;
@@ -3240,7 +3440,13 @@ namespace bvm2 {
 
 	uint32_t ProcessorContract::SaveNnz(const VarKey& vk, const uint8_t* pVal, uint32_t n)
 	{
-		return SaveVar(vk.ToBlob(), Blob(pVal, memis0(pVal, n) ? 0 : n));
+		return WriteVar(vk.ToBlob(), Blob(pVal, memis0(pVal, n) ? 0 : n));
+	}
+
+	uint32_t ProcessorContract::WriteVar(const Blob& key, const Blob& val)
+	{
+		m_ProfTotal.m_Writes++;
+		return SaveVar(key, val);
 	}
 
 	void ProcessorContract::HandleAmount(Amount amount, Asset::ID aid, bool bLock)
@@ -3408,7 +3614,7 @@ namespace bvm2 {
 
 		if (pCode)
 		{
-			SaveVar(cid, *pCode);
+			WriteVar(cid, *pCode);
 			get_ShaderID(sid, *pCode);
 		}
 		else
@@ -3417,7 +3623,7 @@ namespace bvm2 {
 			LoadVar(cid, res);
 
 			get_ShaderID(sid, res);
-			SaveVar(cid, Blob(nullptr, 0));
+			WriteVar(cid, Blob(nullptr, 0));
 		}
 
 		ToggleSidEntry(sid, cid, !!pCode);
@@ -3445,10 +3651,10 @@ namespace bvm2 {
 		if (bSet)
 		{
 			auto h = uintBigFrom(get_Height() + 1);
-			SaveVar(blob, h);
+			WriteVar(blob, h);
 		}
 		else
-			SaveVar(blob, Blob(nullptr, 0));
+			WriteVar(blob, Blob(nullptr, 0));
 	}
 
 	/////////////////////////////////////////////
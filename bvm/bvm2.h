@@ -104,11 +104,83 @@ namespace bvm2 {
 
 	void get_AssetOwner(PeerID&, const ContractID&, const Asset::Metadata&);
 
+	class Profiler
+	{
+		// Contract execution stats, per (contract, method). Collected by the contract processors that have it assigned.
+		// Instructions, charge, var access and time include the nested far calls.
+	public:
+
+		struct Key
+		{
+			ContractID m_Cid;
+			uint32_t m_iMethod;
+
+			bool operator < (const Key& x) const {
+				int n = m_Cid.cmp(x.m_Cid);
+				return n ? (n < 0) : (m_iMethod < x.m_iMethod);
+			}
+		};
+
+		struct Stats
+		{
+			uint64_t m_Calls = 0;
+			uint64_t m_Instructions = 0;
+			uint64_t m_Charge = 0;
+			uint64_t m_Reads = 0;
+			uint64_t m_Writes = 0;
+			uint64_t m_Time_us = 0;
+			uint32_t m_DepthMax = 0; // 1 = invoked directly by the kernel
+
+			void operator += (const Stats&);
+		};
+
+		typedef std::map<Key, Stats> Map;
+
+		std::atomic<bool> m_Enabled = false;
+
+		void Merge(const Map&);
+		void get_Data(Map&) const;
+		void Reset();
+		void Dump(std::ostream&) const;
+
+	private:
+		mutable std::mutex m_Mutex;
+		Map m_Map;
+	};
+
 	class ProcessorContract;
 
 	class Processor
 		:public Wasm::Processor
 	{
+	public:
+
+		struct ModLayout
+		{
+			uint32_t m_NumMethods;
+			uint32_t m_nHdrSize;
+			Wasm::Word m_prData0;
+			Wasm::Word m_prTable0;
+
+			void Parse(const Blob& code); // throws if malformed
+		};
+
+		// Contract code with its parsed layout. Shared (immutable) between the callstack frames and the module caches
+		struct Module
+			:public ModLayout
+		{
+			typedef std::shared_ptr<const Module> Ptr;
+
+			ByteBuffer m_Body;
+			Wasm::ThreadedCode m_Threaded;
+
+			static Ptr Create(const Blob& code);
+
+			size_t get_Size() const {
+				return m_Body.size() + m_Threaded.get_Size();
+			}
+		};
+
 	protected:
 
 		std::vector<Wasm::Word> m_vStack;
@@ -211,6 +283,9 @@ namespace bvm2 {
 		struct Header;
 		const Header& ParseMod();
 
+		const Header& SetMod(const Blob& code, const ModLayout&);
+		const Header& SetMod(const Module& mod) { return SetMod(mod.m_Body, mod); }
+
 		const char* RealizeStr(Wasm::Word, uint32_t& nLenOut);
 		const char* RealizeStr(Wasm::Word);
 
@@ -327,7 +402,11 @@ namespace bvm2 {
 				:public boost::intrusive::list_base_hook<>
 			{
 				ContractID m_Cid;
-				ByteBuffer m_Body;
+				ContractID m_CidCode; // differs from m_Cid if the context is inherited
+				Module::Ptr m_pMod;
+				ByteBuffer m_Body; // own copy of the code, once its data section is modified after the return from a nested far call
+				bool m_Resumed;
+				uint32_t m_iMethod;
 				Wasm::Word m_FarRetAddr;
 				Wasm::Word m_StackPosMin;
 				Wasm::Word m_StackBytesMax;
@@ -346,6 +425,8 @@ namespace bvm2 {
 					uint32_t m_Missing;
 
 				} m_Local;
+
+				Profiler::Stats m_Prof0; // counters at the frame start, if profiling
 			};
 
 			intrusive::list_autoclear<Frame> m_Stack;
@@ -358,6 +439,7 @@ namespace bvm2 {
 
 		bool LoadFixedOrZero(const VarKey&, uint8_t* pVal, uint32_t);
 		uint32_t SaveNnz(const VarKey&, const uint8_t* pVal, uint32_t);
+		uint32_t WriteVar(const Blob&, const Blob& val); // SaveVar, accounted in the profiler stats
 
 		template <uint32_t nBytes>
 		bool Load_T(const VarKey& vk, uintBig_t<nBytes>& x) {
@@ -416,9 +498,16 @@ namespace bvm2 {
 		void ToggleSidEntry(const ShaderID& sid, const ContractID& cid, bool bSet);
 
 		void OnRetFar();
+		void OnDataWrite() override;
+
+		Profiler::Stats m_ProfTotal; // running counters
+		void ProfilerEnter(FarCalls::Frame&);
+		void ProfilerLeave(const FarCalls::Frame&);
 
 	public:
 
+		~ProcessorContract();
+
 		Kind get_Kind() override { return Kind::Contract; }
 
 		void InitStackPlus(uint32_t nStackBytesExtra);
@@ -437,7 +526,14 @@ namespace bvm2 {
 
 		uint32_t m_Charge = Limits::BlockCharge;
 
+		bool m_ThreadedDispatch = true; // run the pre-decoded module code where possible. Same results and charge as the plain interpreter
+		uint32_t RunBatch(); // runs at least 1 instruction, stops once the callstack may change. Returns the num of executed instructions
+
 		virtual void CallFar(const ContractID&, uint32_t iMethod, Wasm::Word pArgs, uint8_t bInheritContext); // can override to invoke host code instead of interpretator (for debugging)
+		virtual Module::Ptr LoadModule(const ContractID&); // loads and parses the contract code. Can override to use a cache
+
+		Profiler* m_pProfiler = nullptr; // assign to collect the execution stats
+		Profiler::Map m_ProfilerData; // collected so far, merged into m_pProfiler on destruction
 	};
 
 
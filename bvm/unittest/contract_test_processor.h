@@ -334,12 +334,11 @@ namespace beam::bvm2
 			CallFar(cid, iMethod, nSp, bInheritContext);
 
 			bool bWasm = false;
-			for (; m_FarCalls.m_Stack.size() > nFrames; m_Cycles++)
+			while (m_FarCalls.m_Stack.size() > nFrames)
 			{
 				bWasm = true;
 
-				DischargeUnits(Limits::Cost::Cycle);
-				RunOnce();
+				m_Cycles += RunBatch();
 
 #ifdef WASM_INTERPRETER_DEBUG
 				if (m_Dbg.m_pOut)
@@ -366,29 +365,120 @@ namespace beam::bvm2
 			m_Stack.AliasFree(nArgs);
 		}
 
-		void RunMany(const ContractID& cid, uint32_t iMethod, const Blob& args)
+		void RunRaw(const ContractID& cid, uint32_t iMethod, const Blob& args, uint32_t nCharge)
 		{
-			std::ostringstream os;
-			//m_Dbg.m_pOut = &os;
-
-			os << "BVM Method: " << cid << ":" << iMethod << std::endl;
-
 			InitStackPlus(0);
 
 			HeapReserveStrict(get_HeapLimit()); // this is necessary as long as we run shaders natively (not via wasm). Heap mem should not be reallocated
 
-			m_Charge = Limits::BlockCharge; // default
-			uint32_t nUnitsMax = m_Charge;
+			m_Charge = nCharge;
 
 			Shaders::Env::g_pEnv = this;
 			m_Cycles = 0;
 
 			CallFarN(cid, iMethod, Cast::NotConst(args.p), args.n, 0);
+		}
+
+		void RunMany(const ContractID& cid, uint32_t iMethod, const Blob& args)
+		{
+			std::ostringstream os;
+			//m_Dbg.m_pOut = &os;
+
+			os << "BVM Method: " << cid << ":" << iMethod << std::endl;
+
+			uint32_t nUnitsMax = Limits::BlockCharge; // default
+			RunRaw(cid, iMethod, args, nUnitsMax);
 
 			os << "Done in " << m_Cycles << " cycles, Discharge=" << (nUnitsMax - m_Charge) << std::endl << std::endl;
 			std::cout << os.str();
 		}
 
+		bool m_VerifyDispatch = false; // before each call run it with both the plain and threaded interpreter, and compare
+
+		struct DispatchResult
+		{
+			bool m_Ok;
+			std::string m_sErr;
+			uint32_t m_Charge;
+			uint32_t m_Cycles; // not counted for the batch that failed
+			ECC::Hash::Value m_hvState;
+
+			bool operator == (const DispatchResult& x) const {
+				return (m_Ok == x.m_Ok) && (m_sErr == x.m_sErr) && (m_Charge == x.m_Charge) && (!m_Ok || (m_Cycles == x.m_Cycles)) && (m_hvState == x.m_hvState);
+			}
+		};
+
+		void RunDispatch(DispatchResult& res, bool bThreaded, uint32_t nCharge, const ContractID& cid, uint32_t iMethod, const Blob& args)
+		{
+			ByteBuffer bufArgs;
+			args.Export(bufArgs);
+
+			size_t nChanges = m_lstUndo.size();
+			size_t nFrames = m_FarCalls.m_Stack.size();
+			m_ThreadedDispatch = bThreaded;
+
+			// the code may read the stack below its pointer, start from the same state
+			std::fill(m_vStack.begin(), m_vStack.end(), 0);
+
+			res.m_Ok = true;
+			try {
+				RunRaw(cid, iMethod, args, nCharge);
+			}
+			catch (const std::exception& e)
+			{
+				std::ostringstream os;
+				os << e.what();
+				DumpCallstack(os);
+
+				res.m_Ok = false;
+				res.m_sErr = os.str();
+
+				while (m_FarCalls.m_Stack.size() > nFrames)
+					m_FarCalls.m_Stack.Delete(m_FarCalls.m_Stack.back());
+			}
+
+			res.m_Charge = m_Charge;
+			res.m_Cycles = m_Cycles;
+
+			ECC::Hash::Processor hp;
+			for (const auto& x : m_Vars)
+			{
+				Blob key = x.ToBlob();
+				hp << key.n;
+				hp.Write(key.p, key.n);
+				hp << static_cast<uint32_t>(x.m_Data.size());
+				hp.Write(x.m_Data.data(), static_cast<uint32_t>(x.m_Data.size()));
+			}
+			hp.Write(m_vStack.data(), static_cast<uint32_t>(sizeof(Wasm::Word) * m_vStack.size()));
+			hp.Write(m_vHeap.data(), static_cast<uint32_t>(m_vHeap.size()));
+			hp.Write(bufArgs.data(), static_cast<uint32_t>(bufArgs.size()));
+			hp.Write(args.p, args.n);
+			hp >> res.m_hvState;
+
+			UndoChanges(nChanges);
+			if (args.n)
+				memcpy(Cast::NotConst(args.p), bufArgs.data(), args.n);
+
+			m_ThreadedDispatch = true;
+		}
+
+		void VerifyDispatch(const ContractID& cid, uint32_t iMethod, const Blob& args)
+		{
+			DispatchResult r0, r1;
+			RunDispatch(r0, false, Limits::BlockCharge, cid, iMethod, args);
+			RunDispatch(r1, true, Limits::BlockCharge, cid, iMethod, args);
+			verify_test(r0 == r1);
+
+			// run out of charge in different places
+			uint32_t nUsed = Limits::BlockCharge - r0.m_Charge;
+			for (uint32_t nCharge : { nUsed / 2, nUsed / 3 + 1, nUsed - 1 })
+			{
+				RunDispatch(r0, false, nCharge, cid, iMethod, args);
+				RunDispatch(r1, true, nCharge, cid, iMethod, args);
+				verify_test(r0 == r1);
+			}
+		}
+
 		bool RunGuarded(const ContractID& cid, uint32_t iMethod, const Blob& args, const Blob* pCode)
 		{
 			bool ret = true;
@@ -404,6 +494,9 @@ namespace beam::bvm2
 
 			try
 			{
+				if (m_VerifyDispatch)
+					VerifyDispatch(cid, iMethod, args);
+
 				RunMany(cid, iMethod, args);
 
 				if (1 == iMethod) // d'tor
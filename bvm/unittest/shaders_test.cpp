@@ -1522,7 +1522,7 @@ namespace bvm2 {
 			args.m_Settings.m_TroveLiquidationReserve = Rules::Coin * 5;
 			args.m_Settings.m_AidProfit = 77;
 
-			m_FarCalls.m_Stack.Create_back()->m_Body = m_Dummy.m_Code; // add dummy frame, any valid shader is ok
+			m_FarCalls.m_Stack.Create_back()->m_pMod = Module::Create(m_Dummy.m_Code); // add dummy frame, any valid shader is ok
 
 			verify_test(ContractCreate_T(m_Liquity.m_Cid, m_Liquity.m_Code, args));
 
@@ -3125,13 +3125,13 @@ namespace bvm2 {
 			};
 #pragma pack (pop)
 
-			pFr->m_Body.resize(sizeof(Hdr0));
-			Hdr0& hdr = *(Hdr0*) &pFr->m_Body.front();
-
+			Hdr0 hdr;
 			ZeroObject(hdr);
 			hdr.m_Version = ByteOrder::to_le(2u);
 			hdr.m_NumMethods = ByteOrder::to_le(2u);
 
+			pFr->m_pMod = Module::Create(Blob(&hdr, sizeof(hdr)));
+
 			verify_test(ContractCreate_T(m_DaoVote.m_Cid, m_DaoVote.m_Code, args));
 
 			m_FarCalls.m_Stack.Clear();
@@ -3763,6 +3763,7 @@ int main()
 			*/
 		}
 
+		proc.m_VerifyDispatch = true;
 		proc.TestAll();
 
 		MyManager man(proc);
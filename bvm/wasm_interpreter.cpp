@@ -1565,15 +1565,31 @@ namespace Wasm {
 		BINOP(rotr) { Test(b < (sizeof(a) * 8)); if (!b) return a; return (a >> b) | (a << ((sizeof(a) * 8) - b)); }
 
 
+		static Word ReadAddr(Reader& inp)
+		{
+			return from_wasm<Word>(inp.Consume(sizeof(Word)));
+		}
+
 		Word ReadAddr()
 		{
-			return from_wasm<Word>(m_Instruction.Consume(sizeof(Word)));
+			return ReadAddr(m_Instruction);
+		}
+
+		static Word ReadMemArg(Reader& inp)
+		{
+			auto nAlign = inp.Read<Word>();
+			Stack::TestAlignmentPower(nAlign);
+
+			return inp.Read<Word>(); // offset
 		}
 
 		void OnLocal(bool bSet, bool bGet)
 		{
-			uint32_t nOffset = m_Instruction.Read<uint32_t>();
+			DoLocal(m_Instruction.Read<uint32_t>(), bSet, bGet);
+		}
 
+		void DoLocal(uint32_t nOffset, bool bSet, bool bGet)
+		{
 			uint8_t nType = Type::s_Base + static_cast<uint8_t>((sizeof(Word) - 1) & (nOffset - Type::s_Base));
 			uint8_t nWords = Type::Words(nType);
 
@@ -1613,33 +1629,40 @@ namespace Wasm {
 			OnGlobalVar(iVar, bGet);
 		}
 
-		uint8_t* MemArgEx(uint32_t nSize, bool bW)
+		template <uint8_t nType, typename TMem>
+		void DoLoad(Word nOffs)
 		{
-			auto nAlign = m_Instruction.Read<Word>();
-			Stack::TestAlignmentPower(nAlign);
-
-			auto nOffs = m_Instruction.Read<Word>();
 			nOffs += m_Stack.Pop<Word>();
-
-			return get_AddrEx(nOffs, nSize, bW);
+			TMem val1 = from_wasm<typename Type::ToFlexible<TMem, false>::T>(get_AddrR(nOffs, sizeof(TMem)));
+			auto valExt = Type::Extend<typename Type::Code2Type<nType>::T, TMem>(val1);
+			m_Stack.Push(valExt);
 		}
 
-		uint8_t* MemArgW(uint32_t nSize) {
-			return MemArgEx(nSize, true);
+		template <typename TMem, typename T>
+		void DoStore(Word nOffs, T val)
+		{
+			nOffs += m_Stack.Pop<Word>();
+			to_wasm(get_AddrW(nOffs, sizeof(TMem)), static_cast<TMem>(val));
 		}
 
-		const uint8_t* MemArgR(uint32_t nSize) {
-			return MemArgEx(nSize, false);
-		}
+		void DoDrop(uint8_t nType);
+		void DoSelect(uint8_t nType);
+		void DoBrIf(Word nAddr);
+		void DoCall(Word nAddr);
+		void DoCallExt(uint32_t iExt);
+		void DoProlog(uint32_t nWords);
+		void DoRet(uint32_t nRets, uint32_t nLocals, uint32_t nArgs);
+
+		struct RunCheckpoint :public Checkpoint {
+			Word m_Ip;
+			virtual void Dump(std::ostream& os) override {
+				os << "wasm/Run, Ip=" << uintBigFrom(m_Ip);
+			}
+		};
 
 		void RunOncePlus()
 		{
-			struct MyCheckpoint :public Checkpoint {
-				Word m_Ip;
-				virtual void Dump(std::ostream& os) override {
-					os << "wasm/Run, Ip=" << uintBigFrom(m_Ip);
-				}
-			} cp;
+			RunCheckpoint cp;
 			cp.m_Ip = get_Ip();
 
 			typedef Instruction I;
@@ -1680,11 +1703,7 @@ namespace Wasm {
 
 
 #define THE_MACRO(id, type, name, tmem) \
-			THE_CASE(type##_##name) { \
-				tmem val1 = from_wasm<Type::ToFlexible<tmem, false>::T>(MemArgR(sizeof(tmem))); \
-				auto valExt = Type::Extend<Type::Code2Type<Type::type>::T, tmem>(val1); \
-				m_Stack.Push(valExt); \
-			} break;
+			THE_CASE(type##_##name) DoLoad<Type::type, tmem>(ReadMemArg(m_Instruction)); break;
 
 			WasmInstructions_Load(THE_MACRO)
 #undef THE_MACRO
@@ -1692,7 +1711,7 @@ namespace Wasm {
 #define THE_MACRO(id, type, name, tmem) \
 			THE_CASE(type##_##name) { \
 				auto val = m_Stack.Pop<Type::Code2Type<Type::type>::T>(); \
-				to_wasm(MemArgW(sizeof(tmem)), static_cast<tmem>(val)); \
+				DoStore<tmem>(ReadMemArg(m_Instruction), val); \
 			} break;
 
 			WasmInstructions_Store(THE_MACRO)
@@ -1703,6 +1722,342 @@ namespace Wasm {
 			}
 
 		}
+
+		/////////////////////////////////////////////
+		// Threaded code. Handlers execute the same routines as the interpreter, with the operands decoded in advance
+
+		typedef ThreadedCode::Op Op;
+
+		static ProcessorPlus& From(Processor& p) {
+			return Cast::Up<ProcessorPlus>(p);
+		}
+
+		template <void (ProcessorPlus::*TFunc)()>
+		static void Th_Simple(Processor& p, const Op&, Word&) {
+			(From(p).*TFunc)();
+		}
+
+		template <bool bSet, bool bGet>
+		static void Th_Local(Processor& p, const Op& op, Word&) {
+			From(p).DoLocal(op.m_pArg[0], bSet, bGet);
+		}
+
+		template <bool bGet>
+		static void Th_GlobalImp(Processor& p, const Op& op, Word&) {
+			p.OnGlobalVar(op.m_pArg[0], bGet);
+		}
+
+		static void Th_drop(Processor& p, const Op& op, Word&) {
+			From(p).DoDrop(static_cast<uint8_t>(op.m_pArg[0]));
+		}
+
+		static void Th_select(Processor& p, const Op& op, Word&) {
+			From(p).DoSelect(static_cast<uint8_t>(op.m_pArg[0]));
+		}
+
+		static void Th_br(Processor& p, const Op& op, Word&) {
+			p.Jmp(op.m_pArg[0]);
+		}
+
+		static void Th_br_if(Processor& p, const Op& op, Word&) {
+			From(p).DoBrIf(op.m_pArg[0]);
+		}
+
+		static void Th_br_table(Processor& p, const Op& op, Word&)
+		{
+			Word nOperand = p.m_Stack.Pop<Word>();
+			std::setmin(nOperand, op.m_pArg[0]); // fallback to 'def' if out-of-range
+
+			const uint8_t* pAddrs = reinterpret_cast<const uint8_t*>(p.m_Code.p) + op.m_pArg[1];
+			p.Jmp(from_wasm<Word>(pAddrs + sizeof(Word) * nOperand));
+		}
+
+		static void Th_call(Processor& p, const Op& op, Word&) {
+			From(p).DoCall(op.m_pArg[0]);
+		}
+
+		static void Th_call_ext(Processor& p, const Op& op, Word&) {
+			From(p).DoCallExt(op.m_pArg[0]);
+		}
+
+		static void Th_i32_const(Processor& p, const Op& op, Word&) {
+			p.m_Stack.Push<uint32_t>(op.m_pArg[0]);
+		}
+
+		static void Th_i64_const(Processor& p, const Op& op, Word&) {
+			p.m_Stack.Push<uint64_t>(op.m_Imm);
+		}
+
+		static void Th_prolog(Processor& p, const Op& op, Word&) {
+			From(p).DoProlog(op.m_pArg[0]);
+		}
+
+		static void Th_ret(Processor& p, const Op& op, Word&) {
+			From(p).DoRet(op.m_pArg[0], op.m_pArg[1], op.m_pArg[2]);
+		}
+
+		template <uint8_t nType, typename TMem>
+		static void Th_Load(Processor& p, const Op& op, Word&) {
+			From(p).DoLoad<nType, TMem>(op.m_pArg[0]);
+		}
+
+		template <uint8_t nType, typename TMem>
+		static void Th_Store(Processor& p, const Op& op, Word&)
+		{
+			auto val = p.m_Stack.Pop<typename Type::Code2Type<nType>::T>();
+			From(p).DoStore<TMem>(op.m_pArg[0], val);
+		}
+
+		// superinstructions
+		template <void (ProcessorPlus::*TFunc)()>
+		static void Th_LocalLocalOp(Processor& p, const Op& op, Word& nIp)
+		{
+			auto& x = From(p);
+			x.DoLocal(op.m_pArg[0], false, true);
+			nIp = op.m_Ip + op.m_pDelta[0];
+			x.DoLocal(op.m_pArg[1], false, true);
+			nIp = op.m_Ip + op.m_pDelta[1];
+			(x.*TFunc)();
+		}
+
+		template <void (ProcessorPlus::*TFunc)()>
+		static void Th_LocalConstOp(Processor& p, const Op& op, Word& nIp)
+		{
+			auto& x = From(p);
+			x.DoLocal(op.m_pArg[0], false, true);
+			nIp = op.m_Ip + op.m_pDelta[0];
+			x.m_Stack.Push<uint32_t>(op.m_pArg[1]);
+			nIp = op.m_Ip + op.m_pDelta[1];
+			(x.*TFunc)();
+		}
+
+		template <uint8_t nType, typename TMem>
+		static void Th_ConstLoad(Processor& p, const Op& op, Word& nIp)
+		{
+			p.m_Stack.Push<uint32_t>(op.m_pArg[0]);
+			nIp = op.m_Ip + op.m_pDelta[0];
+			From(p).DoLoad<nType, TMem>(op.m_pArg[1]);
+		}
+
+		template <uint8_t nType, typename TMem>
+		static void Th_LocalLoad(Processor& p, const Op& op, Word& nIp)
+		{
+			auto& x = From(p);
+			x.DoLocal(op.m_pArg[0], false, true);
+			nIp = op.m_Ip + op.m_pDelta[0];
+			x.DoLoad<nType, TMem>(op.m_pArg[1]);
+		}
+
+		template <void (ProcessorPlus::*TFunc)()>
+		static void Th_OpBrIf(Processor& p, const Op& op, Word& nIp)
+		{
+			auto& x = From(p);
+			(x.*TFunc)();
+			nIp = op.m_Ip + op.m_pDelta[0];
+			x.DoBrIf(op.m_pArg[0]);
+		}
+
+		static bool Decode(Reader& inp, Op& op, const uint8_t* pCode)
+		{
+			typedef Instruction I;
+			switch ((I) inp.Read1())
+			{
+			case I::local_get: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_Local<false, true>; break;
+			case I::local_set: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_Local<true, false>; break;
+			case I::local_tee: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_Local<true, true>; break;
+			case I::global_get_imp: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_GlobalImp<true>; break;
+			case I::global_set_imp: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_GlobalImp<false>; break;
+			case I::drop: op.m_pArg[0] = inp.Read1(); op.m_pfn = Th_drop; break;
+			case I::select: op.m_pArg[0] = inp.Read1(); op.m_pfn = Th_select; break;
+			case I::i32_wrap_i64: op.m_pfn = Th_Simple<&ProcessorPlus::On_i32_wrap_i64>; break;
+			case I::i64_extend_i32_s: op.m_pfn = Th_Simple<&ProcessorPlus::On_i64_extend_i32_s>; break;
+			case I::i64_extend_i32_u: op.m_pfn = Th_Simple<&ProcessorPlus::On_i64_extend_i32_u>; break;
+			case I::call_indirect: op.m_pfn = Th_Simple<&ProcessorPlus::On_call_indirect>; break;
+			case I::br: op.m_pArg[0] = ReadAddr(inp); op.m_pfn = Th_br; break;
+			case I::br_if: op.m_pArg[0] = ReadAddr(inp); op.m_pfn = Th_br_if; break;
+			case I::call: op.m_pArg[0] = ReadAddr(inp); op.m_pfn = Th_call; break;
+			case I::i32_const: op.m_pArg[0] = static_cast<uint32_t>(inp.Read<int32_t>()); op.m_pfn = Th_i32_const; break;
+			case I::i64_const: op.m_Imm = static_cast<uint64_t>(inp.Read<int64_t>()); op.m_pfn = Th_i64_const; break;
+			case I::prolog: op.m_pArg[0] = inp.Read<uint32_t>(); op.m_pfn = Th_prolog; break;
+
+			case I::br_table:
+				{
+					uint32_t nLabels;
+					inp.Read(nLabels);
+
+					op.m_pArg[0] = nLabels++;
+					uint32_t nSize = sizeof(Word) * nLabels;
+					Test(nSize / sizeof(Word) == nLabels); // overflow check
+
+					op.m_pArg[1] = static_cast<Word>(inp.Consume(nSize) - pCode);
+					op.m_pfn = Th_br_table;
+				}
+				break;
+
+			case I::call_ext:
+				op.m_pArg[0] = inp.Read<uint32_t>();
+				op.m_pfn = Th_call_ext;
+				op.m_Exit = true;
+				break;
+
+			case I::ret:
+				for (uint32_t i = 0; i < 3; i++)
+					op.m_pArg[i] = inp.Read<uint32_t>();
+				op.m_pfn = Th_ret;
+				op.m_Exit = true;
+				break;
+
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: op.m_pfn = Th_Simple<&ProcessorPlus::On_##name<uint32_t, uint32_t> >; break; \
+			case I::i64_##name: op.m_pfn = Th_Simple<&ProcessorPlus::On_##name<uint32_t, uint64_t> >; break;
+
+			WasmInstructions_unop_Polymorphic_32(THE_MACRO)
+			WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: op.m_pfn = Th_Simple<&ProcessorPlus::On_##name<uint32_t, uint32_t> >; break; \
+			case I::i64_##name: op.m_pfn = Th_Simple<&ProcessorPlus::On_##name<uint64_t, uint64_t> >; break;
+
+			WasmInstructions_binop_Polymorphic_x(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(id, type, name, tmem) \
+			case I::type##_##name: op.m_pArg[0] = ReadMemArg(inp); op.m_pfn = Th_Load<Type::type, tmem>; break;
+
+			WasmInstructions_Load(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(id, type, name, tmem) \
+			case I::type##_##name: op.m_pArg[0] = ReadMemArg(inp); op.m_pfn = Th_Store<Type::type, tmem>; break;
+
+			WasmInstructions_Store(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				return false; // unsupported, or always fails. Leave it to the interpreter
+			}
+
+			return true;
+		}
+
+		static ThreadedCode::Handler get_FusedLocalLocal(uint8_t nInstruction)
+		{
+			typedef Instruction I;
+			switch ((I) nInstruction)
+			{
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: return Th_LocalLocalOp<&ProcessorPlus::On_##name<uint32_t, uint32_t> >; \
+			case I::i64_##name: return Th_LocalLocalOp<&ProcessorPlus::On_##name<uint32_t, uint64_t> >;
+
+			WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+#undef THE_MACRO
+
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: return Th_LocalLocalOp<&ProcessorPlus::On_##name<uint32_t, uint32_t> >; \
+			case I::i64_##name: return Th_LocalLocalOp<&ProcessorPlus::On_##name<uint64_t, uint64_t> >;
+
+			WasmInstructions_binop_Polymorphic_x(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				return nullptr;
+			}
+		}
+
+		static ThreadedCode::Handler get_FusedLocalConst(uint8_t nInstruction) // i32 only
+		{
+			typedef Instruction I;
+			switch ((I) nInstruction)
+			{
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: return Th_LocalConstOp<&ProcessorPlus::On_##name<uint32_t, uint32_t> >;
+
+			WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+			WasmInstructions_binop_Polymorphic_x(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				return nullptr;
+			}
+		}
+
+		static ThreadedCode::Handler get_FusedLoad(uint8_t nInstruction, bool bConst)
+		{
+			typedef Instruction I;
+			switch ((I) nInstruction)
+			{
+#define THE_MACRO(id, type, name, tmem) \
+			case I::type##_##name: return bConst ? Th_ConstLoad<Type::type, tmem> : Th_LocalLoad<Type::type, tmem>;
+
+			WasmInstructions_Load(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				return nullptr;
+			}
+		}
+
+		static ThreadedCode::Handler get_FusedBrIf(uint8_t nInstruction)
+		{
+			typedef Instruction I;
+			switch ((I) nInstruction)
+			{
+#define THE_MACRO(name, id32, id64) \
+			case I::i32_##name: return Th_OpBrIf<&ProcessorPlus::On_##name<uint32_t, uint32_t> >; \
+			case I::i64_##name: return Th_OpBrIf<&ProcessorPlus::On_##name<uint32_t, uint64_t> >;
+
+			WasmInstructions_unop_Polymorphic_32(THE_MACRO)
+			WasmInstructions_binop_Polymorphic_32(THE_MACRO)
+#undef THE_MACRO
+
+			default:
+				return nullptr;
+			}
+		}
+
+		uint32_t RunThreadedPlus(const ThreadedCode& tc, uint32_t& nCharge, uint32_t nCycleCost)
+		{
+			const uint8_t* pCode = reinterpret_cast<const uint8_t*>(m_Code.p);
+			if ((tc.m_Code.p != m_Code.p) || (tc.m_Code.n != m_Code.n) || (m_Instruction.m_p1 != pCode + m_Code.n))
+				return 0;
+
+			const Op* pOp = tc.Find(get_Ip());
+			if (!pOp)
+				return 0;
+
+			RunCheckpoint cp;
+			uint32_t nDone = 0;
+
+			while (true)
+			{
+				if (nCharge < nCycleCost * pOp->m_nCycles)
+				{
+					// not enough for the whole superinstruction, proceed with its 1st instruction
+					pOp = &tc.m_vOps[pOp->m_iPlain];
+					if (nCharge < nCycleCost)
+						break;
+				}
+
+				nCharge -= nCycleCost * pOp->m_nCycles;
+				nDone += pOp->m_nCycles;
+
+				cp.m_Ip = pOp->m_Ip;
+				m_Instruction.m_p0 = pCode + pOp->m_IpNext; // as if the operands were read
+
+				pOp->m_pfn(*this, *pOp, cp.m_Ip);
+
+				if (pOp->m_Exit || (m_Code.p != pCode))
+					break;
+
+				Word ip = get_Ip();
+				pOp = (ip == pOp->m_IpNext) ? tc.get_Op(pOp->m_iNext) : tc.Find(ip);
+				if (!pOp)
+					break;
+			}
+
+			return nDone;
+		}
 	};
 
 	Word Processor::get_Ip() const
@@ -1727,6 +2082,8 @@ namespace Wasm {
 
 		case MemoryType::Data:
 			//Test(!bW); Enable write to data. This enables normal use of global variables.
+			if (bW && m_DataShared)
+				Cast::NotConst(this)->OnDataWrite();
 			blob = m_Data;
 			nOffset -= m_prData0; // data va start at specific offset
 			break;
@@ -1774,11 +2131,128 @@ namespace Wasm {
 		p.RunOncePlus();
 	}
 
+	uint32_t Processor::RunThreaded(const ThreadedCode& tc, uint32_t& nCharge, uint32_t nCycleCost)
+	{
+		return Cast::Up<ProcessorPlus>(*this).RunThreadedPlus(tc, nCharge, nCycleCost);
+	}
+
+	/////////////////////////////////////////////
+	// ThreadedCode
+	void ThreadedCode::Build(const Blob& code, Word ip0, Word ip1)
+	{
+		m_Code = code;
+		m_vOps.clear();
+
+		std::setmin(ip1, code.n);
+		m_vIndex.assign(ip1, 0);
+
+		const uint8_t* pCode = reinterpret_cast<const uint8_t*>(code.p);
+		std::vector<uint8_t> vInstructions;
+
+		// linear sweep. The compiled functions are contiguous, on failure just try the next byte
+		for (Word ip = ip0; ip < ip1; )
+		{
+			Reader inp(Reader::Mode::Standard);
+			inp.m_p0 = pCode + ip;
+			inp.m_p1 = pCode + code.n;
+
+			Op op;
+			ZeroObject(op);
+
+			bool bOk;
+			try {
+				bOk = ProcessorPlus::Decode(inp, op, pCode);
+			}
+			catch (const Exc&) {
+				bOk = false;
+			}
+
+			if (!bOk || inp.m_ModeTriggered) // the latter depends on the reader mode, leave it to the interpreter
+			{
+				ip++;
+				continue;
+			}
+
+			op.m_Ip = ip;
+			op.m_IpNext = static_cast<Word>(inp.m_p0 - pCode);
+			op.m_nCycles = 1;
+			op.m_iPlain = static_cast<uint32_t>(m_vOps.size());
+
+			m_vIndex[ip] = op.m_iPlain + 1;
+			m_vOps.push_back(op);
+			vInstructions.push_back(pCode[ip]);
+
+			ip = op.m_IpNext;
+		}
+
+		// superinstructions
+		uint32_t nPlain = static_cast<uint32_t>(m_vOps.size());
+		for (uint32_t i = 0; i < nPlain; i++)
+		{
+			auto fnSeq = [&](uint32_t nCount) {
+				if (i + nCount > nPlain)
+					return false;
+				for (uint32_t j = 1; j < nCount; j++)
+				{
+					const Op& op = m_vOps[i + j];
+					if ((op.m_Ip != m_vOps[i + j - 1].m_IpNext) || (op.m_Ip - m_vOps[i].m_Ip > 0xff))
+						return false;
+				}
+				return true;
+			};
+
+			typedef Instruction I;
+			Op op = m_vOps[i];
+			uint32_t nCount = 0;
+
+			if ((I::local_get == vInstructions[i]) && fnSeq(3) && (I::local_get == vInstructions[i + 1]) && (op.m_pfn = ProcessorPlus::get_FusedLocalLocal(vInstructions[i + 2])))
+			{
+				nCount = 3;
+				op.m_pArg[1] = m_vOps[i + 1].m_pArg[0];
+			}
+			else if ((I::local_get == vInstructions[i]) && fnSeq(3) && (I::i32_const == vInstructions[i + 1]) && (op.m_pfn = ProcessorPlus::get_FusedLocalConst(vInstructions[i + 2])))
+			{
+				nCount = 3;
+				op.m_pArg[1] = m_vOps[i + 1].m_pArg[0];
+			}
+			else if (((I::i32_const == vInstructions[i]) || (I::local_get == vInstructions[i])) && fnSeq(2) && (op.m_pfn = ProcessorPlus::get_FusedLoad(vInstructions[i + 1], I::i32_const == vInstructions[i])))
+			{
+				nCount = 2;
+				op.m_pArg[1] = m_vOps[i + 1].m_pArg[0];
+			}
+			else if (fnSeq(2) && (I::br_if == vInstructions[i + 1]) && (op.m_pfn = ProcessorPlus::get_FusedBrIf(vInstructions[i])))
+			{
+				nCount = 2;
+				op.m_pArg[0] = m_vOps[i + 1].m_pArg[0];
+			}
+
+			if (!nCount)
+				continue;
+
+			for (uint32_t j = 1; j < nCount; j++)
+				op.m_pDelta[j - 1] = static_cast<uint8_t>(m_vOps[i + j].m_Ip - op.m_Ip);
+
+			op.m_IpNext = m_vOps[i + nCount - 1].m_IpNext;
+			op.m_nCycles = static_cast<uint8_t>(nCount);
+
+			m_vIndex[op.m_Ip] = static_cast<uint32_t>(m_vOps.size()) + 1;
+			m_vOps.push_back(op);
+		}
+
+		for (auto& op : m_vOps)
+			op.m_iNext = (op.m_IpNext < m_vIndex.size()) ? m_vIndex[op.m_IpNext] : 0;
+	}
+
 	void Processor::InvokeExt(uint32_t)
 	{
 		Fail(); // unresolved binding
 	}
 
+	void Processor::OnDataWrite()
+	{
+		Fail();
+	}
+
 	void Processor::OnGlobalVar(uint32_t iVar, bool bGet)
 	{
 		switch (static_cast<VariableType>(iVar))
@@ -1845,14 +2319,24 @@ namespace Wasm {
 
 	void ProcessorPlus::On_drop()
 	{
-		uint32_t nWords = Type::Words(m_Instruction.Read1());
+		DoDrop(m_Instruction.Read1());
+	}
+
+	void ProcessorPlus::DoDrop(uint8_t nType)
+	{
+		uint32_t nWords = Type::Words(nType);
 		Test(m_Stack.m_Pos - m_Stack.m_PosMin >= nWords);
 		m_Stack.m_Pos -= nWords;
 	}
 
 	void ProcessorPlus::On_select()
 	{
-		uint32_t nWords = Type::Words(m_Instruction.Read1());
+		DoSelect(m_Instruction.Read1());
+	}
+
+	void ProcessorPlus::DoSelect(uint8_t nType)
+	{
+		uint32_t nWords = Type::Words(nType);
 		auto nSel = m_Stack.Pop<Word>();
 
 		Test(m_Stack.m_Pos - m_Stack.m_PosMin >= (nWords << 1)); // must be at least 2 such operands
@@ -1888,9 +2372,13 @@ namespace Wasm {
 
 	void ProcessorPlus::On_br_if()
 	{
-		Word addr = ReadAddr();
+		DoBrIf(ReadAddr());
+	}
+
+	void ProcessorPlus::DoBrIf(Word nAddr)
+	{
 		if (m_Stack.Pop<Word>())
-			Jmp(addr);
+			Jmp(nAddr);
 	}
 
 	void ProcessorPlus::On_br_table()
@@ -1911,7 +2399,11 @@ namespace Wasm {
 
 	void ProcessorPlus::On_call()
 	{
-		Word nAddr = ReadAddr();
+		DoCall(ReadAddr());
+	}
+
+	void ProcessorPlus::DoCall(Word nAddr)
+	{
 		Word nRetAddr = get_Ip();
 		m_Stack.Push(nRetAddr);
 		OnCall(nAddr);
@@ -1919,8 +2411,11 @@ namespace Wasm {
 
 	void ProcessorPlus::On_call_ext()
 	{
-		uint32_t iExt = m_Instruction.Read<uint32_t>();
+		DoCallExt(m_Instruction.Read<uint32_t>());
+	}
 
+	void ProcessorPlus::DoCallExt(uint32_t iExt)
+	{
 		struct MyCheckpoint :public Checkpoint {
 			uint32_t m_iExt;
 			virtual void Dump(std::ostream& os) override {
@@ -1971,7 +2466,11 @@ namespace Wasm {
 
 	void ProcessorPlus::On_prolog()
 	{
-		auto nWords = m_Instruction.Read<uint32_t>();
+		DoProlog(m_Instruction.Read<uint32_t>());
+	}
+
+	void ProcessorPlus::DoProlog(uint32_t nWords)
+	{
 		while (nWords--)
 			m_Stack.Push1(0); // for more safety - zero-init locals. This way we don't need initial stack initialization 
 	}
@@ -1982,6 +2481,11 @@ namespace Wasm {
 		auto nLocals = m_Instruction.Read<uint32_t>();
 		auto nArgs = m_Instruction.Read<uint32_t>();
 
+		DoRet(nRets, nLocals, nArgs);
+	}
+
+	void ProcessorPlus::DoRet(uint32_t nRets, uint32_t nLocals, uint32_t nArgs)
+	{
 		// stack layout
 		// ...
 		// args
@@ -249,6 +249,48 @@ namespace Wasm {
 	};
 
 
+	struct Processor;
+
+	// Pre-decoded (call-threaded) form of the compiled code. Each instruction is decoded once into its handler and operands,
+	// frequent sequences are fused into superinstructions. Immutable once built, may be shared by several processors.
+	struct ThreadedCode
+	{
+		struct Op;
+		typedef void (*Handler)(Processor&, const Op&, Word& nIp); // nIp - the instruction being executed, for error reporting
+
+		struct Op
+		{
+			Handler m_pfn;
+			Word m_Ip;
+			Word m_IpNext;
+			uint32_t m_iNext; // 1-based index of the op at m_IpNext, 0 if none
+			uint32_t m_iPlain; // for superinstructions - the op of the 1st instruction alone, otherwise self
+			uint8_t m_nCycles; // num of instructions
+			uint8_t m_pDelta[2]; // ip offsets of the fused instructions
+			bool m_Exit; // may switch the code or the callstack
+			Word m_pArg[3];
+			uint64_t m_Imm;
+		};
+
+		Blob m_Code;
+		std::vector<Op> m_vOps;
+		std::vector<uint32_t> m_vIndex; // ip -> 1-based op index
+
+		void Build(const Blob& code, Word ip0, Word ip1); // decodes the instructions in the specified range
+
+		const Op* Find(Word ip) const {
+			return (ip < m_vIndex.size()) ? get_Op(m_vIndex[ip]) : nullptr;
+		}
+
+		const Op* get_Op(uint32_t i1) const {
+			return i1 ? &m_vOps[i1 - 1] : nullptr;
+		}
+
+		size_t get_Size() const {
+			return sizeof(Op) * m_vOps.size() + sizeof(uint32_t) * m_vIndex.size();
+		}
+	};
+
 	struct Processor
 	{
 		Blob m_Code;
@@ -257,6 +299,7 @@ namespace Wasm {
 		Word m_prData0;
 		Blob m_LinearMem;
 		Reader m_Instruction;
+		bool m_DataShared = false; // m_Data must not be modified in-place, OnDataWrite() is called before the 1st write
 
         virtual ~Processor() = default;
 
@@ -362,6 +405,11 @@ namespace Wasm {
 
 		void RunOnce();
 
+		// Runs the pre-decoded code starting from the current instruction, while it's decoded and the code isn't switched.
+		// Each instruction is preceded by discharging nCycleCost from nCharge, stops before the instruction that can't be afforded.
+		// Returns the num of executed instructions. If 0 - the caller should use RunOnce().
+		uint32_t RunThreaded(const ThreadedCode&, uint32_t& nCharge, uint32_t nCycleCost);
+
 		uint8_t* get_AddrEx(uint32_t nOffset, uint32_t nSize, bool bW) const;
 		uint8_t* get_AddrExVar(uint32_t nOffset, uint32_t& nSizeOut, bool bW) const;
 
@@ -378,6 +426,7 @@ namespace Wasm {
 
 		virtual void InvokeExt(uint32_t);
 		virtual void OnGlobalVar(uint32_t, bool bGet);
+		virtual void OnDataWrite(); // should make m_Data writable
 
 	};
 
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include "aes.h"
+#include "../utility/byteorder.h"
 
 /*
 *  FIPS-197 compliant AES implementation
@@ -479,6 +480,11 @@ void AES::Encoder::Init(const uint8_t* pKey)
 		RK[14] = RK[6] ^ RK[13];
 		RK[15] = RK[7] ^ RK[14];
 	}
+
+	for (i = 0; i < (Nr + 1) * 4; i++)
+	{
+		PUT_UINT32(m_erk[i], m_pRk, i * 4);
+	}
 }
 
 void AES::Decoder::Init(const Encoder& enc)
@@ -814,6 +820,30 @@ void AES::StreamCipher::Reset()
 	m_Counter = beam::Zero;
 }
 
+void AES::StreamCipher::Skip(const Encoder& enc, uint32_t nSize)
+{
+	uint8_t n = static_cast<uint8_t>(std::min<uint32_t>(m_nBuf, nSize));
+	m_nBuf -= n;
+	nSize -= n;
+
+	if (!nSize)
+		return;
+
+	assert(!m_nBuf);
+
+	beam::uintBig_t<sizeof(nSize)> nBlocks;
+	nBlocks = nSize / s_BlockSize;
+	m_Counter += nBlocks;
+
+	n = static_cast<uint8_t>(nSize % s_BlockSize);
+	if (n)
+	{
+		enc.Proceed(m_pBuf, m_Counter.m_pData);
+		m_Counter.Inc();
+		m_nBuf = static_cast<uint8_t>(s_BlockSize - n);
+	}
+}
+
 void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 {
 	assert(m_nBuf >= nSize);
@@ -824,6 +854,22 @@ void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 
 void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
 {
+	if (s_UseHw && (nSize >= m_nBuf + static_cast<uint32_t>(s_BlockSize)))
+	{
+		// consume the buffered cipherstream, then whole blocks at once
+		uint8_t n = m_nBuf;
+		PerfXor(pBuf, n);
+		pBuf += n;
+		nSize -= n;
+
+		uint32_t nBlocks = nSize / s_BlockSize;
+		XCryptBlocksHw(enc, pBuf, nBlocks);
+
+		n = static_cast<uint8_t>(nSize % s_BlockSize);
+		pBuf += nSize - n;
+		nSize = n;
+	}
+
 	while (true)
 	{
 		if (!m_nBuf)
@@ -846,3 +892,180 @@ void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize
 		nSize -= n;
 	}
 }
+
+////////////////////////////////////////
+// Hardware path: CTR keystream for 8 blocks at once, same byte order as above (the counter is a 128-bit big-endian number)
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define AES_HW_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define AES_HW_TARGET
+#	else
+#		include <cpuid.h>
+#		include <wmmintrin.h>
+#		define AES_HW_TARGET __attribute__((target("aes,sse2")))
+#	endif
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+#	define AES_HW_ARM
+#	include <arm_neon.h>
+#	define AES_HW_TARGET
+#	ifdef __linux__
+#		include <sys/auxv.h>
+#		include <asm/hwcap.h>
+#	endif
+#endif
+
+bool AES::IsHwSupported()
+{
+#if defined(AES_HW_X86)
+#	ifdef _MSC_VER
+	int pInfo[4];
+	__cpuid(pInfo, 1);
+	return !!(pInfo[2] & (1 << 25));
+#	else
+	unsigned int a, b, c, d;
+	return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES);
+#	endif
+#elif defined(AES_HW_ARM)
+#	ifdef __linux__
+	return !!(getauxval(AT_HWCAP) & HWCAP_AES);
+#	else
+	return true; // built for the crypto extensions
+#	endif
+#else
+	return false;
+#endif
+}
+
+bool AES::s_UseHw = AES::IsHwSupported();
+
+namespace {
+
+	struct CtrHw
+	{
+		static const uint32_t s_Wide = 8;
+
+		uint64_t m_Hi;
+		uint64_t m_Lo;
+
+		void Next(uint8_t* p)
+		{
+			uint64_t x = beam::ByteOrder::to_be(m_Hi);
+			memcpy(p, &x, sizeof(x));
+			x = beam::ByteOrder::to_be(m_Lo);
+			memcpy(p + sizeof(x), &x, sizeof(x));
+
+			if (!++m_Lo)
+				m_Hi++;
+		}
+	};
+
+#if defined(AES_HW_X86)
+
+	AES_HW_TARGET
+	void XCryptHw(const uint8_t* pRk, CtrHw& ctr, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		__m128i pK[AES::Nr + 1];
+		for (uint32_t i = 0; i < _countof(pK); i++)
+			pK[i] = _mm_loadu_si128((const __m128i*) (pRk + i * AES::s_BlockSize));
+
+		uint8_t pCtr[CtrHw::s_Wide][AES::s_BlockSize];
+		__m128i pX[CtrHw::s_Wide];
+
+		while (nBlocks)
+		{
+			uint32_t n = std::min(nBlocks, CtrHw::s_Wide);
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				ctr.Next(pCtr[j]);
+				pX[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) pCtr[j]), pK[0]);
+			}
+
+			for (uint32_t i = 1; i < AES::Nr; i++)
+				for (uint32_t j = 0; j < n; j++)
+					pX[j] = _mm_aesenc_si128(pX[j], pK[i]);
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				__m128i* pDst = (__m128i*) (pBuf + j * AES::s_BlockSize);
+				__m128i x = _mm_aesenclast_si128(pX[j], pK[AES::Nr]);
+				_mm_storeu_si128(pDst, _mm_xor_si128(x, _mm_loadu_si128(pDst)));
+			}
+
+			pBuf += n * AES::s_BlockSize;
+			nBlocks -= n;
+		}
+	}
+
+#elif defined(AES_HW_ARM)
+
+	AES_HW_TARGET
+	void XCryptHw(const uint8_t* pRk, CtrHw& ctr, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		uint8x16_t pK[AES::Nr + 1];
+		for (uint32_t i = 0; i < _countof(pK); i++)
+			pK[i] = vld1q_u8(pRk + i * AES::s_BlockSize);
+
+		uint8_t pCtr[CtrHw::s_Wide][AES::s_BlockSize];
+		uint8x16_t pX[CtrHw::s_Wide];
+
+		while (nBlocks)
+		{
+			uint32_t n = std::min(nBlocks, CtrHw::s_Wide);
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				ctr.Next(pCtr[j]);
+				pX[j] = vld1q_u8(pCtr[j]);
+			}
+
+			// AESE includes the AddRoundKey of the previous round
+			for (uint32_t i = 0; i < AES::Nr - 1; i++)
+				for (uint32_t j = 0; j < n; j++)
+					pX[j] = vaesmcq_u8(vaeseq_u8(pX[j], pK[i]));
+
+			for (uint32_t j = 0; j < n; j++)
+			{
+				uint8_t* pDst = pBuf + j * AES::s_BlockSize;
+				uint8x16_t x = veorq_u8(vaeseq_u8(pX[j], pK[AES::Nr - 1]), pK[AES::Nr]);
+				vst1q_u8(pDst, veorq_u8(x, vld1q_u8(pDst)));
+			}
+
+			pBuf += n * AES::s_BlockSize;
+			nBlocks -= n;
+		}
+	}
+
+#endif
+
+} // namespace
+
+void AES::StreamCipher::XCryptBlocksHw(const Encoder& enc, uint8_t* pBuf, uint32_t nBlocks)
+{
+	assert(!m_nBuf);
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARM)
+	CtrHw ctr;
+	memcpy(&ctr.m_Hi, m_Counter.m_pData, sizeof(ctr.m_Hi));
+	memcpy(&ctr.m_Lo, m_Counter.m_pData + sizeof(uint64_t), sizeof(ctr.m_Lo));
+	ctr.m_Hi = beam::ByteOrder::from_be(ctr.m_Hi);
+	ctr.m_Lo = beam::ByteOrder::from_be(ctr.m_Lo);
+
+	XCryptHw(enc.m_pRk, ctr, pBuf, nBlocks);
+
+	ctr.m_Hi = beam::ByteOrder::to_be(ctr.m_Hi);
+	ctr.m_Lo = beam::ByteOrder::to_be(ctr.m_Lo);
+	memcpy(m_Counter.m_pData, &ctr.m_Hi, sizeof(ctr.m_Hi));
+	memcpy(m_Counter.m_pData + sizeof(uint64_t), &ctr.m_Lo, sizeof(ctr.m_Lo));
+#else
+	// not reached, s_UseHw is never set
+	for (uint32_t i = 0; i < nBlocks; i++, pBuf += s_BlockSize)
+	{
+		enc.Proceed(m_pBuf, m_Counter.m_pData);
+		m_Counter.Inc();
+		memxor(pBuf, m_pBuf, s_BlockSize);
+	}
+#endif
+}
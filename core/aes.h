@@ -8,9 +8,13 @@ struct AES
 	static const int Nr = 14; // num-rounds
 	static const int s_BlockSize = 16;
 
+	static bool s_UseHw; // AES-NI / ARMv8 crypto extensions, if supported by the CPU. Can be turned off (tests)
+	static bool IsHwSupported();
+
 	struct Encoder
 	{
 		uint32_t m_erk[64]; // encryption round keys. Actually needed 60, but during init extra space is used
+		uint8_t m_pRk[(Nr + 1) * s_BlockSize]; // same round keys in byte order, for the hw path
 		void Init(const uint8_t* pKey);
 		void Proceed(uint8_t* pDst, const uint8_t* pSrc) const;
 	};
@@ -31,9 +35,11 @@ struct AES
 		uint8_t m_nBuf;
 
 		void PerfXor(uint8_t* pBuf, uint32_t nSize);
+		void XCryptBlocksHw(const Encoder&, uint8_t* pBuf, uint32_t nBlocks);
 
 		void Reset();
 		void XCrypt(const Encoder&, uint8_t* pBuf, uint32_t nSize);
+		void Skip(const Encoder&, uint32_t nSize); // advance the stream, as if nSize bytes were processed
 	};
 
 };
@@ -2849,6 +2849,35 @@ namespace beam
 		return ret ? ret : 1;
 	}
 
+	uint64_t GetTime_us()
+	{
+		using namespace std::chrono;
+		return (uint64_t) duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
+	void LatencyStats::Reset()
+	{
+		ZeroObject(*this);
+	}
+
+	void LatencyStats::Add(uint64_t dt_us)
+	{
+		m_Count++;
+		m_Total_us += dt_us;
+		std::setmax(m_Max_us, dt_us);
+	}
+
+	uint64_t LatencyStats::get_Avg_us() const
+	{
+		return m_Count ? (m_Total_us / m_Count) : 0;
+	}
+
+	std::ostream& operator << (std::ostream& s, const LatencyStats& x)
+	{
+		s << "avg=" << x.get_Avg_us() << "us, max=" << x.m_Max_us << "us, n=" << x.m_Count;
+		return s;
+	}
+
 	/////////////
 	// Asset
 	const PeerID Asset::s_InvalidOwnerID = Zero;
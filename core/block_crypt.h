@@ -52,6 +52,22 @@ namespace beam
 	Timestamp getTimestamp();
 	uint32_t GetTime_ms(); // platform-independent GetTickCount
 	uint32_t GetTimeNnz_ms(); // guaranteed non-zero
+	uint64_t GetTime_us(); // monotonic, for profiling only
+
+	struct LatencyStats
+	{
+		uint64_t m_Count;
+		uint64_t m_Total_us;
+		uint64_t m_Max_us;
+
+		LatencyStats() { Reset(); }
+
+		void Reset();
+		void Add(uint64_t dt_us);
+		uint64_t get_Avg_us() const;
+	};
+
+	std::ostream& operator << (std::ostream&, const LatencyStats&);
 
 	void HeightAdd(Height& trg, Height val); // saturates if overflow
 
@@ -342,6 +342,9 @@ namespace beam
 		uint64_t m_Total;
 
 		UtxoTree::Compact m_UtxoTree;
+		Executor* m_pExec; // if set - the utxo keys are collected, and the tree is built in parallel
+		std::vector<UtxoTree::Key> m_vUtxos;
+		Merkle::Hash m_hvUtxos;
 		Merkle::CompactMmr m_Shielded;
 		Merkle::CompactMmr m_Assets;
 		Merkle::Hash m_hvContracts;
@@ -350,6 +353,7 @@ namespace beam
 		Context(IParser& p)
 			:m_Parser(p)
 			,m_Der(m_Stream)
+			,m_pExec(Executor::s_pInstance)
 		{
 		}
 
@@ -413,7 +417,7 @@ namespace beam
 
 			virtual bool get_Utxos(Merkle::Hash& hv) override
 			{
-				m_This.m_UtxoTree.Flush(hv);
+				hv = m_This.m_hvUtxos;
 				return true;
 			}
 
@@ -442,6 +446,14 @@ namespace beam
 			}
 		};
 
+		if (m_pExec)
+		{
+			if (!UtxoTree::Compact::Build(m_hvUtxos, m_vUtxos.empty() ? nullptr : &m_vUtxos.front(), m_vUtxos.size(), *m_pExec))
+				ThrowBadData();
+		}
+		else
+			m_UtxoTree.Flush(m_hvUtxos);
+
 		Verifier v(*this);
 		v.m_Height = m_Tip.m_Height;
 
@@ -521,8 +533,18 @@ namespace beam
 			UtxoTree::Key key;
 			key = d;
 
-			if (!m_UtxoTree.Add(key))
-				ThrowBadData();
+			if (m_pExec)
+			{
+				// the count overflow is detected by the build
+				if (!m_vUtxos.empty() && (m_vUtxos.back().V.cmp(key.V) > 0))
+					ThrowBadData();
+				m_vUtxos.push_back(key);
+			}
+			else
+			{
+				if (!m_UtxoTree.Add(key))
+					ThrowBadData();
+			}
 
 			if (!m_Parser.OnUtxo(h, outp))
 				return false;
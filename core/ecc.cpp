@@ -14,6 +14,7 @@
 
 #include "common.h"
 #include "ecc_native.h"
+#include "../utility/byteorder.h"
 
 #if defined(__clang__) || defined(__GNUC__) || defined(__GNUG__)
 #	pragma GCC diagnostic push
@@ -42,6 +43,27 @@
 #    include <fcntl.h>
 #endif // WIN32
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define SHA_HW_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		include <immintrin.h>
+#		define SHA_HW_TARGET
+#	else
+#		include <cpuid.h>
+#		include <immintrin.h>
+#		define SHA_HW_TARGET __attribute__((target("sha,sse4.1")))
+#		define SHA_LANES_VEC // multi-buffer via gcc/clang vector extensions
+#	endif
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#	define SHA_HW_ARM
+#	include <arm_neon.h>
+#	ifdef __linux__
+#		include <sys/auxv.h>
+#		include <asm/hwcap.h>
+#	endif
+#endif
+
 //#ifdef __linux__
 //#	include <sys/syscall.h>
 //#	include <linux/random.h>
@@ -350,6 +372,475 @@ namespace ECC {
 
 	/////////////////////
 	// Hash
+	namespace Sha256
+	{
+		constexpr uint32_t s_pIV[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+
+		alignas(16) constexpr uint32_t s_pK[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		constexpr uint8_t s_pPad[64] = { 0x80 };
+
+		// Padding block of a 64-byte message
+		constexpr uint8_t s_pPad64[64] = {
+			0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0
+		};
+
+#define SHA_ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA_S0(x) (SHA_ROR(x, 2) ^ SHA_ROR(x, 13) ^ SHA_ROR(x, 22))
+#define SHA_S1(x) (SHA_ROR(x, 6) ^ SHA_ROR(x, 11) ^ SHA_ROR(x, 25))
+#define SHA_s0(x) (SHA_ROR(x, 7) ^ SHA_ROR(x, 18) ^ ((x) >> 3))
+#define SHA_s1(x) (SHA_ROR(x, 17) ^ SHA_ROR(x, 19) ^ ((x) >> 10))
+
+		// Message schedule of the padding block is constant, precalculated along with the round constants
+		struct PadWK
+		{
+			alignas(16) uint32_t m_p[64] = {};
+
+			constexpr PadWK()
+			{
+				uint32_t pW[64] = {};
+				for (uint32_t i = 0; i < 16; i++)
+					for (uint32_t j = 0; j < 4; j++)
+						pW[i] = (pW[i] << 8) | s_pPad64[i * 4 + j];
+				for (uint32_t i = 16; i < 64; i++)
+					pW[i] = SHA_s1(pW[i - 2]) + pW[i - 7] + SHA_s0(pW[i - 15]) + pW[i - 16];
+				for (uint32_t i = 0; i < 64; i++)
+					m_p[i] = pW[i] + s_pK[i];
+			}
+		};
+
+		constexpr PadWK s_PadWK;
+
+		void TransformSoft(uint32_t* pState, const uint8_t* p, size_t nBlocks)
+		{
+			for (; nBlocks--; p += 64)
+			{
+				uint32_t pChunk[16];
+				memcpy(pChunk, p, sizeof(pChunk));
+				secp256k1_sha256_transform(pState, pChunk);
+			}
+		}
+
+		void Export(Hash::Value& out, const uint32_t* pState)
+		{
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				uint32_t x = beam::ByteOrder::to_be(pState[i]);
+				memcpy(out.m_pData + i * 4, &x, sizeof(x));
+			}
+		}
+
+		void HashPairSoft(Hash::Value& out, const Hash::Value& l, const Hash::Value& r, void (*pfnTransform)(uint32_t*, const uint8_t*, size_t))
+		{
+			uint8_t pBlock[64];
+			memcpy(pBlock, l.m_pData, l.nBytes);
+			memcpy(pBlock + l.nBytes, r.m_pData, r.nBytes);
+
+			uint32_t pState[8];
+			memcpy(pState, s_pIV, sizeof(pState));
+			pfnTransform(pState, pBlock, 1);
+			pfnTransform(pState, s_pPad64, 1);
+
+			Export(out, pState);
+		}
+
+#if defined(SHA_HW_X86)
+
+		// SHA-NI keeps the state as ABEF/CDGH. Several independent lanes are interleaved to hide the sha256rnds2 latency
+		struct LaneNi
+		{
+			__m128i m_S0;
+			__m128i m_S1;
+			__m128i m_pW[4];
+
+			SHA_HW_TARGET void Load(const uint8_t* pL, const uint8_t* pR)
+			{
+				const __m128i mskBE = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+				m_pW[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) pL), mskBE);
+				m_pW[1] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (pL + 16)), mskBE);
+				m_pW[2] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) pR), mskBE);
+				m_pW[3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (pR + 16)), mskBE);
+			}
+
+			SHA_HW_TARGET void Import(const uint32_t* pState)
+			{
+				__m128i x = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) pState), 0xB1); // CDAB
+				m_S1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) (pState + 4)), 0x1B); // EFGH
+				m_S0 = _mm_alignr_epi8(x, m_S1, 8); // ABEF
+				m_S1 = _mm_blend_epi16(m_S1, x, 0xF0); // CDGH
+			}
+
+			SHA_HW_TARGET void Export(uint32_t* pState) const
+			{
+				__m128i x = _mm_shuffle_epi32(m_S0, 0x1B); // FEBA
+				__m128i y = _mm_shuffle_epi32(m_S1, 0xB1); // DCHG
+				_mm_storeu_si128((__m128i*) pState, _mm_blend_epi16(x, y, 0xF0)); // DCBA
+				_mm_storeu_si128((__m128i*) (pState + 4), _mm_alignr_epi8(y, x, 8)); // ABEF
+			}
+
+			SHA_HW_TARGET void Export(Hash::Value& out) const
+			{
+				const __m128i mskBE = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+				__m128i x = _mm_shuffle_epi32(m_S0, 0x1B);
+				__m128i y = _mm_shuffle_epi32(m_S1, 0xB1);
+				_mm_storeu_si128((__m128i*) out.m_pData, _mm_shuffle_epi8(_mm_blend_epi16(x, y, 0xF0), mskBE));
+				_mm_storeu_si128((__m128i*) (out.m_pData + 16), _mm_shuffle_epi8(_mm_alignr_epi8(y, x, 8), mskBE));
+			}
+
+			template <uint32_t i>
+			SHA_HW_TARGET void Quad(__m128i k)
+			{
+				__m128i& w = m_pW[i & 3];
+				__m128i x = _mm_add_epi32(w, k);
+				m_S1 = _mm_sha256rnds2_epu32(m_S1, m_S0, x);
+
+				if ((i >= 3) && (i < 15))
+				{
+					__m128i& wNext = m_pW[(i + 1) & 3];
+					wNext = _mm_add_epi32(wNext, _mm_alignr_epi8(w, m_pW[(i + 3) & 3], 4));
+					wNext = _mm_sha256msg2_epu32(wNext, w);
+				}
+
+				m_S0 = _mm_sha256rnds2_epu32(m_S0, m_S1, _mm_shuffle_epi32(x, 0x0E));
+
+				if ((i >= 1) && (i < 13))
+				{
+					__m128i& wPrev = m_pW[(i + 3) & 3];
+					wPrev = _mm_sha256msg1_epu32(wPrev, w);
+				}
+			}
+
+			SHA_HW_TARGET void QuadConst(__m128i wk)
+			{
+				m_S1 = _mm_sha256rnds2_epu32(m_S1, m_S0, wk);
+				m_S0 = _mm_sha256rnds2_epu32(m_S0, m_S1, _mm_shuffle_epi32(wk, 0x0E));
+			}
+		};
+
+		template <uint32_t nLanes>
+		SHA_HW_TARGET void BlockNi(LaneNi* pL)
+		{
+			__m128i pS0[nLanes], pS1[nLanes];
+			for (uint32_t l = 0; l < nLanes; l++)
+			{
+				pS0[l] = pL[l].m_S0;
+				pS1[l] = pL[l].m_S1;
+			}
+
+#define SHA_NI_QUAD(i) \
+			{ \
+				__m128i k = _mm_load_si128((const __m128i*) (s_pK + i * 4)); \
+				for (uint32_t l = 0; l < nLanes; l++) \
+					pL[l].Quad<i>(k); \
+			}
+
+			SHA_NI_QUAD(0) SHA_NI_QUAD(1) SHA_NI_QUAD(2) SHA_NI_QUAD(3)
+			SHA_NI_QUAD(4) SHA_NI_QUAD(5) SHA_NI_QUAD(6) SHA_NI_QUAD(7)
+			SHA_NI_QUAD(8) SHA_NI_QUAD(9) SHA_NI_QUAD(10) SHA_NI_QUAD(11)
+			SHA_NI_QUAD(12) SHA_NI_QUAD(13) SHA_NI_QUAD(14) SHA_NI_QUAD(15)
+
+#undef SHA_NI_QUAD
+
+			for (uint32_t l = 0; l < nLanes; l++)
+			{
+				pL[l].m_S0 = _mm_add_epi32(pL[l].m_S0, pS0[l]);
+				pL[l].m_S1 = _mm_add_epi32(pL[l].m_S1, pS1[l]);
+			}
+		}
+
+		SHA_HW_TARGET void TransformNi(uint32_t* pState, const uint8_t* p, size_t nBlocks)
+		{
+			LaneNi x;
+			x.Import(pState);
+
+			for (; nBlocks--; p += 64)
+			{
+				x.Load(p, p + 32);
+				BlockNi<1>(&x);
+			}
+
+			x.Export(pState);
+		}
+
+		template <uint32_t nLanes>
+		SHA_HW_TARGET void HashPairsNi(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR)
+		{
+			const __m128i s0 = _mm_set_epi32(s_pIV[0], s_pIV[1], s_pIV[4], s_pIV[5]);
+			const __m128i s1 = _mm_set_epi32(s_pIV[2], s_pIV[3], s_pIV[6], s_pIV[7]);
+
+			LaneNi pL[nLanes];
+			for (uint32_t l = 0; l < nLanes; l++)
+			{
+				pL[l].m_S0 = s0;
+				pL[l].m_S1 = s1;
+				pL[l].Load(ppL[l]->m_pData, ppR[l]->m_pData);
+			}
+
+			BlockNi<nLanes>(pL);
+
+			__m128i pS0[nLanes], pS1[nLanes];
+			for (uint32_t l = 0; l < nLanes; l++)
+			{
+				pS0[l] = pL[l].m_S0;
+				pS1[l] = pL[l].m_S1;
+			}
+
+			for (uint32_t i = 0; i < 64; i += 4)
+			{
+				__m128i wk = _mm_load_si128((const __m128i*) (s_PadWK.m_p + i));
+				for (uint32_t l = 0; l < nLanes; l++)
+					pL[l].QuadConst(wk);
+			}
+
+			for (uint32_t l = 0; l < nLanes; l++)
+			{
+				pL[l].m_S0 = _mm_add_epi32(pL[l].m_S0, pS0[l]);
+				pL[l].m_S1 = _mm_add_epi32(pL[l].m_S1, pS1[l]);
+				pL[l].Export(*ppOut[l]);
+			}
+		}
+
+		void HashPairsHw(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR, uint32_t nCount)
+		{
+			for (; nCount >= 2; nCount -= 2, ppOut += 2, ppL += 2, ppR += 2)
+				HashPairsNi<2>(ppOut, ppL, ppR);
+			if (nCount)
+				HashPairsNi<1>(ppOut, ppL, ppR);
+		}
+
+#elif defined(SHA_HW_ARM)
+
+		void TransformHw(uint32_t* pState, const uint8_t* p, size_t nBlocks)
+		{
+			uint32x4_t s0 = vld1q_u32(pState);
+			uint32x4_t s1 = vld1q_u32(pState + 4);
+
+			for (; nBlocks--; p += 64)
+			{
+				uint32x4_t pW[4];
+				for (uint32_t i = 0; i < 4; i++)
+					pW[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + i * 16)));
+
+				uint32x4_t s0Prev = s0, s1Prev = s1;
+
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					uint32x4_t& w = pW[i & 3];
+					uint32x4_t x = vaddq_u32(w, vld1q_u32(s_pK + i * 4));
+
+					uint32x4_t s0Tmp = s0;
+					s0 = vsha256hq_u32(s0, s1, x);
+					s1 = vsha256h2q_u32(s1, s0Tmp, x);
+
+					if (i < 12)
+						w = vsha256su1q_u32(vsha256su0q_u32(w, pW[(i + 1) & 3]), pW[(i + 2) & 3], pW[(i + 3) & 3]);
+				}
+
+				s0 = vaddq_u32(s0, s0Prev);
+				s1 = vaddq_u32(s1, s1Prev);
+			}
+
+			vst1q_u32(pState, s0);
+			vst1q_u32(pState + 4, s1);
+		}
+
+		void HashPairsHw(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR, uint32_t nCount)
+		{
+			for (uint32_t i = 0; i < nCount; i++)
+				HashPairSoft(*ppOut[i], *ppL[i], *ppR[i], TransformHw);
+		}
+
+#endif // SHA_HW_ARM
+
+#if defined(SHA_LANES_VEC)
+
+		// Multi-buffer: each vector element is a separate message
+		template <typename V, uint32_t nLanes>
+		__attribute__((always_inline)) inline void HashPairsVec(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR, uint32_t nCount)
+		{
+			V pW[16];
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				for (uint32_t l = 0; l < nLanes; l++)
+				{
+					uint32_t l_ = (l < nCount) ? l : 0;
+					uint32_t a, b;
+					memcpy(&a, ppL[l_]->m_pData + i * 4, sizeof(a));
+					memcpy(&b, ppR[l_]->m_pData + i * 4, sizeof(b));
+					pW[i][l] = beam::ByteOrder::from_be(a);
+					pW[i + 8][l] = beam::ByteOrder::from_be(b);
+				}
+			}
+
+			V pS[8];
+			for (uint32_t i = 0; i < 8; i++)
+				pS[i] = V{} + s_pIV[i];
+
+			V a = pS[0], b = pS[1], c = pS[2], d = pS[3], e = pS[4], f = pS[5], g = pS[6], h = pS[7];
+
+#define SHA_VEC_ROUND(wk) \
+			{ \
+				V t1 = h + SHA_S1(e) + (g ^ (e & (f ^ g))) + (wk); \
+				V t2 = SHA_S0(a) + ((a & b) | (c & (a | b))); \
+				h = g; g = f; f = e; e = d + t1; \
+				d = c; c = b; b = a; a = t1 + t2; \
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+				SHA_VEC_ROUND(pW[i] + s_pK[i])
+
+			for (uint32_t i = 16; i < 64; i++)
+			{
+				V& w = pW[i & 15];
+				w += SHA_s1(pW[(i - 2) & 15]) + pW[(i - 7) & 15] + SHA_s0(pW[(i - 15) & 15]);
+				SHA_VEC_ROUND(w + s_pK[i])
+			}
+
+			pS[0] += a; pS[1] += b; pS[2] += c; pS[3] += d; pS[4] += e; pS[5] += f; pS[6] += g; pS[7] += h;
+			a = pS[0]; b = pS[1]; c = pS[2]; d = pS[3]; e = pS[4]; f = pS[5]; g = pS[6]; h = pS[7];
+
+			for (uint32_t i = 0; i < 64; i++)
+				SHA_VEC_ROUND(s_PadWK.m_p[i])
+
+#undef SHA_VEC_ROUND
+
+			pS[0] += a; pS[1] += b; pS[2] += c; pS[3] += d; pS[4] += e; pS[5] += f; pS[6] += g; pS[7] += h;
+
+			for (uint32_t l = 0; l < nCount; l++)
+			{
+				uint32_t pState[8];
+				for (uint32_t i = 0; i < 8; i++)
+					pState[i] = pS[i][l];
+				Export(*ppOut[l], pState);
+			}
+		}
+
+		typedef uint32_t V4 __attribute__((vector_size(16)));
+		typedef uint32_t V8 __attribute__((vector_size(32)));
+
+		void HashPairs4(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR, uint32_t nCount)
+		{
+			HashPairsVec<V4, 4>(ppOut, ppL, ppR, nCount);
+		}
+
+		__attribute__((target("avx2")))
+		void HashPairs8(Hash::Value* const* ppOut, const Hash::Value* const* ppL, const Hash::Value* const* ppR, uint32_t nCount)
+		{
+			HashPairsVec<V8, 8>(ppOut, ppL, ppR, nCount);
+		}
+
+#endif // SHA_LANES_VEC
+
+#undef SHA_ROR
+#undef SHA_S0
+#undef SHA_S1
+#undef SHA_s0
+#undef SHA_s1
+
+	} // namespace Sha256
+
+	bool Hash::Processor::IsHwSupported()
+	{
+#if defined(SHA_HW_X86)
+#	ifdef _MSC_VER
+		int pInfo[4];
+		__cpuid(pInfo, 1);
+		if (!(pInfo[2] & (1 << 19))) // SSE4.1
+			return false;
+		__cpuidex(pInfo, 7, 0);
+		return !!(pInfo[1] & (1 << 29));
+#	else
+		unsigned int a, b, c, d;
+		if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & bit_SSE4_1))
+			return false;
+		return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA);
+#	endif
+#elif defined(SHA_HW_ARM)
+#	ifdef __linux__
+		return !!(getauxval(AT_HWCAP) & HWCAP_SHA2);
+#	else
+		return true; // built for the crypto extensions
+#	endif
+#else
+		return false;
+#endif
+	}
+
+	uint32_t Hash::Processor::get_LanesSupported()
+	{
+#if defined(SHA_LANES_VEC)
+		unsigned int a, b, c, d;
+		if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_OSXSAVE) && (c & bit_AVX) &&
+			__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_AVX2))
+		{
+			uint32_t nLo, nHi;
+			__asm__("xgetbv" : "=a"(nLo), "=d"(nHi) : "c"(0));
+			if (6 == (nLo & 6)) // OS saves the ymm registers
+				return 8;
+		}
+		return 4;
+#else
+		return 0;
+#endif
+	}
+
+	bool Hash::Processor::s_UseHw = Hash::Processor::IsHwSupported();
+	uint32_t Hash::Processor::s_Lanes = Hash::Processor::get_LanesSupported();
+
+	void Hash::Processor::Transform(uint32_t* pState, const uint8_t* p, size_t nBlocks)
+	{
+#if defined(SHA_HW_X86)
+		if (s_UseHw)
+			return Sha256::TransformNi(pState, p, nBlocks);
+#elif defined(SHA_HW_ARM)
+		if (s_UseHw)
+			return Sha256::TransformHw(pState, p, nBlocks);
+#endif
+		Sha256::TransformSoft(pState, p, nBlocks);
+	}
+
+	void Hash::Processor::HashPairs(Value* const* ppOut, const Value* const* ppL, const Value* const* ppR, uint32_t nCount)
+	{
+#if defined(SHA_HW_X86) || defined(SHA_HW_ARM)
+		if (s_UseHw)
+			return Sha256::HashPairsHw(ppOut, ppL, ppR, nCount);
+#endif
+
+#if defined(SHA_LANES_VEC)
+		if (s_Lanes)
+		{
+			for (uint32_t nLanes = s_Lanes; nCount > 1; )
+			{
+				uint32_t n = std::min(nCount, nLanes);
+				if (8 == nLanes)
+					Sha256::HashPairs8(ppOut, ppL, ppR, n);
+				else
+					Sha256::HashPairs4(ppOut, ppL, ppR, n);
+
+				ppOut += n;
+				ppL += n;
+				ppR += n;
+				nCount -= n;
+			}
+		}
+#endif
+
+		for (uint32_t i = 0; i < nCount; i++)
+			Sha256::HashPairSoft(*ppOut[i], *ppL[i], *ppR[i], Sha256::TransformSoft);
+	}
+
 	Hash::Processor::Processor()
 	{
 		Reset();
@@ -370,14 +861,53 @@ namespace ECC {
 	void Hash::Processor::Write(const void* p, uint32_t n)
 	{
 		assert(m_bInitialized);
-		secp256k1_sha256_write(this, (const uint8_t*) p, n);
+
+		const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(p);
+		uint8_t* pBuf = reinterpret_cast<uint8_t*>(buf);
+
+		uint32_t nBuf = static_cast<uint32_t>(bytes & 0x3f);
+		bytes += n;
+
+		if (nBuf)
+		{
+			uint32_t nNaked = 64 - nBuf;
+			if (n < nNaked)
+			{
+				memcpy(pBuf + nBuf, pSrc, n);
+				return;
+			}
+
+			memcpy(pBuf + nBuf, pSrc, nNaked);
+			Transform(s, pBuf, 1);
+
+			pSrc += nNaked;
+			n -= nNaked;
+		}
+
+		uint32_t nBlocks = n >> 6;
+		if (nBlocks)
+		{
+			Transform(s, pSrc, nBlocks);
+			pSrc += nBlocks << 6;
+			n &= 0x3f;
+		}
+
+		memcpy(pBuf, pSrc, n);
 	}
 
 	void Hash::Processor::Finalize(Value& v)
 	{
 		assert(m_bInitialized);
-		secp256k1_sha256_finalize(this, v.m_pData);
-		
+
+		uint64_t nBits = static_cast<uint64_t>(bytes) << 3;
+		Write(Sha256::s_pPad, static_cast<uint32_t>(1 + ((119 - (bytes & 0x3f)) & 0x3f)));
+
+		nBits = beam::ByteOrder::to_be(nBits);
+		Write(&nBits, sizeof(nBits));
+
+		Sha256::Export(v, s);
+		memset0(s, sizeof(s));
+
 		m_bInitialized = false;
 	}
 
@@ -1442,8 +1972,147 @@ namespace ECC {
 		return true;
 	}
 
+	unsigned int GetBits(const Scalar::Native& k, unsigned int iBit, unsigned int nBits)
+	{
+		const unsigned int nBitsPerWord = sizeof(Scalar::Native::uint) << 3;
+		const unsigned int nWords = _countof(k.get().d);
+
+		unsigned int iWord = iBit / nBitsPerWord;
+		if (iWord >= nWords)
+			return 0;
+
+		unsigned int iBitInWord = iBit & (nBitsPerWord - 1);
+		Scalar::Native::uint n = k.get().d[iWord] >> iBitInWord;
+
+		if ((iBitInWord + nBits > nBitsPerWord) && (iWord + 1 < nWords))
+			n |= k.get().d[iWord + 1] << (nBitsPerWord - iBitInWord);
+
+		return static_cast<unsigned int>(n) & ((1U << nBits) - 1);
+	}
+
+	void MultiMac::CalculateBuckets(Point::Native& res) const
+	{
+		// Pippenger's method for the casual points, fast mode only.
+		// The scalars are split into windows of signed digits. Per window each point is added to the bucket of its digit,
+		// then Sum(i * Bucket[i]) is obtained by 2 running sums. Windows are combined by doubling.
+		const uint32_t nCount = m_Casual;
+
+		// cost per window: a point addition per point + 2 per bucket
+		unsigned int nWndBits = 0;
+		uint64_t nCostMin = static_cast<uint64_t>(-1);
+		for (unsigned int c = 2; c <= 16; c++)
+		{
+			uint64_t nCost = static_cast<uint64_t>(ECC::nBits / c + 1) * (nCount + (1ULL << c));
+			if (nCost < nCostMin)
+			{
+				nCostMin = nCost;
+				nWndBits = c;
+			}
+		}
+
+		const unsigned int nWnds = ECC::nBits / nWndBits + 1; // the top window absorbs the last carry
+		const unsigned int nHalf = 1U << (nWndBits - 1);
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			Casual::Fast& f = m_pCasual[i].U.F.get();
+			f.m_nNeeded = (f.m_pPt[0] == Zero) ? 0 : 1;
+		}
+
+		// Bring to the same denominator, and treat as affine points (on the isomorphic curve), like in wNAF mode
+		secp256k1_fe zDenom;
+		Normalizer nrm(*this);
+		nrm.ToCommonDenominator(zDenom);
+
+		std::vector<secp256k1_ge> vPts(nCount);
+		std::vector<uint8_t> vCarry(nCount);
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			const Casual::Fast& f = m_pCasual[i].U.F.get();
+			if (f.m_nNeeded)
+				Point::Native::BatchNormalizer::get_As(vPts[i], f.m_pPt[0]);
+			else
+				vPts[i].infinity = 1;
+		}
+
+		std::vector<Point::Native> vBuckets(nHalf);
+		std::vector<Point::Native> vWnds(nWnds);
+		secp256k1_ge ge;
+
+		for (unsigned int iWnd = 0; iWnd < nWnds; iWnd++)
+		{
+			for (uint32_t j = 0; j < nHalf; j++)
+				vBuckets[j] = Zero;
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				if (vPts[i].infinity)
+					continue;
+
+				unsigned int nVal = GetBits(m_pKCasual[i], iWnd * nWndBits, nWndBits) + vCarry[i];
+
+				bool bNeg = (nVal > nHalf);
+				vCarry[i] = bNeg;
+				if (bNeg)
+					nVal = (1U << nWndBits) - nVal;
+
+				if (!nVal)
+					continue;
+
+				const secp256k1_ge* pGe = &vPts[i];
+				if (bNeg)
+				{
+					secp256k1_ge_neg(&ge, pGe);
+					pGe = &ge;
+				}
+
+				secp256k1_gej& gej = vBuckets[nVal - 1].get_Raw();
+				secp256k1_gej_add_ge_var(&gej, &gej, pGe, nullptr);
+			}
+
+			Point::Native ptRun(Zero);
+			Point::Native& ptSum = vWnds[iWnd];
+			ptSum = Zero;
+
+			for (uint32_t j = nHalf; j--; )
+			{
+				ptRun += vBuckets[j];
+				ptSum += ptRun;
+			}
+		}
+
+		res = Zero;
+		for (unsigned int iWnd = nWnds; iWnd--; )
+		{
+			if (!(res == Zero))
+			{
+				for (unsigned int i = 0; i < nWndBits; i++)
+					res = res * Two;
+			}
+
+			res += vWnds[iWnd];
+		}
+
+		// fix denominator
+		secp256k1_fe_mul(&res.get_Raw().z, &res.get_Raw().z, &zDenom);
+	}
+
 	void MultiMac::Calculate(Point::Native& res) const
 	{
+		if ((Mode::Fast == g_Mode) && (Reuse::None == m_ReuseFlag) && m_Casual && (static_cast<uint32_t>(m_Casual) >= m_BucketsMin))
+		{
+			// prepared points use their precalculated tables
+			MultiMac mm(*this);
+			mm.m_Casual = 0;
+			mm.Calculate(res);
+
+			Point::Native ptCasual;
+			CalculateBuckets(ptCasual);
+			res += ptCasual;
+			return;
+		}
+
 		const unsigned int nBitsPerWord = sizeof(Scalar::Native::uint) << 3;
 
 		static_assert(!(nBitsPerWord % Casual::Secure::nBits), "");
@@ -405,7 +405,15 @@ namespace ECC
 
 		Reuse::Enum m_ReuseFlag;
 
-		MultiMac() { Reset(); }
+		// In fast mode large numbers of casual points are multiplied by the bucket (Pippenger) method, instead of wNAF
+		static const uint32_t s_BucketsMin = 160;
+		uint32_t m_BucketsMin; // can be changed, for tests
+
+		MultiMac()
+			:m_BucketsMin(s_BucketsMin)
+		{
+			Reset();
+		}
 
 		void Reset();
 		void Calculate(Point::Native&) const;
@@ -413,6 +421,7 @@ namespace ECC
 	private:
 
 		struct Normalizer;
+		void CalculateBuckets(Point::Native&) const;
 	};
 
 	template <int nMaxCasual, int nMaxPrepared>
@@ -601,10 +610,24 @@ namespace ECC
 		void Finalize(Value&);
 		void FinalizeTruncated(uint8_t* p, uint32_t nSize);
 
+		static void Transform(uint32_t* pState, const uint8_t* p, size_t nBlocks);
+
 	public:
 		Processor();
 		~Processor();
 
+		static bool s_UseHw; // SHA extensions (x86 SHA-NI / ARMv8), if supported by the CPU. Can be turned off (tests)
+		static bool IsHwSupported();
+
+		// Multi-buffer path, used when the SHA extensions are off: 8 (AVX2), 4 (SSE2), or 0 (none)
+		static uint32_t s_Lanes;
+		static uint32_t get_LanesSupported();
+
+		// Hash of several independent 64-byte messages, each is the concatenation of 2 values (i.e. Merkle nodes).
+		// An output may alias the inputs of the same or the following pairs.
+		static const uint32_t s_PairsBatch = 8;
+		static void HashPairs(Value* const* ppOut, const Value* const* ppL, const Value* const* ppR, uint32_t nCount);
+
 		void Reset();
 
 		template <typename T>
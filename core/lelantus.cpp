@@ -102,17 +102,25 @@ struct CommitmentStd
 	}
 };
 
+bool CmList::get_AtNative(Point::Native& res, uint32_t iIdx)
+{
+	Point::Storage pt_s;
+	if (!get_At(pt_s, iIdx))
+		return false;
+
+	res.Import(pt_s, false);
+	return true;
+}
+
 void CmList::Import(MultiMac& mm, uint32_t iPos, uint32_t nCount)
 {
 	Point::Native comm;
 
 	for (mm.Reset(); static_cast<uint32_t>(mm.m_Casual) < nCount; mm.m_Casual++)
 	{
-		Point::Storage pt_s;
-		if (!get_At(pt_s, iPos + mm.m_Casual))
+		if (!get_AtNative(comm, iPos + mm.m_Casual))
 			break;
 
-		comm.Import(pt_s, false);
 		mm.m_pCasual[mm.m_Casual].Init(comm);
 	}
 }
@@ -121,8 +129,9 @@ void CmList::Calculate(Point::Native& res, uint32_t iPos, uint32_t nCount, const
 {
 	Mode::Scope scope(Mode::Fast);
 
-	const uint32_t nSizeNaggle = 128;
-	MultiMac_WithBufs<nSizeNaggle, 1> mm;
+	const uint32_t nSizeNaggle = 1024; // large enough for the bucket method
+	MultiMac_Dyn mm;
+	mm.Prepare(std::min(nSizeNaggle, nCount), 0);
 
 	Point::Native comm;
 
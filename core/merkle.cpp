@@ -21,7 +21,15 @@ namespace Merkle {
 
 void Interpret(Hash& out, const Hash& hLeft, const Hash& hRight)
 {
-	ECC::Hash::Processor() << hLeft << hRight >> out;
+	Hash* pOut = &out;
+	const Hash* pL = &hLeft;
+	const Hash* pR = &hRight;
+	ECC::Hash::Processor::HashPairs(&pOut, &pL, &pR, 1);
+}
+
+void InterpretBatch(Hash* const* ppOut, const Hash* const* ppLeft, const Hash* const* ppRight, uint32_t nCount)
+{
+	ECC::Hash::Processor::HashPairs(ppOut, ppLeft, ppRight, nCount);
 }
 
 void Interpret(Hash& hOld, const Hash& hNew, bool bNewOnRight)
@@ -479,9 +487,41 @@ struct FlyMmr::Inner
 		m_Count = m_This.m_Count;
 	}
 
+	static const uint8_t s_hBatch = 4; // subtrees of up to this height are evaluated level-by-level, with batch hashing
+
 	void Calculate(Hash& hv, const Position& pos) const
 	{
-		if (pos.H)
+		if (pos.H && (pos.H <= s_hBatch))
+		{
+			Hash pHv[1 << s_hBatch];
+			uint32_t n = 1U << pos.H;
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				uint64_t x = (pos.X << pos.H) + i;
+				assert(x < m_Count);
+				m_This.LoadElement(pHv[i], x);
+			}
+
+			Hash* ppOut[_countof(pHv) / 2];
+			const Hash* ppL[_countof(pHv) / 2];
+			const Hash* ppR[_countof(pHv) / 2];
+
+			for (n >>= 1; n; n >>= 1)
+			{
+				for (uint32_t i = 0; i < n; i++)
+				{
+					ppOut[i] = pHv + i;
+					ppL[i] = pHv + i * 2;
+					ppR[i] = pHv + i * 2 + 1;
+				}
+
+				InterpretBatch(ppOut, ppL, ppR, n);
+			}
+
+			hv = pHv[0];
+		}
+		else if (pos.H)
 		{
 			Position pos2;
 			pos2.X = pos.X << 1;
@@ -76,6 +76,7 @@ namespace Merkle {
 	void Interpret(Hash&, const Node&);
 	void Interpret(Hash&, const Hash& hLeft, const Hash& hRight);
 	void Interpret(Hash&, const Hash& hNew, bool bNewOnRight);
+	void InterpretBatch(Hash* const* ppOut, const Hash* const* ppLeft, const Hash* const* ppRight, uint32_t nCount); // independent pairs, multi-buffer hashing
 
 	struct Mmr
 	{
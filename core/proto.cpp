@@ -17,6 +17,7 @@
 #include "core/ecc_native.h"
 #include "proto.h"
 #include "../utility/logger.h"
+#include "../utility/lz.h"
 
 namespace beam {
 namespace proto {
@@ -76,67 +77,112 @@ void ProtocolPlus::get_HMac(ECC::Hash::Mac& hm, MacValue& res)
 
 void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
 {
-    MacValue hmac;
+    Finalize(sm, ser);
 
+    if (Mode::Plaintext != m_Mode)
+        Seal(sm, m_HMac, m_Enc, m_CipherOut);
+}
+
+void ProtocolPlus::Finalize(SerializedMsg& sm, MsgSerializer& ser)
+{
     if (Mode::Plaintext != m_Mode)
     {
         // 1. append dummy of the needed size
-        hmac = Zero;
+        MacValue hmac = Zero;
         ser & hmac;
     }
 
     ser.finalize(sm);
+}
 
-    if (Mode::Plaintext != m_Mode)
-    {
-        // 2. get size
-        size_t n = 0;
+void ProtocolPlus::Seal(SerializedMsg& sm, const ECC::Hash::Mac& hmKey, const AES::Encoder& enc, AES::StreamCipher& cOut)
+{
+    MacValue hmac;
 
-        for (size_t i = 0; i < sm.size(); i++)
-            n += sm[i].size;
+    // 2. get size
+    size_t n = 0;
 
-        // 3. Calculate
-        ECC::Hash::Mac hm = m_HMac;
-        size_t n2 = n - MacValue::nBytes;
+    for (size_t i = 0; i < sm.size(); i++)
+        n += sm[i].size;
 
-        for (size_t i = 0; ; i++)
-        {
-            assert(i < sm.size());
-            io::IOVec& iov = sm[i];
-            if (iov.size >= n2)
-            {
-                hm.Write(iov.data, (uint32_t) n2);
-                break;
-            }
+    // 3. Calculate
+    ECC::Hash::Mac hm = hmKey;
+    size_t n2 = n - MacValue::nBytes;
 
-            hm.Write(iov.data, (uint32_t)iov.size);
-            n2 -= iov.size;
+    for (size_t i = 0; ; i++)
+    {
+        assert(i < sm.size());
+        io::IOVec& iov = sm[i];
+        if (iov.size >= n2)
+        {
+            hm.Write(iov.data, (uint32_t) n2);
+            break;
         }
 
-        get_HMac(hm, hmac);
+        hm.Write(iov.data, (uint32_t)iov.size);
+        n2 -= iov.size;
+    }
 
-        // 4. Overwrite the hmac, encrypt
-        n2 = n;
+    get_HMac(hm, hmac);
 
-        for (size_t i = 0; i < sm.size(); i++)
+    // 4. Overwrite the hmac, encrypt
+    n2 = n;
+
+    for (size_t i = 0; i < sm.size(); i++)
+    {
+        io::IOVec& iov = sm[i];
+        uint8_t* dst = (uint8_t*) iov.data;
+
+        if (n2 <= hmac.nBytes)
+            memcpy(dst, hmac.m_pData + hmac.nBytes - n2, iov.size);
+        else
         {
-            io::IOVec& iov = sm[i];
-            uint8_t* dst = (uint8_t*) iov.data;
+            size_t offs = n2 - hmac.nBytes;
+            if (offs < iov.size)
+                memcpy(dst + offs, hmac.m_pData, iov.size - offs);
+        }
 
-            if (n2 <= hmac.nBytes)
-                memcpy(dst, hmac.m_pData + hmac.nBytes - n2, iov.size);
-            else
-            {
-                size_t offs = n2 - hmac.nBytes;
-                if (offs < iov.size)
-                    memcpy(dst + offs, hmac.m_pData, iov.size - offs);
-            }
+        n2 -= iov.size;
 
-            n2 -= iov.size;
+        cOut.XCrypt(enc, dst, (uint32_t) iov.size);
+    }
+}
 
-            m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) iov.size);
-        }
+void ProtocolPlus::Encrypt(io::SharedBuffer& res, const SerializedMsg& sm)
+{
+    assert(Mode::Plaintext != m_Mode);
+
+    size_t n = 0;
+    for (size_t i = 0; i < sm.size(); i++)
+        n += sm[i].size;
+
+    assert(n >= MsgHeader::SIZE);
+
+    auto buf = io::alloc_heap(n + MacValue::nBytes);
+    uint8_t* dst = buf.first;
+
+    for (size_t i = 0, nPos = 0; i < sm.size(); i++)
+    {
+        memcpy(dst + nPos, sm[i].data, sm[i].size);
+        nPos += sm[i].size;
     }
+
+    // account for the MAC in the header
+    MsgHeader hdr(dst);
+    hdr.size += MacValue::nBytes;
+    hdr.write(dst);
+
+    ECC::Hash::Mac hm = m_HMac;
+    hm.Write(dst, (uint32_t) n);
+
+    MacValue hmac;
+    get_HMac(hm, hmac);
+    memcpy(dst + n, hmac.m_pData, hmac.nBytes);
+
+    n += MacValue::nBytes;
+    m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) n);
+
+    res.assign(dst, n, std::move(buf.second));
 }
 
 void InitCipherIV(AES::StreamCipher& c, const ECC::Hash::Value& hvSecret, const ECC::Hash::Value& hvParam)
@@ -294,14 +340,51 @@ bool NotCalled_VerifyNoDuplicatedIDs(uint32_t id)
 
 /////////////////////////
 // NodeConnection
+struct NodeConnection::SealQueue
+{
+    struct Item
+    {
+        SerializedMsg m_Msg;
+        bool m_Async; // otherwise it was sealed in the reactor thread, and only waits for the preceding ones
+        bool m_Done; // protected by the offload mutex
+        uint64_t m_Dispatched_us;
+        uint64_t m_Started_us;
+        size_t m_Size;
+    };
+
+    std::list<Item> m_lst; // protected by the offload mutex. The worker only modifies the data of its item
+    NodeConnection* m_pOwner; // reactor thread only
+    size_t m_Size = 0; // total pending bytes, reactor thread only
+
+    Item& Add(SerializedMsg& sm, bool bAsync)
+    {
+        Item& x = m_lst.emplace_back();
+        x.m_Msg.swap(sm);
+        x.m_Async = bAsync;
+        x.m_Done = !bAsync;
+
+        x.m_Size = 0;
+        for (size_t i = 0; i < x.m_Msg.size(); i++)
+            x.m_Size += x.m_Msg[i].size;
+        m_Size += x.m_Size;
+
+        return x;
+    }
+};
+
+MsgHeader NodeConnection::SerializedOnce::get_Header()
+{
+    return MsgHeader('B', 'm', 10);
+}
+
 NodeConnection::NodeConnection()
-    :m_Protocol('B', 'm', 10, sizeof(HighestMsgCode), *this, 20000)
+    :m_Protocol('B', 'm', 10, sizeof(HighestMsgCode), *this, s_FragmentSize)
     ,m_ConnectPending(false)
 	,m_RulesCfgSent(false)
     ,m_LoginFlags(0)
 {
 #define THE_MACRO(code, msg) \
-    m_Protocol.add_message_handler<NodeConnection, msg##_NoInit, &NodeConnection::OnMsgInternal>(uint8_t(code), this, 0, 1024*1024*10);
+    m_Protocol.add_message_handler<NodeConnection, msg##_NoInit, &NodeConnection::OnMsgInternal>(uint8_t(code), this, 0, s_MaxMsgSize);
 
     BeamNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
@@ -322,6 +405,13 @@ void NodeConnection::Reset()
 
 	m_RulesCfgSent = false;
     m_Connection = NULL;
+
+    if (m_pSealQueue)
+    {
+        m_pSealQueue->m_pOwner = nullptr; // in-flight tasks would just drop their messages
+        m_pSealQueue.reset();
+    }
+
     m_pAsyncFail = NULL;
     m_LoginFlags = 0;
 
@@ -421,7 +511,8 @@ void NodeConnection::OnIoErr(io::ErrorCode err)
 
 size_t NodeConnection::get_Unsent() const
 {
-	return m_Connection ? m_Connection->get_Unsent() : 0;
+	size_t n = m_pSealQueue ? m_pSealQueue->m_Size : 0; // being sealed, or waiting for the preceding ones
+	return n + (m_Connection ? m_Connection->get_Unsent() : 0);
 }
 
 void NodeConnection::on_protocol_error(uint64_t, ProtocolError error)
@@ -520,19 +611,92 @@ bool NodeConnection::IsLive() const
     return m_Connection && !m_pAsyncFail;
 }
 
+template <typename TMsg>
+bool NodeConnection::SendCompressed(uint8_t nCode, const TMsg& msg)
+{
+    Compression::Type::Enum eType;
+    if (!m_pCompression || !m_pCompression->m_Threshold || !(LoginFlags::Compression & m_LoginFlags) || !Compression::Type::get(eType, nCode))
+        return false;
+
+    SerializerSizeCounter ssc;
+    ssc & msg;
+    if (ssc.m_Counter.m_Value < m_pCompression->m_Threshold)
+        return false;
+
+    Serializer ser;
+    ser & msg;
+    SerializeBuffer sb = ser.buffer();
+
+    return SendCompressed(nCode, eType, sb.first, sb.second);
+}
+
+bool NodeConnection::SendCompressed(uint8_t nCode, uint32_t iType, const void* p, size_t n)
+{
+    Compression& c = *m_pCompression;
+    Compression::Stats::PerType& s = c.m_Stats.m_p[iType];
+
+    uint64_t t0_us = GetTime_us();
+
+    Compressed msg;
+    msg.m_Type = nCode;
+    msg.m_SizeRaw = static_cast<uint32_t>(n);
+    msg.m_Data.resize(Lz::get_MaxCompressed(n));
+    msg.m_Data.resize(Lz::Compress(&msg.m_Data.front(), reinterpret_cast<const uint8_t*>(p), n));
+
+    s.m_Compress_us += GetTime_us() - t0_us;
+
+    bool bShrunk = (msg.m_Data.size() < n);
+    if (bShrunk)
+    {
+        s.m_Sent++;
+        s.m_SentRaw += n;
+        s.m_SentPacked += msg.m_Data.size();
+        SendRaw(msg);
+    }
+    else
+        s.m_Skipped++;
+
+    c.MaybeLogStats();
+    return bShrunk;
+}
+
+bool NodeConnection::OnMsg2(Compressed&& msg)
+{
+    Compression::Type::Enum eType;
+    if (!Compression::Type::get(eType, msg.m_Type) || (msg.m_SizeRaw > s_MaxMsgSize))
+        ThrowUnexpected("compressed msg");
+
+    uint64_t t0_us = GetTime_us();
+
+    ByteBuffer buf(msg.m_SizeRaw);
+    if (!Lz::Decompress(buf.empty() ? nullptr : &buf.front(), buf.size(), msg.m_Data.empty() ? nullptr : &msg.m_Data.front(), msg.m_Data.size()))
+        ThrowUnexpected("compressed msg corrupted");
+
+    if (m_pCompression)
+    {
+        Compression::Stats::PerType& s = m_pCompression->m_Stats.m_p[eType];
+        s.m_Rcvd++;
+        s.m_RcvdRaw += buf.size();
+        s.m_RcvdPacked += msg.m_Data.size();
+        s.m_Decompress_us += GetTime_us() - t0_us;
+
+        m_pCompression->MaybeLogStats();
+    }
+
+    // dispatch as if it was received as-is. Size limits and context checks apply
+    return m_Protocol.on_new_message(uint64_t(this), msg.m_Type, buf.empty() ? nullptr : &buf.front(), buf.size());
+}
+
 #define THE_MACRO(code, msg) \
 void NodeConnection::SendRaw(const msg& v) \
 { \
-    if (!IsLive()) \
+    if (!IsLive() || SendCompressed(uint8_t(code), v)) \
         return; \
     m_SerializeCache.clear(); \
     MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v); \
-    m_Protocol.Encrypt(m_SerializeCache, ser); \
-    io::Result res = m_Connection->write_msg(m_SerializeCache); \
+    m_Protocol.Finalize(m_SerializeCache, ser); \
+    WriteMsg(m_SerializeCache); \
     m_SerializeCache.clear(); \
-\
-    TestIoResultAsync(res); \
-    TestNotDrown(); \
 } \
 \
 bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
@@ -643,6 +807,7 @@ void NodeConnection::SendLogin()
 {
 	Login msg;
     LoginFlags::Extension::set(msg.m_Flags, LoginFlags::Extension::Maximum);
+    msg.m_Flags |= LoginFlags::Compression; // we always can decode
 	SetupLogin(msg);
 
 	const Rules& r = Rules::get();
@@ -975,6 +1140,257 @@ void NodeConnection::Send(const NewTransaction& msg)
     }
 }
 
+void NodeConnection::Send(const SerializedOnce& x)
+{
+    if (!IsLive())
+        return;
+
+    assert(!x.IsEmpty());
+
+    SerializedMsg sm;
+    if (ProtocolPlus::Mode::Plaintext == m_Protocol.m_Mode)
+        sm = x.m_Msg; // shared as-is
+    else
+        m_Protocol.Encrypt(sm.emplace_back(), x.m_Msg);
+
+    WriteSealed(sm);
+}
+
+struct NodeConnection::SealTask
+    :public Executor::TaskAsync
+{
+    std::shared_ptr<SealQueue> m_pQueue;
+    SealQueue::Item* m_pItem;
+    CryptoOffload* m_pOffload;
+
+    // copies of the connection state, at the position reserved for this message
+    ECC::Hash::Mac m_HMac;
+    AES::Encoder m_Enc;
+    AES::StreamCipher m_Cipher;
+
+    virtual void Exec(Executor::Context&) override
+    {
+        SealQueue::Item& x = *m_pItem;
+        x.m_Started_us = GetTime_us();
+
+        ProtocolPlus::Seal(x.m_Msg, m_HMac, m_Enc, m_Cipher);
+
+        std::unique_lock<std::mutex> scope(m_pOffload->m_Mutex);
+        x.m_Done = true;
+        m_pOffload->m_vDone.push_back(std::move(m_pQueue));
+        m_pOffload->m_pEvtDone->post();
+    }
+};
+
+void NodeConnection::WriteMsg(SerializedMsg& sm)
+{
+    if (ProtocolPlus::Mode::Plaintext != m_Protocol.m_Mode)
+    {
+        size_t nSize = 0;
+        for (size_t i = 0; i < sm.size(); i++)
+            nSize += sm[i].size;
+
+        CryptoOffload* pOffload = m_pCryptoOffload;
+        if (!pOffload || !pOffload->ShouldSeal(nSize))
+        {
+            ProtocolPlus::Seal(sm, m_Protocol.m_HMac, m_Protocol.m_Enc, m_Protocol.m_CipherOut);
+            WriteSealed(sm);
+            return;
+        }
+
+        if (!pOffload->m_pEvtDone)
+            pOffload->m_pEvtDone = io::AsyncEvent::create(io::Reactor::get_Current(), [pOffload]() { pOffload->OnDone(); });
+
+        if (!m_pSealQueue)
+        {
+            m_pSealQueue = std::make_shared<SealQueue>();
+            m_pSealQueue->m_pOwner = this;
+        }
+
+        auto pTask = std::make_unique<SealTask>();
+        pTask->m_pQueue = m_pSealQueue;
+        pTask->m_pOffload = pOffload;
+        pTask->m_HMac = m_Protocol.m_HMac;
+        pTask->m_Enc = m_Protocol.m_Enc;
+        pTask->m_Cipher = m_Protocol.m_CipherOut;
+
+        // reserve the cipherstream for this message
+        m_Protocol.m_CipherOut.Skip(m_Protocol.m_Enc, static_cast<uint32_t>(nSize));
+
+        {
+            std::unique_lock<std::mutex> scope(pOffload->m_Mutex);
+
+            SealQueue::Item& x = m_pSealQueue->Add(sm, true);
+            x.m_Dispatched_us = GetTime_us();
+            pTask->m_pItem = &x;
+        }
+
+        pOffload->m_pExecutor->Push(std::move(pTask));
+
+        TestNotDrown();
+        return;
+    }
+
+    WriteSealed(sm);
+}
+
+void NodeConnection::WriteSealed(SerializedMsg& sm)
+{
+    if (m_pSealQueue && !m_pSealQueue->m_lst.empty())
+    {
+        // wait for the preceding messages
+        std::unique_lock<std::mutex> scope(m_pCryptoOffload->m_Mutex);
+        m_pSealQueue->Add(sm, false);
+    }
+    else
+    {
+        io::Result res = m_Connection->write_msg(sm);
+        TestIoResultAsync(res);
+    }
+
+    TestNotDrown();
+}
+
+void NodeConnection::OnSealed()
+{
+    assert(m_pSealQueue && m_pCryptoOffload);
+    CryptoOffload& co = *m_pCryptoOffload;
+    SealQueue& q = *m_pSealQueue;
+
+    while (true)
+    {
+        SerializedMsg sm;
+
+        {
+            std::unique_lock<std::mutex> scope(co.m_Mutex);
+            if (q.m_lst.empty() || !q.m_lst.front().m_Done)
+                break;
+
+            SealQueue::Item& x = q.m_lst.front();
+            sm.swap(x.m_Msg);
+
+            assert(q.m_Size >= x.m_Size);
+            q.m_Size -= x.m_Size;
+
+            if (x.m_Async)
+            {
+                co.m_Stats.m_Queued.Add(x.m_Started_us - x.m_Dispatched_us);
+                co.m_Stats.m_Sealed.Add(GetTime_us() - x.m_Dispatched_us);
+                co.m_Stats.m_Messages++;
+                co.m_Stats.m_Bytes += x.m_Size;
+            }
+
+            q.m_lst.pop_front();
+        }
+
+        if (IsLive())
+        {
+            io::Result res = m_Connection->write_msg(sm);
+            TestIoResultAsync(res);
+        }
+    }
+}
+
+void NodeConnection::CryptoOffload::OnDone()
+{
+    std::vector<std::shared_ptr<SealQueue> > v;
+
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        v.swap(m_vDone);
+    }
+
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        // the connection may already be gone, or reset
+        NodeConnection* pOwner = v[i]->m_pOwner;
+        if (pOwner)
+            pOwner->OnSealed();
+    }
+
+    MaybeLogStats();
+}
+
+void NodeConnection::CryptoOffload::Stats::Reset()
+{
+    m_Queued.Reset();
+    m_Sealed.Reset();
+    m_Messages = 0;
+    m_Bytes = 0;
+    m_LastLog_ms = GetTime_ms();
+}
+
+void NodeConnection::CryptoOffload::MaybeLogStats()
+{
+    if (!m_StatsPeriod_ms || (GetTime_ms() - m_Stats.m_LastLog_ms < m_StatsPeriod_ms))
+        return;
+
+    LOG_INFO() << "Crypto offload: messages=" << m_Stats.m_Messages
+        << ", bytes=" << m_Stats.m_Bytes
+        << ", queued " << m_Stats.m_Queued
+        << ", sealed " << m_Stats.m_Sealed;
+
+    m_Stats.Reset();
+}
+
+bool NodeConnection::Compression::Type::get(Enum& e, uint8_t nCode)
+{
+    switch (nCode)
+    {
+#define THE_MACRO(msg) case msg::s_Code: e = msg; break;
+        BeamNodeMsgsCompressible(THE_MACRO)
+#undef THE_MACRO
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+const char* NodeConnection::Compression::Type::get_Name(Enum e)
+{
+    switch (e)
+    {
+#define THE_MACRO(msg) case msg: return #msg;
+        BeamNodeMsgsCompressible(THE_MACRO)
+#undef THE_MACRO
+
+    default:
+        return "";
+    }
+}
+
+void NodeConnection::Compression::Stats::Reset()
+{
+    ZeroObject(m_p);
+    m_LastLog_ms = GetTime_ms();
+}
+
+void NodeConnection::Compression::MaybeLogStats()
+{
+    if (!m_StatsPeriod_ms || (GetTime_ms() - m_Stats.m_LastLog_ms < m_StatsPeriod_ms))
+        return;
+
+    for (uint32_t i = 0; i < Type::count; i++)
+    {
+        const Stats::PerType& s = m_Stats.m_p[i];
+        if (!(s.m_Sent || s.m_Skipped || s.m_Rcvd))
+            continue;
+
+        LOG_INFO() << "Compression " << Type::get_Name(static_cast<Type::Enum>(i))
+            << ": sent=" << s.m_Sent
+            << ", ratio=" << (s.m_SentPacked ? static_cast<double>(s.m_SentRaw) / s.m_SentPacked : 0.)
+            << ", compress_us=" << s.m_Compress_us
+            << ", skipped=" << s.m_Skipped
+            << ", rcvd=" << s.m_Rcvd
+            << ", ratio=" << (s.m_RcvdPacked ? static_cast<double>(s.m_RcvdRaw) / s.m_RcvdPacked : 0.)
+            << ", decompress_us=" << s.m_Decompress_us;
+    }
+
+    m_Stats.Reset();
+}
+
 /////////////////////////
 // NodeConnection::Server
 void NodeConnection::Server::Listen(const io::Address& addr)
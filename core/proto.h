@@ -71,6 +71,15 @@ namespace proto {
 #define BeamNodeMsg_BodyPack(macro) \
     macro(std::vector<BodyBuffers>, Bodies)
 
+#define BeamNodeMsg_GetBodyCompact(macro) \
+    macro(Block::SystemState::ID, ID)
+
+#define BeamNodeMsg_BodyCompact(macro) \
+    macro(uint64_t, Salt) \
+    macro(std::vector<uint64_t>, Kernels) \
+    macro(Transaction::Ptr, Extra) \
+    macro(Merkle::Hash, Checksum)
+
 #define BeamNodeMsg_GetProofState(macro) \
     macro(Height, Height)
 
@@ -166,6 +175,18 @@ namespace proto {
 #define BeamNodeMsg_GetTransaction(macro) \
     macro(Transaction::KeyType, ID)
 
+#define BeamNodeMsg_TxReconcileReq(macro) \
+    macro(uint64_t, Salt) \
+    macro(uint32_t, SetSize)
+
+#define BeamNodeMsg_TxReconcileSketch(macro) \
+    macro(uint32_t, SetSize) \
+    macro(ByteBuffer, Sketch)
+
+#define BeamNodeMsg_TxReconcileDiff(macro) \
+    macro(std::vector<uint64_t>, Missing) \
+    macro(uint8_t, Fallback)
+
 #define BeamNodeMsg_SetDependentContext(macro) \
     macro(std::unique_ptr<Merkle::Hash>, Context)
 
@@ -290,6 +311,11 @@ namespace proto {
 #define BeamNodeMsg_ContractLogProof(macro) \
     macro(Merkle::Proof, Proof)
 
+#define BeamNodeMsg_Compressed(macro) \
+    macro(uint8_t, Type) \
+    macro(uint32_t, SizeRaw) \
+    macro(ByteBuffer, Data)
+
 #define BeamNodeMsgsAll(macro) \
     /* general msgs */ \
     macro(0x01, Bye) \
@@ -307,6 +333,7 @@ namespace proto {
     macro(0x0d, DataMissing) \
     macro(0x44, Status) \
     macro(0x0f, Login) \
+    macro(0x4c, Compressed) \
     /* blockchain status */ \
     macro(0x10, NewTip) \
     macro(0x11, GetHdr) \
@@ -329,6 +356,8 @@ namespace proto {
     macro(0x25, ProofKernel2) \
     macro(0x26, GetBodyPack) \
     macro(0x27, BodyPack) \
+    macro(0x50, GetBodyCompact) \
+    macro(0x51, BodyCompact) \
     macro(0x28, GetProofShieldedOutp) \
     macro(0x20, GetProofShieldedInp) \
     macro(0x35, GetProofAsset) \
@@ -357,6 +386,9 @@ namespace proto {
     macro(0x31, HaveTransaction) \
     macro(0x32, GetTransaction) \
     macro(0x49, NewTransaction) \
+    macro(0x4d, TxReconcileReq) \
+    macro(0x4e, TxReconcileSketch) \
+    macro(0x4f, TxReconcileDiff) \
     /* dependent context and txs */ \
     macro(0x4a, SetDependentContext) \
     macro(0x4b, DependentContextChanged) \
@@ -406,6 +438,15 @@ namespace proto {
 
         static const uint32_t WantDependentState     = 0x10000; // Please send me dependent state updates
         static_assert(!(WantDependentState  & Extension::Msk));
+
+        static const uint32_t Compression            = 0x20000; // I can decode proto::Compressed
+        static_assert(!(Compression  & Extension::Msk));
+
+        static const uint32_t TxReconcile            = 0x40000; // I support the tx announcements reconciliation (TxReconcileReq/Sketch/Diff)
+        static_assert(!(TxReconcile  & Extension::Msk));
+
+        static const uint32_t CompactBlock           = 0x80000; // I can serve the block bodies in the compact form (GetBodyCompact)
+        static_assert(!(CompactBlock  & Extension::Msk));
 	};
 
     struct IDType
@@ -693,6 +734,11 @@ namespace proto {
         virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) override;
 
         void Encrypt(SerializedMsg&, MsgSerializer&);
+        void Encrypt(io::SharedBuffer&, const SerializedMsg&); // message serialized without MAC. The result is a private copy, MAC appended
+
+        // Encrypt() in 2 steps. Seal() may be invoked in another thread, with the copies of the MAC and cipher state
+        void Finalize(SerializedMsg&, MsgSerializer&); // reserves the MAC, unless plaintext
+        static void Seal(SerializedMsg&, const ECC::Hash::Mac&, const AES::Encoder&, AES::StreamCipher&);
     };
 
     struct INodeMsgHandler
@@ -742,6 +788,18 @@ namespace proto {
 
         SerializedMsg m_SerializeCache;
 
+        struct SealQueue;
+        struct SealTask;
+        std::shared_ptr<SealQueue> m_pSealQueue; // shared with the in-flight seal tasks
+
+        void WriteMsg(SerializedMsg&); // finalized, MAC reserved. Sealed here or offloaded
+        void WriteSealed(SerializedMsg&); // preserves the order wrt messages being sealed
+        void OnSealed();
+
+        template <typename TMsg>
+        bool SendCompressed(uint8_t nCode, const TMsg&); // false if not applicable, should be sent as-is
+        bool SendCompressed(uint8_t nCode, uint32_t iType, const void*, size_t);
+
         void TestIoResultAsync(const io::Result& res);
         void TestInputMsgContext(uint8_t);
 
@@ -791,6 +849,8 @@ namespace proto {
 		virtual void OnMsg(Time&&) override;
 		virtual void OnMsg(Login&&) override;
         virtual void OnMsg(NewTransaction0&&) override;
+        using INodeMsgHandler::OnMsg2;
+        virtual bool OnMsg2(Compressed&&) override; // decompress and dispatch
 
         virtual void GenerateSChannelNonce(ECC::Scalar::Native&); // Must be overridden to support SChannel
 
@@ -870,6 +930,121 @@ namespace proto {
 
         void Send(const NewTransaction&);
 
+        // Message serialized once, to be sent to many peers. Each peer only copies it, appends the MAC and encrypts
+        struct SerializedOnce
+        {
+            SerializedMsg m_Msg; // header + body, no MAC
+
+            bool IsEmpty() const { return m_Msg.empty(); }
+
+            template <typename TMsg>
+            void Set(const TMsg& msg)
+            {
+                MsgSerializer ser(s_FragmentSize, get_Header());
+                ser.new_message(TMsg::s_Code);
+                ser & msg;
+                ser.finalize(m_Msg);
+            }
+
+            static MsgHeader get_Header();
+        };
+
+        void Send(const SerializedOnce&);
+
+        static const size_t s_FragmentSize = 20000;
+
+        // Sealing (MAC + encryption) of large outbound messages in the worker threads, instead of the reactor thread.
+        // The messages are written in the original order. Shared by the connections, must outlive them.
+        struct CryptoOffload
+        {
+            Executor* m_pExecutor = nullptr;
+            size_t m_Threshold = 0; // min message size to seal asynchronously. 0 - disabled
+            uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the latency stats. 0 - never
+
+            struct Stats
+            {
+                LatencyStats m_Queued; // waiting for a worker thread
+                LatencyStats m_Sealed; // until handed back to the connection, including the queue
+                uint64_t m_Messages;
+                uint64_t m_Bytes;
+                uint32_t m_LastLog_ms;
+
+                Stats() { Reset(); }
+                void Reset();
+
+            } m_Stats;
+
+            bool ShouldSeal(size_t nSize) const { return m_pExecutor && m_Threshold && (nSize >= m_Threshold); }
+
+        private:
+            friend class NodeConnection;
+
+            std::mutex m_Mutex;
+            std::vector<std::shared_ptr<SealQueue> > m_vDone; // protected by mutex
+            io::AsyncEvent::Ptr m_pEvtDone;
+
+            void OnDone();
+            void MaybeLogStats();
+        };
+
+        CryptoOffload* m_pCryptoOffload = nullptr;
+
+        // LZ compression of the bulky sync replies, for the peers that announced LoginFlags::Compression.
+        // Decompression is always supported. Used in the reactor thread only
+        struct Compression
+        {
+#define BeamNodeMsgsCompressible(macro) \
+            macro(HdrPack) \
+            macro(Body) \
+            macro(BodyPack) \
+            macro(ShieldedList)
+
+            struct Type
+            {
+                enum Enum {
+#define THE_MACRO(msg) msg,
+                    BeamNodeMsgsCompressible(THE_MACRO)
+#undef THE_MACRO
+                    count
+                };
+
+                static bool get(Enum&, uint8_t nCode);
+                static const char* get_Name(Enum);
+            };
+
+            size_t m_Threshold = 0; // min serialized message size to compress. 0 - disabled
+            uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the stats. 0 - never
+
+            struct Stats
+            {
+                struct PerType
+                {
+                    uint64_t m_Sent;
+                    uint64_t m_SentRaw;
+                    uint64_t m_SentPacked;
+                    uint64_t m_Compress_us;
+                    uint64_t m_Skipped; // didn't shrink, sent as-is
+                    uint64_t m_Rcvd;
+                    uint64_t m_RcvdRaw;
+                    uint64_t m_RcvdPacked;
+                    uint64_t m_Decompress_us;
+                };
+
+                PerType m_p[Type::count];
+                uint32_t m_LastLog_ms;
+
+                Stats() { Reset(); }
+                void Reset();
+
+            } m_Stats;
+
+            void MaybeLogStats();
+        };
+
+        Compression* m_pCompression = nullptr;
+
+        static const uint32_t s_MaxMsgSize = 1024 * 1024 * 10;
+
         struct Server
         {
             io::TcpServer::Ptr m_pServer; // just delete it to stop listening
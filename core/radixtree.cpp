@@ -15,6 +15,15 @@
 #include "radixtree.h"
 #include "ecc_native.h"
 
+#if defined(__GNUC__) || defined(__clang__)
+#	define RADIX_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#	include <xmmintrin.h>
+#	define RADIX_PREFETCH(p) _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0)
+#else
+#	define RADIX_PREFETCH(p)
+#endif
+
 namespace beam {
 
 /////////////////////////////
@@ -162,6 +171,14 @@ bool RadixTree::Goto(CursorBase& cu, const uint8_t* pKey, uint16_t nBits) const
 		if (!p)
 			return false;
 
+		if (!(Node::s_Leaf & p->m_Bits))
+		{
+			// fetch both children while the node key is compared
+			const Joint& x = Cast::Up<Joint>(*p);
+			RADIX_PREFETCH(x.m_ppC[0].get_Strict());
+			RADIX_PREFETCH(x.m_ppC[1].get_Strict());
+		}
+
 		const uint8_t* pKeyNode = get_NodeKey(*p);
 
 		uint16_t nThreshold = std::min<uint16_t>(cu.m_nBits + p->get_Bits(), nBits);
@@ -482,10 +499,149 @@ size_t RadixTree::Count() const
 void RadixHashTree::get_Hash(Merkle::Hash& hv)
 {
 	Node* p = get_Root();
-	if (p)
-		hv = get_Hash(*p, hv);
-	else
+	if (!p)
+	{
 		hv = Zero;
+		return;
+	}
+
+	if (!(Node::s_Leaf & p->m_Bits))
+	{
+		DirtyLevels v;
+		CollectDirty(Cast::Up<MyJoint>(*p), v);
+
+		if (!v.empty())
+		{
+			UpdateDirty(v);
+			OnDirty();
+		}
+	}
+
+	hv = get_Hash(*p, hv);
+}
+
+void RadixHashTree::get_Hash(Merkle::Hash& hv, Executor& ex, uint32_t nSplitDepth, uint32_t nMinDirty)
+{
+	Node* p = get_Root();
+	if (p && !(Node::s_Leaf & p->m_Bits) && nSplitDepth && (ex.get_Threads() > 1) && (CountDirty(Cast::Up<MyJoint>(*p), nMinDirty) >= nMinDirty))
+	{
+		std::vector<MyJoint*> vTops;
+		CollectDirtyAt(Cast::Up<MyJoint>(*p), vTops, nSplitDepth);
+
+		if (vTops.size() > 1)
+		{
+			// Not ExecAll, which would wait for all the queued tasks (such as the verification of the blocks ahead).
+			// The items don't notify, the root is dirty as well, and is finished below
+			ex.ExecItems(static_cast<uint32_t>(vTops.size()), [this, &vTops](uint32_t i)
+			{
+				DirtyLevels v;
+				CollectDirty(*vTops[i], v);
+				UpdateDirty(v);
+			});
+		}
+	}
+
+	get_Hash(hv);
+}
+
+void RadixHashTree::CollectDirtyAt(MyJoint& x, std::vector<MyJoint*>& v, uint32_t nDepth)
+{
+	if (Node::s_Clean & x.m_Bits)
+		return;
+
+	if (!nDepth)
+	{
+		v.push_back(&x);
+		return;
+	}
+
+	for (size_t i = 0; i < _countof(x.m_ppC); i++)
+	{
+		Node& n = *x.m_ppC[i].get_Strict();
+		if (!(Node::s_Leaf & n.m_Bits))
+			CollectDirtyAt(Cast::Up<MyJoint>(n), v, nDepth - 1);
+	}
+}
+
+uint32_t RadixHashTree::CountDirty(MyJoint& x, uint32_t nMax)
+{
+	if ((Node::s_Clean & x.m_Bits) || !nMax)
+		return 0;
+
+	uint32_t n = 1;
+	for (size_t i = 0; (i < _countof(x.m_ppC)) && (n < nMax); i++)
+	{
+		Node& c = *x.m_ppC[i].get_Strict();
+		if (!(Node::s_Leaf & c.m_Bits))
+			n += CountDirty(Cast::Up<MyJoint>(c), nMax - n);
+	}
+
+	return n;
+}
+
+uint32_t RadixHashTree::CollectDirty(MyJoint& x, DirtyLevels& v)
+{
+	if (Node::s_Clean & x.m_Bits)
+		return 0;
+
+	uint32_t h = 0;
+	for (size_t i = 0; i < _countof(x.m_ppC); i++)
+	{
+		Node& n = *x.m_ppC[i].get_Strict();
+		if (!(Node::s_Leaf & n.m_Bits))
+			h = std::max(h, CollectDirty(Cast::Up<MyJoint>(n), v));
+	}
+
+	if (v.size() <= h)
+		v.resize(h + 1);
+	v[h].push_back(&x);
+
+	return h + 1;
+}
+
+void RadixHashTree::UpdateDirty(DirtyLevels& v)
+{
+	// dirty joints are grouped by their height, those at the same height are independent, and hashed in batches
+	for (size_t i = 0; i < v.size(); i++)
+		UpdateDirty(v[i]);
+}
+
+void RadixHashTree::UpdateDirty(std::vector<MyJoint*>& v)
+{
+	const uint32_t nBatch = ECC::Hash::Processor::s_PairsBatch;
+
+	for (size_t i0 = 0; i0 < v.size(); i0 += nBatch)
+	{
+		uint32_t n = static_cast<uint32_t>(std::min<size_t>(nBatch, v.size() - i0));
+
+		Merkle::Hash pHv[nBatch][2];
+		Merkle::Hash* ppOut[nBatch];
+		const Merkle::Hash* ppC[2][nBatch];
+
+		for (uint32_t i = 0; i < n; i++)
+		{
+			MyJoint& x = *v[i0 + i];
+			for (uint32_t j = 0; j < 2; j++)
+			{
+				// children are either leaves or already clean. No notification here, may run on a worker thread
+				Node& nd = *x.m_ppC[j].get_Strict();
+				if (Node::s_Leaf & nd.m_Bits)
+				{
+					ppC[j][i] = &get_LeafHash(nd, pHv[i][j]);
+					nd.m_Bits |= Node::s_Clean;
+				}
+				else
+					ppC[j][i] = &Cast::Up<MyJoint>(nd).m_Hash;
+			}
+
+			ppOut[i] = &x.m_Hash;
+		}
+
+		Merkle::InterpretBatch(ppOut, ppC[0], ppC[1], n);
+
+		for (uint32_t i = 0; i < n; i++)
+			v[i0 + i]->m_Bits |= Node::s_Clean;
+	}
 }
 
 const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
@@ -506,23 +662,120 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 	MyJoint& x = Cast::Up<MyJoint>(n);
 	if (!(Node::s_Clean & x.m_Bits))
 	{
-		ECC::Hash::Processor hp;
-
-		for (size_t i = 0; i < _countof(x.m_ppC); i++)
-		{
-			ECC::Hash::Value hvPlaceholder;
-			hp << get_Hash(*x.m_ppC[i].get_Strict(), hvPlaceholder);
-		}
+		Merkle::Hash pHv[2];
+		const Merkle::Hash& hv0 = get_Hash(*x.m_ppC[0].get_Strict(), pHv[0]);
+		const Merkle::Hash& hv1 = get_Hash(*x.m_ppC[1].get_Strict(), pHv[1]);
 
 		OnDirty();
 
-		hp >> x.m_Hash;
+		Merkle::Interpret(x.m_Hash, hv0, hv1);
 		x.m_Bits |= Node::s_Clean;
 	}
 
 	return x.m_Hash;
 }
 
+void RadixHashTree::LayoutBlock(MyJoint& x, std::vector<MyJoint*>& v, uint32_t nBlockDepth)
+{
+	std::vector<MyJoint*> vBelow;
+
+	size_t i0 = v.size();
+	v.push_back(&x);
+
+	for (uint32_t h = 1; i0 < v.size(); h++)
+	{
+		size_t i1 = v.size();
+		for (; i0 < i1; i0++)
+		{
+			MyJoint& y = *v[i0];
+			for (size_t i = 0; i < _countof(y.m_ppC); i++)
+			{
+				Node& n = *y.m_ppC[i].get_Strict();
+				if (!(Node::s_Leaf & n.m_Bits))
+				{
+					MyJoint* p = &Cast::Up<MyJoint>(n);
+					if (h < nBlockDepth)
+						v.push_back(p);
+					else
+						vBelow.push_back(p);
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < vBelow.size(); i++)
+		LayoutBlock(*vBelow[i], v, nBlockDepth);
+}
+
+void RadixHashTree::Relayout(uint32_t nBlockDepth)
+{
+	Node* pRoot = get_Root();
+	if (!pRoot || (Node::s_Leaf & pRoot->m_Bits))
+		return;
+
+	std::vector<MyJoint*> vOrder;
+	LayoutBlock(Cast::Up<MyJoint>(*pRoot), vOrder, std::max(nBlockDepth, 1U));
+
+	// The joint at the i-th position in the new order goes to the i-th lowest address.
+	// Slots are sorted by address, each remembers the new position of the joint it currently holds
+	typedef std::pair<MyJoint*, uint32_t> Slot;
+	std::vector<Slot> vSlots(vOrder.size());
+	for (uint32_t i = 0; i < vOrder.size(); i++)
+		vSlots[i] = Slot(vOrder[i], i);
+
+	std::sort(vSlots.begin(), vSlots.end());
+
+	auto fnDest = [&vSlots](const Node* p) -> const Node*
+	{
+		if (Node::s_Leaf & p->m_Bits)
+			return p; // leaves stay
+
+		auto it = std::lower_bound(vSlots.begin(), vSlots.end(), Slot(Cast::Up<MyJoint>(Cast::NotConst(p)), 0));
+		assert((vSlots.end() != it) && (it->first == p));
+		return vSlots[it->second].first;
+	};
+
+	struct Saved
+	{
+		uint16_t m_Bits;
+		const Node* m_ppC[2];
+		const uint8_t* m_pKey; // points to a leaf key, stays
+		Merkle::Hash m_Hash;
+	};
+
+	std::vector<Saved> vSaved(vOrder.size());
+
+	for (size_t i = 0; i < vOrder.size(); i++)
+	{
+		const MyJoint& x = *vOrder[i];
+		Saved& s = vSaved[i];
+
+		s.m_Bits = x.m_Bits;
+		s.m_pKey = x.m_pKeyPtr.get_Strict();
+		s.m_Hash = x.m_Hash;
+
+		for (size_t j = 0; j < _countof(x.m_ppC); j++)
+			s.m_ppC[j] = fnDest(x.m_ppC[j].get_Strict());
+	}
+
+	OnDirty(); // before any modification, the image is inconsistent until the rewrite is complete
+
+	for (size_t i = 0; i < vSaved.size(); i++)
+	{
+		MyJoint& x = *vSlots[i].first;
+		const Saved& s = vSaved[i];
+
+		x.m_Bits = s.m_Bits;
+		x.m_pKeyPtr.set_Strict(s.m_pKey);
+		x.m_Hash = s.m_Hash;
+
+		for (size_t j = 0; j < _countof(x.m_ppC); j++)
+			x.m_ppC[j].set_Strict(s.m_ppC[j]);
+	}
+
+	set_Root(vSlots.front().first);
+}
+
 void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
 {
 	uint16_t n = cu.get_Depth();
@@ -862,4 +1115,149 @@ void UtxoTree::Compact::FlushInternal(uint16_t nBitsCommonNext)
 	}
 }
 
+void UtxoTree::Compact::AddNode(const Merkle::Hash& hv, uint16_t nBitsCommon)
+{
+	if (!m_vNodes.empty())
+		FlushInternal(nBitsCommon);
+
+	Node& n = m_vNodes.emplace_back();
+	n.m_Hash = hv;
+	n.m_nBitsCommon = nBitsCommon;
+
+	m_LastCount = 0;
+}
+
+uint32_t UtxoTree::Compact::get_Prefix(const Key& key, uint32_t nBits)
+{
+	static_assert(Key::s_Bytes >= 3, "");
+	assert(nBits <= 24);
+
+	const uint8_t* p = key.V.m_pData;
+	uint32_t n = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+	return n >> (24 - nBits);
+}
+
+struct UtxoTree::Compact::BuildTask
+	:public Executor::TaskSync
+{
+	struct Part
+	{
+		size_t m_i0;
+		size_t m_i1;
+		Merkle::Hash m_Hash;
+		bool m_Valid;
+	};
+
+	std::vector<Part> m_vParts; // per prefix
+	const Key* m_pKeys;
+	uint32_t m_nPrefixBits;
+	std::atomic<uint32_t> m_iNext;
+
+	virtual void Exec(Executor::Context&) override
+	{
+		while (true)
+		{
+			uint32_t i = m_iNext++;
+			if (i >= m_vParts.size())
+				break;
+
+			Part& x = m_vParts[i];
+			if (x.m_i0 == x.m_i1)
+				continue;
+
+			// all the keys of the part should have the same prefix. Given that they're sorted within each part - it's enough to check the edges
+			x.m_Valid =
+				(get_Prefix(m_pKeys[x.m_i0], m_nPrefixBits) == i) &&
+				(get_Prefix(m_pKeys[x.m_i1 - 1], m_nPrefixBits) == i);
+
+			if (!x.m_Valid)
+				continue;
+
+			Compact c;
+			for (size_t iKey = x.m_i0; iKey < x.m_i1; iKey++)
+			{
+				if (!c.Add(m_pKeys[iKey]))
+				{
+					x.m_Valid = false;
+					break;
+				}
+			}
+
+			if (x.m_Valid)
+				c.Flush(x.m_Hash);
+		}
+	}
+};
+
+bool UtxoTree::Compact::Build(Merkle::Hash& hv, const Key* pKeys, size_t nCount, Executor& ex, uint32_t nPrefixBits)
+{
+	nPrefixBits = std::min(nPrefixBits, 16U);
+
+	if (!nPrefixBits || (ex.get_Threads() <= 1))
+	{
+		Compact c;
+		for (size_t i = 0; i < nCount; i++)
+			if (!c.Add(pKeys[i]))
+				return false;
+
+		c.Flush(hv);
+		return true;
+	}
+
+	BuildTask t;
+	t.m_pKeys = pKeys;
+	t.m_nPrefixBits = nPrefixBits;
+	t.m_iNext = 0;
+	t.m_vParts.resize(size_t(1) << nPrefixBits);
+
+	// part boundaries. If the keys are not sorted - it'd be detected by the tasks
+	size_t iPos = 0;
+	for (uint32_t i = 0; i < t.m_vParts.size(); i++)
+	{
+		BuildTask::Part& x = t.m_vParts[i];
+		x.m_i0 = iPos;
+		x.m_Valid = true;
+
+		iPos = std::upper_bound(pKeys + iPos, pKeys + nCount, i, [nPrefixBits](uint32_t nPrefix, const Key& key) {
+			return nPrefix < get_Prefix(key, nPrefixBits);
+		}) - pKeys;
+
+		x.m_i1 = iPos;
+	}
+
+	if (iPos != nCount)
+		return false;
+
+	ex.ExecAll(t);
+
+	// merge. The sub-roots are the nodes at the prefix depth (or deeper), the common bits of the adjacent ones are determined by the prefixes
+	Compact c;
+	uint32_t nPrefixPrev = 0;
+
+	for (uint32_t i = 0; i < t.m_vParts.size(); i++)
+	{
+		const BuildTask::Part& x = t.m_vParts[i];
+		if (!x.m_Valid)
+			return false;
+		if (x.m_i0 == x.m_i1)
+			continue;
+
+		uint16_t nBitsCommon = 0;
+		if (!c.m_vNodes.empty())
+		{
+			uint32_t nOrder = 0;
+			for (uint32_t nDiff = nPrefixPrev ^ i; nDiff; nDiff >>= 1)
+				nOrder++;
+
+			nBitsCommon = static_cast<uint16_t>(nPrefixBits - nOrder);
+		}
+
+		c.AddNode(x.m_Hash, nBitsCommon);
+		nPrefixPrev = i;
+	}
+
+	c.Flush(hv);
+	return true;
+}
+
 } // namespace beam
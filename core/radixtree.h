@@ -166,9 +166,9 @@ public:
 protected:
 	int64_t m_RootOffset;
 
-private:
 	void set_Root(Node*);
 
+private:
 	void DeleteNode(Node*);
 	void ReplaceTip(CursorBase& cu, Node* pNew);
 	bool Traverse(const Node&, ITraveler&) const;
@@ -189,6 +189,14 @@ public:
 	void get_Hash(Merkle::Hash&);
 	void get_Proof(Merkle::Proof&, const CursorBase&);
 
+	// Dirty subtrees at the given depth are recalculated concurrently, then the upper part. The result is the same.
+	// Only if there are at least nMinDirty dirty joints, otherwise it's not worth it.
+	void get_Hash(Merkle::Hash&, Executor&, uint32_t nSplitDepth, uint32_t nMinDirty);
+
+	// Reorders the joints within the memory they already occupy: blocks of nBlockDepth levels, each block breadth-first (van Emde Boas-like).
+	// Lookups then touch fewer cache lines and pages. Cursors are invalidated.
+	void Relayout(uint32_t nBlockDepth = 4);
+
 protected:
 	// RadixTree
 	virtual Joint* CreateJoint() override { return new MyJoint; }
@@ -197,6 +205,16 @@ protected:
 	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&);
 
 	virtual const Merkle::Hash& get_LeafHash(Node&, Merkle::Hash&) = 0;
+
+private:
+	typedef std::vector<std::vector<MyJoint*> > DirtyLevels;
+	static uint32_t CollectDirty(MyJoint&, DirtyLevels&);
+	static void CollectDirtyAt(MyJoint&, std::vector<MyJoint*>&, uint32_t nDepth);
+	static uint32_t CountDirty(MyJoint&, uint32_t nMax);
+	void UpdateDirty(DirtyLevels&);
+	void UpdateDirty(std::vector<MyJoint*>&);
+
+	static void LayoutBlock(MyJoint&, std::vector<MyJoint*>&, uint32_t nBlockDepth);
 };
 
 class RadixHashOnlyTree
@@ -326,9 +344,19 @@ public:
 		Key m_LastKey;
 		Input::Count m_LastCount;
 
+		void AddNode(const Merkle::Hash&, uint16_t nBitsCommon);
+
+		static uint32_t get_Prefix(const Key&, uint32_t nBits);
+
+		struct BuildTask;
+
 	public:
 		bool Add(const Key&);
 		void Flush(Merkle::Hash&);
+
+		// The same as Add() for all the (sorted) keys + Flush(). The keys are split by the leading nPrefixBits,
+		// the sub-roots are built concurrently, then merged. Returns false if the keys are not sorted, or a count overflows.
+		static bool Build(Merkle::Hash&, const Key* pKeys, size_t nCount, Executor&, uint32_t nPrefixBits = 8);
 	};
 
 protected:
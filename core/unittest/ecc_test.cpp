@@ -283,6 +283,92 @@ void TestHash()
 		// hash values must change, even if no explicit input was fed.
 		verify_test(!(hv == hv2));
 	}
+
+	bool bHw = Hash::Processor::s_UseHw;
+	uint32_t nLanes = Hash::Processor::s_Lanes;
+	printf("SHA hw: %s, lanes: %u\n", Hash::Processor::IsHwSupported() ? "supported" : "not supported", Hash::Processor::get_LanesSupported());
+
+	uint8_t pMsg[300];
+	GenRandom(pMsg, sizeof(pMsg));
+
+	std::vector<Hash::Value> pV[2];
+	for (uint32_t iMode = 0; iMode < 2; iMode++)
+	{
+		Hash::Processor::s_UseHw = iMode && bHw;
+
+		// FIPS 180-2 test vectors
+		const char szMsg[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+		Hash::Processor() << beam::Blob(szMsg, 3) >> hv;
+		verify_test(hv == Hash::Value(beam::Blob("\xba\x78\x16\xbf\x8f\x01\xcf\xea\x41\x41\x40\xde\x5d\xae\x22\x23\xb0\x03\x61\xa3\x96\x17\x7a\x9c\xb4\x10\xff\x61\xf2\x00\x15\xad", 32)));
+
+		Hash::Processor() << beam::Blob(szMsg, sizeof(szMsg) - 1) >> hv;
+		verify_test(hv == Hash::Value(beam::Blob("\x24\x8d\x6a\x61\xd2\x06\x38\xb8\xe5\xc0\x26\x93\x0c\x3e\x60\x39\xa3\x3c\xe4\x59\x64\xff\x21\x67\xf6\xec\xed\xd4\x19\xdb\x06\xc1", 32)));
+
+		// all sizes, fed in random portions
+		std::vector<Hash::Value>& v = pV[iMode];
+		v.resize(sizeof(pMsg));
+
+		for (uint32_t n = 0; n < sizeof(pMsg); n++)
+		{
+			Hash::Processor hp;
+			for (uint32_t nDone = 0; nDone < n; )
+			{
+				uint32_t nPortion;
+				GenRandom(&nPortion, sizeof(nPortion));
+				nPortion = std::min(n - nDone, nPortion % 150);
+
+				hp << beam::Blob(pMsg + nDone, nPortion);
+				nDone += nPortion;
+			}
+
+			hp >> v[n];
+		}
+	}
+
+	verify_test(pV[0] == pV[1]);
+
+	// Merkle pairs, multi-buffer: hw, then all the lanes modes
+	Hash::Value pIn[40], pRef[20];
+	for (uint32_t i = 0; i < _countof(pIn); i++)
+		GenRandom(pIn[i]);
+	for (uint32_t i = 0; i < _countof(pRef); i++)
+		Hash::Processor() << pIn[i * 2] << pIn[i * 2 + 1] >> pRef[i];
+
+	const uint32_t pLanes[] = { nLanes, 8, 4, 0 };
+	for (uint32_t iMode = 0; iMode < _countof(pLanes); iMode++)
+	{
+		Hash::Processor::s_UseHw = !iMode && bHw;
+		Hash::Processor::s_Lanes = pLanes[iMode];
+		if (Hash::Processor::s_Lanes > nLanes)
+			continue;
+
+		for (uint32_t nCount = 1; nCount <= _countof(pRef); nCount++)
+		{
+			Hash::Value pOut[_countof(pIn)];
+			std::copy(pIn, pIn + _countof(pIn), pOut);
+
+			Hash::Value* ppOut[_countof(pRef)];
+			const Hash::Value* ppL[_countof(pRef)];
+			const Hash::Value* ppR[_countof(pRef)];
+
+			// in-place, as in the level-by-level tree evaluation
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				ppOut[i] = pOut + i;
+				ppL[i] = pOut + i * 2;
+				ppR[i] = pOut + i * 2 + 1;
+			}
+
+			Hash::Processor::HashPairs(ppOut, ppL, ppR, nCount);
+
+			for (uint32_t i = 0; i < nCount; i++)
+				verify_test(pOut[i] == pRef[i]);
+		}
+	}
+
+	Hash::Processor::s_UseHw = bHw;
+	Hash::Processor::s_Lanes = nLanes;
 }
 
 void TestScalars()
@@ -571,6 +657,71 @@ void TestPoints()
 	p0 += p1;
 	verify_test(p0 == Zero);
 }
+void TestMultiMac()
+{
+	Mode::Scope scope(Mode::Fast);
+
+	// the bucket method vs wNAF vs plain multiplication, incl. zero points and scalars, with prepared points too
+	const uint32_t pCount[] = { 1, 3, 17, 160, 700 };
+
+	for (uint32_t iTest = 0; iTest < _countof(pCount); iTest++)
+	{
+		const uint32_t nCount = pCount[iTest];
+
+		std::vector<Point::Native> vPts(nCount);
+		std::vector<Scalar::Native> vKs(nCount);
+
+		Point::Native ptRef(Zero);
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			if (i % 7)
+				SetRandom(vPts[i]);
+			else
+				vPts[i] = Zero;
+
+			if (i % 5)
+				SetRandom(vKs[i]);
+			else
+			{
+				vKs[i] = Zero;
+				if (!(i % 10))
+					vKs[i] = -Scalar::Native(1U); // max value
+			}
+
+			ptRef += vPts[i] * vKs[i];
+		}
+
+		Scalar::Native kG;
+		SetRandom(kG);
+		Point::Native ptG;
+		Context::get().m_Ipp.G_.Assign(ptG, true);
+		ptRef += ptG * kG;
+
+		for (uint32_t iMode = 0; iMode < 2; iMode++)
+		{
+			MultiMac_Dyn mm;
+			mm.Prepare(nCount, 1);
+			mm.m_BucketsMin = iMode ? 1 : static_cast<uint32_t>(-1);
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				mm.m_pCasual[i].Init(vPts[i]);
+				mm.m_pKCasual[i] = vKs[i];
+			}
+			mm.m_Casual = nCount;
+
+			mm.m_ppPrepared[0] = &Context::get().m_Ipp.G_;
+			mm.m_pKPrep[0] = kG;
+			mm.m_Prepared = 1;
+
+			Point::Native pt;
+			mm.Calculate(pt);
+			verify_test(pt == ptRef);
+		}
+	}
+}
+
 
 void TestSigning()
 {
@@ -1491,6 +1642,70 @@ void TestAES()
 
 	sd.dec.Proceed(pBuf, pBuf); // inplace decode
 	verify_test(!memcmp(pBuf, pPlaintext, sizeof(pPlaintext)));
+
+	// CTR mode, the hw path (if supported) vs software, random portions, counter carry across the 64-bit halves
+	bool bHw = AES::s_UseHw;
+	printf("AES hw: %s\n", AES::IsHwSupported() ? "supported" : "not supported");
+
+	std::vector<uint8_t> pV[2];
+	for (uint32_t iMode = 0; iMode < 2; iMode++)
+	{
+		AES::s_UseHw = iMode && bHw;
+
+		AES::StreamCipher asc;
+		asc.Reset();
+		memset(asc.m_Counter.m_pData, 0xff, asc.m_Counter.nBytes);
+		asc.m_Counter.m_pData[0] = 0;
+		asc.m_Counter.m_pData[asc.m_Counter.nBytes - 1] = 0xfd;
+
+		std::vector<uint8_t>& v = pV[iMode];
+		v.resize(5000);
+		for (size_t i = 0; i < v.size(); i++)
+			v[i] = static_cast<uint8_t>(i);
+
+		for (size_t nDone = 0; nDone < v.size(); )
+		{
+			uint32_t nPortion;
+			GenRandom(&nPortion, sizeof(nPortion));
+			nPortion %= (iMode ? 300 : 7);
+
+			nPortion = static_cast<uint32_t>(std::min(v.size() - nDone, size_t(nPortion)));
+			asc.XCrypt(se.enc, &v.front() + nDone, nPortion);
+			nDone += nPortion;
+		}
+	}
+
+	AES::s_UseHw = bHw;
+	verify_test(pV[0] == pV[1]);
+
+	// portions encrypted by the snapshots, while the stream itself is skipped (concurrent sealing of p2p messages)
+	{
+		AES::StreamCipher asc;
+		asc.Reset();
+		memset(asc.m_Counter.m_pData, 0xff, asc.m_Counter.nBytes);
+		asc.m_Counter.m_pData[0] = 0;
+		asc.m_Counter.m_pData[asc.m_Counter.nBytes - 1] = 0xfd;
+
+		std::vector<uint8_t> v(pV[0].size());
+		for (size_t i = 0; i < v.size(); i++)
+			v[i] = static_cast<uint8_t>(i);
+
+		for (size_t nDone = 0; nDone < v.size(); )
+		{
+			uint32_t nPortion;
+			GenRandom(&nPortion, sizeof(nPortion));
+			nPortion %= 100;
+
+			nPortion = static_cast<uint32_t>(std::min(v.size() - nDone, size_t(nPortion)));
+
+			AES::StreamCipher asc2 = asc;
+			asc.Skip(se.enc, nPortion);
+			asc2.XCrypt(se.enc, &v.front() + nDone, nPortion);
+			nDone += nPortion;
+		}
+
+		verify_test(v == pV[0]);
+	}
 }
 
 void TestKdfPair(Key::IKdf& skdf, Key::IPKdf& pkdf)
@@ -2244,6 +2459,7 @@ void TestAll()
 	TestHash();
 	TestScalars();
 	TestPoints();
+	TestMultiMac();
 	TestSigning();
 	TestCommitments();
 	TestRangeProof(false);
@@ -2576,6 +2792,45 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		bool bHw = Hash::Processor::s_UseHw;
+		uint32_t nLanes = Hash::Processor::s_Lanes;
+
+		Hash::Value pHv[Hash::Processor::s_PairsBatch * 2];
+		for (uint32_t i = 0; i < _countof(pHv); i++)
+			GenRandom(pHv[i]);
+
+		Hash::Value* ppOut[Hash::Processor::s_PairsBatch];
+		const Hash::Value* ppL[Hash::Processor::s_PairsBatch];
+		const Hash::Value* ppR[Hash::Processor::s_PairsBatch];
+		for (uint32_t i = 0; i < Hash::Processor::s_PairsBatch; i++)
+		{
+			ppOut[i] = pHv + i;
+			ppL[i] = pHv + i;
+			ppR[i] = pHv + Hash::Processor::s_PairsBatch + i;
+		}
+
+		for (uint32_t iMode = 0; iMode < 3; iMode++)
+		{
+			Hash::Processor::s_UseHw = (2 == iMode) && bHw;
+			Hash::Processor::s_Lanes = iMode ? nLanes : 0;
+
+			char sz[0x40];
+			snprintf(sz, sizeof(sz), "Hash.Pairs.x8.%s", (2 == iMode) ? "Hw" : iMode ? "Lanes" : "Soft");
+
+			BenchmarkMeter bm(sz);
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+					Hash::Processor::HashPairs(ppOut, ppL, ppR, Hash::Processor::s_PairsBatch);
+
+			} while (bm.ShouldContinue());
+		}
+
+		Hash::Processor::s_UseHw = bHw;
+		Hash::Processor::s_Lanes = nLanes;
+	}
+
 	Hash::Processor() << "abcd" >> hv;
 
 	Signature sig;
@@ -2699,6 +2954,50 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		// casual points: wNAF vs buckets
+		const uint32_t pCount[] = { 64, 160, 512, 2048, 8192 };
+
+		for (uint32_t iTest = 0; iTest < _countof(pCount); iTest++)
+		{
+			const uint32_t nCount = pCount[iTest];
+
+			Mode::Scope scope(Mode::Fast);
+
+			MultiMac_Dyn mm;
+			mm.Prepare(nCount, 0);
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				Point::Native pt;
+				SetRandom(pt);
+				mm.m_pCasual[i].Init(pt);
+				SetRandom(mm.m_pKCasual[i]);
+			}
+
+			for (uint32_t iMode = 0; iMode < 2; iMode++)
+			{
+				mm.m_Casual = nCount;
+				mm.m_BucketsMin = iMode ? 1 : static_cast<uint32_t>(-1);
+
+				char sz[64];
+				snprintf(sz, sizeof(sz), "MultiMac.%s-%u", iMode ? "Buckets" : "wNAF", nCount);
+
+				BenchmarkMeter bm(sz);
+				bm.N = 1;
+				do
+				{
+					for (uint32_t i = 0; i < bm.N; i++)
+					{
+						Point::Native pt;
+						mm.Calculate(pt);
+					}
+
+				} while (bm.ShouldContinue());
+			}
+		}
+	}
+
 	{
 		AES::Encoder enc;
 		enc.Init(hv.m_pData);
@@ -2707,17 +3006,25 @@ void RunBenchmark()
 
 		uint8_t pBuf[0x400];
 
-		BenchmarkMeter bm("AES.XCrypt-1MB");
-		bm.N = 10;
-		do
+		bool bHw = AES::s_UseHw;
+		for (uint32_t iMode = 0; iMode < 2; iMode++)
 		{
-			for (uint32_t i = 0; i < bm.N; i++)
+			AES::s_UseHw = iMode && bHw;
+
+			BenchmarkMeter bm(iMode ? "AES.XCrypt-1MB" : "AES.XCrypt-1MB.Soft");
+			bm.N = 10;
+			do
 			{
-				for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
-					asc.XCrypt(enc, pBuf, sizeof(pBuf));
-			}
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
+						asc.XCrypt(enc, pBuf, sizeof(pBuf));
+				}
 
-		} while (bm.ShouldContinue());
+			} while (bm.ShouldContinue());
+		}
+
+		AES::s_UseHw = bHw;
 	}
 
 	{
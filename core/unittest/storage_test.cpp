@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <iostream>
+#include <string.h>
 #include "../radixtree.h"
 #include "../navigator.h"
 #include "../../utility/serialize.h"
@@ -316,7 +317,10 @@ namespace beam
 		t.get_Hash(hv2);
 		verify_test(hv2 == Zero);
 
-		// construct tree in different order
+		// construct tree in different order, hash the dirty subtrees concurrently
+		ExecutorMT_R ex;
+		ex.set_Threads(4);
+
 		for (uint32_t i = (uint32_t) vKeys.size(); i--; )
 		{
 			const UtxoTree::Key& key = vKeys[i];
@@ -329,15 +333,47 @@ namespace beam
 			SetLeafIDs(t, *p, i, false);
 
 			if (!(i % 11))
-				t.get_Hash(hv2); // try to confuse clean/dirty
+				t.get_Hash(hv2, ex, i % 7, i % 5); // try to confuse clean/dirty
 
 			if (i == vKeys.size()/2)
 			{
-				t.get_Hash(hv2);
+				t.get_Hash(hv2, ex, 4, 0);
 				verify_test(hv2 == hvMid);
 			}
 		}
 
+		t.get_Hash(hv2, ex, 6, 0);
+		verify_test(hv2 == hv1);
+
+		// relayout, the structure must be intact
+		t.Relayout(3);
+		verify_test(vKeys.size() == t.Count());
+
+		for (uint32_t i = 0; i < vKeys.size(); i += 97)
+		{
+			UtxoTree::Cursor cu;
+			bool bCreate = false;
+			UtxoTree::MyLeaf* p = t.Find(cu, vKeys[i], bCreate);
+			verify_test(p);
+
+			Merkle::Proof proof;
+			t.get_Proof(proof, cu);
+
+			Merkle::Hash hvElement;
+			p->get_Hash(hvElement);
+
+			Merkle::Interpret(hvElement, proof);
+			verify_test(hvElement == hv1);
+		}
+
+		for (uint32_t i = 0; i < vKeys.size(); i += 5)
+		{
+			UtxoTree::Cursor cu;
+			bool bCreate = false;
+			verify_test(t.Find(cu, vKeys[i], bCreate));
+			cu.InvalidateElement(); // force rehash
+		}
+
 		t.get_Hash(hv2);
 		verify_test(hv2 == hv1);
 
@@ -393,6 +429,7 @@ namespace beam
 			:public RadixTree::ITraveler
 		{
 			UtxoTree::Compact m_Compact;
+			std::vector<UtxoTree::Key> m_vSorted;
 
 			virtual bool OnLeaf(const RadixTree::Leaf& x) override
 			{
@@ -400,7 +437,10 @@ namespace beam
 				uint32_t nCount = v.get_Count();
 
 				while (nCount--)
+				{
 					verify_test(m_Compact.Add(v.m_Key));
+					m_vSorted.push_back(v.m_Key);
+				}
 
 				return true;
 			}
@@ -410,6 +450,91 @@ namespace beam
 
 		t3.m_Compact.Flush(hv2);
 		verify_test(hv1 == hv2);
+
+		// parallel Compact, different splits
+		for (uint32_t nPrefixBits = 0; nPrefixBits <= 12; nPrefixBits += 3)
+		{
+			verify_test(UtxoTree::Compact::Build(hv2, &t3.m_vSorted.front(), t3.m_vSorted.size(), ex, nPrefixBits));
+			verify_test(hv1 == hv2);
+		}
+
+		verify_test(UtxoTree::Compact::Build(hv2, &t3.m_vSorted.front(), 1, ex));
+		verify_test(UtxoTree::Compact::Build(hv2, nullptr, 0, ex));
+		verify_test(hv2 == Zero);
+
+		std::swap(t3.m_vSorted[3], t3.m_vSorted[t3.m_vSorted.size() - 3]);
+		verify_test(!UtxoTree::Compact::Build(hv2, &t3.m_vSorted.front(), t3.m_vSorted.size(), ex));
+	}
+
+	void TestUtxoLookups(uint32_t nCount)
+	{
+		// random lookups in a large tree, before and after the relayout
+
+		std::vector<UtxoTree::Key> vKeys(nCount);
+		UtxoTree t;
+
+		for (uint32_t i = 0; i < nCount; i++)
+		{
+			UtxoTree::Key::Data d;
+			SetRandomUtxoKey(d);
+			vKeys[i] = d;
+
+			UtxoTree::Cursor cu;
+			bool bCreate = true;
+			UtxoTree::MyLeaf* p = t.Find(cu, vKeys[i], bCreate);
+			if (p && bCreate)
+				p->m_ID = i;
+		}
+
+		Merkle::Hash hv1, hv2;
+		t.get_Hash(hv1);
+
+		std::vector<uint32_t> vIdx(nCount);
+		for (uint32_t i = 0; i < nCount; i++)
+			vIdx[i] = ((uint32_t) rand() * 0x10000 + (uint32_t) rand()) % nCount;
+
+		for (uint32_t iCycle = 0; iCycle < 2; iCycle++)
+		{
+			if (iCycle)
+				t.Relayout();
+
+			uint32_t t0 = GetTime_ms();
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				UtxoTree::Cursor cu;
+				bool bCreate = false;
+				verify_test(t.Find(cu, vKeys[vIdx[i]], bCreate));
+			}
+
+			std::cout << "UtxoTree random lookups x" << nCount << (iCycle ? ", relayout: " : ": ") << (GetTime_ms() - t0) << " ms" << std::endl;
+		}
+
+		t.get_Hash(hv2);
+		verify_test(hv1 == hv2);
+
+		// Compact, sequential vs parallel
+		std::sort(vKeys.begin(), vKeys.end(), [](const UtxoTree::Key& a, const UtxoTree::Key& b) { return a.V < b.V; });
+
+		ExecutorMT_R ex;
+
+		for (uint32_t iCycle = 0; iCycle < 2; iCycle++)
+		{
+			uint32_t t0 = GetTime_ms();
+
+			if (iCycle)
+				verify_test(UtxoTree::Compact::Build(hv2, &vKeys.front(), vKeys.size(), ex));
+			else
+			{
+				UtxoTree::Compact c;
+				for (uint32_t i = 0; i < nCount; i++)
+					verify_test(c.Add(vKeys[i]));
+				c.Flush(hv2);
+			}
+
+			std::cout << "UtxoTree::Compact x" << nCount << (iCycle ? ", parallel: " : ": ") << (GetTime_ms() - t0) << " ms" << std::endl;
+			verify_test(hv1 == hv2);
+		}
 	}
 
 	struct MyMmr
@@ -671,10 +796,14 @@ namespace beam
 
 } // namespace beam
 
-int main()
+int main(int argc, char* argv[])
 {
+	// the full-size lookups benchmark only on demand: storage_test bench
+	bool bBench = (argc > 1) && !strcmp(argv[1], "bench");
+
 	beam::TestNavigator();
 	beam::TestUtxoTree();
+	beam::TestUtxoLookups(bBench ? (1U << 20) : (1U << 12));
 	beam::TestMmr();
 
 	return g_TestsFailed ? -1 : 0;
@@ -853,6 +853,42 @@ private:
         return json2Msg(j, out);
     }
 
+    bool get_contracts_profile(io::SerializedMsg& out) override
+    {
+        const bvm2::Profiler& prof = *_nodeBackend.m_pBvmProfiler;
+
+        bvm2::Profiler::Map m;
+        prof.get_Data(m);
+
+        json jStats = json::array();
+        char buf[80];
+
+        for (const auto& x : m)
+        {
+            const auto& s = x.second;
+            jStats.push_back(
+                json{
+                    {"cid", uint256_to_hex(buf, x.first.m_Cid)},
+                    {"method", x.first.m_iMethod},
+                    {"calls", s.m_Calls},
+                    {"instructions", s.m_Instructions},
+                    {"charge", s.m_Charge},
+                    {"depth", s.m_DepthMax},
+                    {"reads", s.m_Reads},
+                    {"writes", s.m_Writes},
+                    {"time_us", s.m_Time_us}
+                }
+            );
+        }
+
+        json j{
+            {"enabled", prof.m_Enabled.load()},
+            {"stats", jStats}
+        };
+
+        return json2Msg(j, out);
+    }
+
     bool extract_block_from_row(json& out, uint64_t row, Height height) {
         NodeDB& db = _nodeBackend.get_DB();
 
@@ -48,6 +48,9 @@ struct IAdapter {
 
     virtual bool get_contracts(io::SerializedMsg& out) = 0;
     virtual bool get_contract_details(io::SerializedMsg& out, const ByteBuffer& id) = 0;
+
+    /// Contract execution stats, collected since the start (read-only, the collection is enabled by --bvm_profile)
+    virtual bool get_contracts_profile(io::SerializedMsg& out) = 0;
 };
 
 IAdapter::Ptr create_adapter(Node& node);
@@ -37,6 +37,7 @@ struct Options {
     uint32_t logCleanupPeriod;
     ByteBuffer m_RichParser;
     bool m_RichParserChanged = false;
+    bool m_BvmProfile = false;
 };
 
 static bool parse_cmdline(int argc, char* argv[], Options& o);
@@ -98,6 +99,7 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
         (cli::LOG_CLEANUP_DAYS, po::value<uint32_t>()->default_value(5), "old logfiles cleanup period(days)")
         (cli::CONFIG_FILE_PATH, po::value<std::string>()->default_value("explorer-node.cfg"), "path to the config file")
         (cli::CONTRACT_RICH_PARSER, po::value<std::string>(), "Optional shader to parse contract invocation info")
+        (cli::BVM_PROFILE, po::value<bool>()->default_value(false), "collect per contract method execution stats, set at startup (see /contracts_profile)")
     ;
 
     cliOptions.add(createRulesOptionsDescription());
@@ -157,6 +159,8 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
             }
         }
 
+        o.m_BvmProfile = vm[cli::BVM_PROFILE].as<bool>();
+
         auto& vArg = vm[cli::CONTRACT_RICH_PARSER];
         if (!vArg.empty())
         {
@@ -239,4 +243,6 @@ void setup_node(Node& node, const Options& o) {
         node.m_Cfg.m_ProcessorParams.m_RichInfoFlags |= NodeProcessor::StartParams::RichInfo::UpdShader;
         node.m_Cfg.m_ProcessorParams.m_RichParser = o.m_RichParser;
     }
+
+    node.m_Cfg.m_ProcessorParams.m_BvmProfile = o.m_BvmProfile;
 }
\ No newline at end of file
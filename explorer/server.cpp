@@ -41,6 +41,7 @@ enum Dirs {
 #endif  // BEAM_ATOMIC_SWAP_SUPPORT
     , DIR_CONTRACTS
     , DIR_CONTRACT_DETAILS
+    , DIR_CONTRACTS_PROFILE
     // etc
 };
 
@@ -131,6 +132,7 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
 #endif  // BEAM_ATOMIC_SWAP_SUPPORT
         , { "contracts", DIR_CONTRACTS }
         , { "contract", DIR_CONTRACT_DETAILS }
+        , { "contracts_profile", DIR_CONTRACTS_PROFILE }
     };
 
     const HttpConnection::Ptr& conn = it->second;
@@ -165,6 +167,9 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
             case DIR_CONTRACT_DETAILS:
                 func = &Server::send_contract_details;
                 break;
+            case DIR_CONTRACTS_PROFILE:
+                func = &Server::send_contracts_profile;
+                break;
             default:
                 break;
         }
@@ -281,6 +286,13 @@ bool Server::send_contract_details(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
+bool Server::send_contracts_profile(const HttpConnection::Ptr& conn) {
+    if (!_backend.get_contracts_profile(_body))
+        return send(conn, 500, "Internal error #3");
+
+    return send(conn, 200, "OK");
+}
+
 bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message) {
     assert(conn);
 
@@ -186,6 +186,9 @@ void NodeDB::Close()
         BEAM_VERIFY(SQLITE_OK == sqlite3_close(m_pDb));
 		m_pDb = NULL;
 	}
+
+	m_KrnFilter.Invalidate();
+	m_UniqueFilter.Invalidate();
 }
 
 NodeDB::Recordset::Recordset()
@@ -349,13 +352,20 @@ const void* NodeDB::Recordset::get_BlobStrict(int col, uint32_t n)
 	return x.p;
 }
 
-void NodeDB::Open(const char* szPath)
+void NodeDB::Open(const char* szPath, bool bWal /* = false */)
 {
 	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_CREATE, NULL));
 	// Attempt to fix the "busy" error when PC goes to sleep and then awakes. Try the busy handler with non-zero timeout (maybe a single retry would be enough)
 	sqlite3_busy_timeout(m_pDb, 5000);
 
-	ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+	// journal mode is persistent, set it explicitly in either case
+	if (bWal)
+		ExecTextOut("PRAGMA journal_mode = WAL");
+	else
+	{
+		ExecTextOut("PRAGMA journal_mode = DELETE");
+		ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+	}
 	ExecTextOut("PRAGMA journal_size_limit=1048576"); // limit journal file, otherwise it may remain huge even after tx commit, until the app is closed
 
 	bool bCreate;
@@ -453,6 +463,14 @@ void NodeDB::Open(const char* szPath)
 	t.Commit();
 }
 
+void NodeDB::OpenReader(const char* szPath)
+{
+	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL));
+	sqlite3_busy_timeout(m_pDb, 5000);
+
+	// no scheme creation/migration, the DB must be already opened by the writer
+}
+
 void NodeDB::CheckIntegrity()
 {
 	std::string s = ExecTextOut("PRAGMA integrity_check");
@@ -2175,6 +2193,8 @@ void NodeDB::InsertKernel(const Blob& key, Height h)
 	rs.put(1, h);
 	rs.Step();
 	TestChanged1Row();
+
+	m_KrnFilter.Insert(key);
 }
 
 void NodeDB::DeleteKernel(const Blob& key, Height h)
@@ -2197,10 +2217,17 @@ void NodeDB::DeleteKernel(const Blob& key, Height h)
 
 Height NodeDB::FindKernel(const Blob& key)
 {
+	FilterEnsureKrn();
+	if (!m_KrnFilter.MayContain(key))
+		return Rules::HeightGenesis - 1;
+
 	Recordset rs(*this, Query::KernelFind, "SELECT " TblKernels_Height " FROM " TblKernels " WHERE " TblKernels_Key "=? ORDER BY " TblKernels_Height " DESC LIMIT 1");
 	rs.put(0, key);
 	if (!rs.Step())
+	{
+		m_KrnFilter.m_Stats.m_FalsePositive++;
 		return Rules::HeightGenesis - 1;
+	}
 
 	Height h;
 	rs.get(0, h);
@@ -2325,9 +2352,41 @@ void NodeDB::StreamMmr::ShrinkTo(uint64_t nCount)
 void NodeDB::StreamMmr::ResizeTo(uint64_t nCount)
 {
 	m_DB.StreamResize(m_eType, get_TotalHashes(nCount, m_hStoreFrom) * sizeof(Merkle::Hash), get_TotalHashes(m_Count, m_hStoreFrom) * sizeof(Merkle::Hash));
+
+	if (nCount < m_Count)
+		CacheTruncate(nCount, m_Count);
+
 	m_Count = nCount;
 }
 
+void NodeDB::StreamMmr::set_Cache(const CacheParams& cp)
+{
+	m_vCacheEx.clear();
+	m_CacheExShift = 0;
+
+	if (cp.m_Entries)
+	{
+		uint8_t nBits = 0;
+		while ((nBits < 31) && ((2U << nBits) <= cp.m_Entries))
+			nBits++;
+
+		CacheEntryEx ce;
+		ce.m_X = static_cast<uint64_t>(-1);
+		ce.m_H = 0;
+		m_vCacheEx.resize(static_cast<size_t>(1) << nBits, ce);
+		m_CacheExShift = 64 - nBits;
+	}
+
+	m_hPinned = cp.m_hPinned;
+	m_vPinned.clear();
+}
+
+double NodeDB::StreamMmr::Stats::get_HitRate() const
+{
+	uint64_t nTotal = m_Hits + m_HitsPinned + m_Misses;
+	return nTotal ? static_cast<double>(m_Hits + m_HitsPinned) / static_cast<double>(nTotal) : 0.;
+}
+
 void NodeDB::StreamMmr::LoadElement(Merkle::Hash& hv, const Merkle::Position& pos) const
 {
 	if (CacheFind(hv, pos))
@@ -2343,6 +2402,45 @@ void NodeDB::StreamMmr::SaveElement(const Merkle::Hash& hv, const Merkle::Positi
 	CacheAdd(hv, pos);
 }
 
+NodeDB::StreamMmr::CacheEntryEx* NodeDB::StreamMmr::CacheExFind(const Merkle::Position& pos)
+{
+	if (m_vCacheEx.empty() || (pos.H >= m_hPinned))
+		return nullptr;
+
+	if (m_vCacheEx.size() == 1)
+		return &m_vCacheEx.front();
+
+	uint64_t k = (pos.X ^ (static_cast<uint64_t>(pos.H) << 56)) * 0x9e3779b97f4a7c15ULL; // fibonacci hashing, top bits are well-mixed
+	return &m_vCacheEx[static_cast<size_t>(k >> m_CacheExShift)];
+}
+
+NodeDB::StreamMmr::CacheEntry* NodeDB::StreamMmr::PinnedFind(const Merkle::Position& pos, bool bCreate)
+{
+	if (pos.H < m_hPinned)
+		return nullptr;
+
+	uint32_t iH = pos.H - m_hPinned;
+	if (m_vPinned.size() <= iH)
+	{
+		if (!bCreate)
+			return nullptr;
+		m_vPinned.resize(iH + 1);
+	}
+
+	auto& v = m_vPinned[iH];
+	if (v.size() <= pos.X)
+	{
+		if (!bCreate)
+			return nullptr;
+
+		CacheEntry ce;
+		ce.m_X = static_cast<uint64_t>(-1);
+		v.resize(static_cast<size_t>(pos.X + 1), ce);
+	}
+
+	return &v[static_cast<size_t>(pos.X)];
+}
+
 bool NodeDB::StreamMmr::CacheFind(Merkle::Hash& hv, const Merkle::Position& pos) const
 {
 	// Note: ALWAYS test the main cache BEFORE m_LastOut, coz that element could already be overwritten
@@ -2352,16 +2450,37 @@ bool NodeDB::StreamMmr::CacheFind(Merkle::Hash& hv, const Merkle::Position& pos)
 		if (ce.m_X == pos.X)
 		{
 			hv = ce.m_Value;
+			m_Stats.m_Hits++;
 			return true;
 		}
 	}
 
+	StreamMmr& x = Cast::NotConst(*this);
+
+	const CacheEntry* pE = x.PinnedFind(pos, false);
+	if (pE && (pE->m_X == pos.X))
+	{
+		hv = pE->m_Value;
+		m_Stats.m_HitsPinned++;
+		return true;
+	}
+
+	const CacheEntryEx* pEx = x.CacheExFind(pos);
+	if (pEx && (pEx->m_X == pos.X) && (pEx->m_H == pos.H))
+	{
+		hv = pEx->m_Value;
+		m_Stats.m_Hits++;
+		return true;
+	}
+
 	if ((m_LastOut.m_Pos.H == pos.H) && (m_LastOut.m_Pos.X == pos.X))
 	{
 		hv = m_LastOut.m_Value;
+		m_Stats.m_Hits++;
 		return true;
 	}
 
+	m_Stats.m_Misses++;
 	return false;
 }
 
@@ -2381,6 +2500,84 @@ void NodeDB::StreamMmr::CacheAdd(const Merkle::Hash& hv, const Merkle::Position&
 		ce.m_Value = hv;
 		ce.m_X = pos.X;
 	}
+
+	CacheEntry* pE = PinnedFind(pos, true);
+	if (pE)
+	{
+		pE->m_Value = hv;
+		pE->m_X = pos.X;
+	}
+	else
+	{
+		CacheEntryEx* pEx = CacheExFind(pos);
+		if (pEx)
+		{
+			pEx->m_Value = hv;
+			pEx->m_X = pos.X;
+			pEx->m_H = pos.H;
+		}
+	}
+}
+
+void NodeDB::StreamMmr::CacheErase(const Merkle::Position& pos)
+{
+	if (pos.H < _countof(m_pCache))
+	{
+		CacheEntry& ce = m_pCache[pos.H];
+		if (ce.m_X == pos.X)
+			ce.m_X = static_cast<uint64_t>(-1);
+	}
+
+	if ((m_LastOut.m_Pos.H == pos.H) && (m_LastOut.m_Pos.X == pos.X))
+		m_LastOut.m_Pos.X = static_cast<uint64_t>(-1);
+
+	CacheEntry* pE = PinnedFind(pos, false);
+	if (pE)
+		pE->m_X = static_cast<uint64_t>(-1);
+
+	CacheEntryEx* pEx = CacheExFind(pos);
+	if (pEx && (pEx->m_X == pos.X) && (pEx->m_H == pos.H))
+		pEx->m_X = static_cast<uint64_t>(-1);
+}
+
+void NodeDB::StreamMmr::CacheTruncate(uint64_t nCount, uint64_t nCount0)
+{
+	// At height H only the elements with X < (nCount >> H) exist. Remove the rest, they may be re-created with different values.
+	assert(nCount < nCount0);
+
+	if (nCount0 - nCount <= 0x100)
+	{
+		Merkle::Position pos;
+		for (pos.H = 0; (pos.H < Merkle::Position::HMax) && (nCount0 >> pos.H); pos.H++)
+			for (pos.X = nCount >> pos.H; pos.X < (nCount0 >> pos.H); pos.X++)
+				CacheErase(pos);
+
+		return;
+	}
+
+	// massive rollback. Scan the caches instead
+	for (uint8_t h = 0; h < _countof(m_pCache); h++)
+	{
+		CacheEntry& ce = m_pCache[h];
+		if ((ce.m_X != static_cast<uint64_t>(-1)) && (ce.m_X >= (nCount >> h)))
+			ce.m_X = static_cast<uint64_t>(-1);
+	}
+
+	if ((m_LastOut.m_Pos.H < Merkle::Position::HMax) && (m_LastOut.m_Pos.X >= (nCount >> m_LastOut.m_Pos.H)))
+		m_LastOut.m_Pos.X = static_cast<uint64_t>(-1);
+
+	for (uint32_t iH = 0; iH < m_vPinned.size(); iH++)
+	{
+		uint32_t h = m_hPinned + iH;
+		uint64_t nMax = (h < Merkle::Position::HMax) ? (nCount >> h) : 0;
+		auto& v = m_vPinned[iH];
+		if (v.size() > nMax)
+			v.resize(static_cast<size_t>(nMax));
+	}
+
+	for (auto& ce : m_vCacheEx)
+		if ((ce.m_X != static_cast<uint64_t>(-1)) && (ce.m_X >= (nCount >> ce.m_H)))
+			ce.m_X = static_cast<uint64_t>(-1);
 }
 
 NodeDB::StatesMmr::StatesMmr(NodeDB& db)
@@ -2544,14 +2741,26 @@ bool NodeDB::UniqueInsertSafe(const Blob& key, const Blob* pVal)
 	if (pVal)
 		rs.put(1, *pVal);
 
-	return rs.StepModifySafe();
+	if (!rs.StepModifySafe())
+		return false;
+
+	m_UniqueFilter.Insert(key);
+	return true;
 }
 
 bool NodeDB::UniqueFind(const Blob& key, Recordset& rs)
 {
+	FilterEnsureUnique();
+	if (!m_UniqueFilter.MayContain(key))
+		return false;
+
 	rs.Reset(*this, Query::UniqueFind, "SELECT " TblUnique_Value " FROM " TblUnique " WHERE " TblUnique_Key "=?");
 	rs.put(0, key);
-	return rs.Step();
+	if (rs.Step())
+		return true;
+
+	m_UniqueFilter.m_Stats.m_FalsePositive++;
+	return false;
 }
 
 void NodeDB::UniqueDeleteStrict(const Blob& key)
@@ -2567,6 +2776,122 @@ void NodeDB::UniqueDeleteAll()
 {
 	Recordset rs(*this, Query::UniqueDelAll, "DELETE FROM " TblUnique);
 	rs.Step();
+
+	m_UniqueFilter.Invalidate();
+}
+
+void NodeDB::FilterEnsure(KeyFilter& f, Query::Enum eQuery, const char* szSql)
+{
+	if (f.IsValid())
+		return;
+
+	std::vector<uint64_t> vHashes;
+
+	for (Recordset rs(*this, eQuery, szSql); rs.Step(); )
+	{
+		Blob key;
+		rs.get(0, key);
+		vHashes.push_back(KeyFilter::get_Hash(key));
+	}
+
+	f.Reset(vHashes.size() * 2);
+	for (uint64_t hash : vHashes)
+		f.Insert(hash);
+}
+
+void NodeDB::FilterEnsureKrn()
+{
+	FilterEnsure(m_KrnFilter, Query::KernelEnumKeys, "SELECT " TblKernels_Key " FROM " TblKernels);
+}
+
+void NodeDB::FilterEnsureUnique()
+{
+	FilterEnsure(m_UniqueFilter, Query::UniqueEnumKeys, "SELECT " TblUnique_Key " FROM " TblUnique);
+}
+
+void NodeDB::KeyFilter::Invalidate()
+{
+	m_vBits.clear();
+	m_Mask = 0;
+	m_Keys = 0;
+	m_Capacity = 0;
+}
+
+void NodeDB::KeyFilter::Reset(uint64_t nCapacity)
+{
+	std::setmax(nCapacity, s_CapacityMin);
+
+	uint64_t nBits = 0x40;
+	while (nBits < nCapacity * s_BitsPerKey)
+		nBits <<= 1;
+
+	m_vBits.assign(static_cast<size_t>(nBits >> 6), 0);
+	m_Mask = nBits - 1;
+	m_Keys = 0;
+	m_Capacity = nCapacity;
+}
+
+uint64_t NodeDB::KeyFilter::get_Hash(const Blob& key)
+{
+	// FNV-1a + murmur finalizer. Keys are mostly hashes or points, but may share a common prefix
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (uint32_t i = 0; i < key.n; i++)
+		h = (h ^ reinterpret_cast<const uint8_t*>(key.p)[i]) * 0x100000001b3ULL;
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	return h;
+}
+
+void NodeDB::KeyFilter::Insert(uint64_t hash)
+{
+	if (!IsValid())
+		return; // will be rebuilt on demand
+
+	if (++m_Keys > m_Capacity)
+	{
+		Invalidate(); // too dense, rebuild with the bigger capacity
+		return;
+	}
+
+	uint64_t h2 = (hash >> 32) | 1;
+	for (uint32_t i = 0; i < s_Hashes; i++, hash += h2)
+	{
+		uint64_t iBit = hash & m_Mask;
+		m_vBits[static_cast<size_t>(iBit >> 6)] |= 1ULL << (iBit & 0x3f);
+	}
+}
+
+void NodeDB::KeyFilter::Insert(const Blob& key)
+{
+	if (IsValid())
+		Insert(get_Hash(key));
+}
+
+bool NodeDB::KeyFilter::MayContain(const Blob& key)
+{
+	uint64_t hash = get_Hash(key);
+	uint64_t h2 = (hash >> 32) | 1;
+
+	for (uint32_t i = 0; i < s_Hashes; i++, hash += h2)
+	{
+		uint64_t iBit = hash & m_Mask;
+		if (!(m_vBits[static_cast<size_t>(iBit >> 6)] & (1ULL << (iBit & 0x3f))))
+		{
+			m_Stats.m_Negative++;
+			return false;
+		}
+	}
+
+	m_Stats.m_Positive++;
+	return true;
+}
+
+double NodeDB::KeyFilter::Stats::get_FpRate() const
+{
+	uint64_t nNegatives = m_Negative + m_FalsePositive;
+	return nNegatives ? (static_cast<double>(m_FalsePositive) / nNegatives) : 0.;
 }
 
 void NodeDB::get_CacheState(CacheState& cs)
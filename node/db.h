@@ -63,6 +63,7 @@ public:
 			ForbiddenState,
 			Flags1, // used for 2-stage migration, where the 2nd stage is performed by the Processor
 			CacheState,
+			ShieldedImageStamp,
 		};
 	};
 
@@ -152,6 +153,7 @@ public:
 			KernelIns,
 			KernelFind,
 			KernelDel,
+			KernelEnumKeys,
 			TxoAdd,
 			TxoDel,
 			TxoDelFrom,
@@ -169,6 +171,7 @@ public:
 			UniqueFind,
 			UniqueDel,
 			UniqueDelAll,
+			UniqueEnumKeys,
 			CacheIns,
 			CacheFind,
 			CacheEnumByHit,
@@ -241,7 +244,8 @@ public:
 	virtual ~NodeDB();
 
 	void Close();
-	void Open(const char* szPath);
+	void Open(const char* szPath, bool bWal = false); // WAL mode allows concurrent readers (the DB isn't locked exclusively then)
+	void OpenReader(const char* szPath); // read-only connection to the DB opened in WAL mode. Use Transaction for a consistent snapshot
 	bool IsOpen() const
 	{
 		return nullptr != m_pDb;
@@ -602,6 +606,25 @@ public:
 		void ShrinkTo(uint64_t nCount);
 		void ResizeTo(uint64_t nCount);
 
+		struct CacheParams
+		{
+			uint32_t m_Entries = 0x4000; // random-access cache size, rounded down to power of 2. 0 = disabled
+			uint8_t m_hPinned = 8; // elements at this height and above are never evicted. HMax = none
+		};
+
+		void set_Cache(const CacheParams&);
+
+		struct Stats
+		{
+			uint64_t m_Hits = 0;
+			uint64_t m_HitsPinned = 0;
+			uint64_t m_Misses = 0;
+
+			double get_HitRate() const;
+		};
+
+		const Stats& get_Stats() const { return m_Stats; }
+
 	protected:
 		// Mmr
 		virtual void LoadElement(Merkle::Hash& hv, const Merkle::Position& pos) const override;
@@ -623,8 +646,28 @@ public:
 			Merkle::Position m_Pos;
 		} m_LastOut;
 
+		// Random-access cache (direct-mapped), for proofs of arbitrary elements
+		struct CacheEntryEx
+			:public CacheEntry
+		{
+			uint8_t m_H;
+		};
+
+		std::vector<CacheEntryEx> m_vCacheEx;
+		uint8_t m_CacheExShift = 0;
+
+		// Upper levels, indexed by X per height. They're shared by all the proofs, and relatively small
+		uint8_t m_hPinned = Merkle::Position::HMax;
+		std::vector<std::vector<CacheEntry> > m_vPinned;
+
+		mutable Stats m_Stats;
+
 		bool CacheFind(Merkle::Hash& hv, const Merkle::Position& pos) const;
 		void CacheAdd(const Merkle::Hash& hv, const Merkle::Position& pos);
+		void CacheErase(const Merkle::Position& pos);
+		void CacheTruncate(uint64_t nCount, uint64_t nCount0);
+		CacheEntryEx* CacheExFind(const Merkle::Position& pos);
+		CacheEntry* PinnedFind(const Merkle::Position& pos, bool bCreate);
 	};
 
 	class StatesMmr
@@ -648,6 +691,42 @@ public:
 	void UniqueDeleteStrict(const Blob& key);
 	void UniqueDeleteAll();
 
+	// Resident bloom prefilter for kernel IDs and unique keys. Most of the lookups are negative, those are answered w/o the DB.
+	// Built lazily from the DB, deleted keys are not removed (they only raise the false-positive rate until the next rebuild).
+	struct KeyFilter
+	{
+		static const uint32_t s_Hashes = 7;
+		static const uint32_t s_BitsPerKey = 10; // ~1% false-positives at full capacity
+		static const uint64_t s_CapacityMin = 0x10000;
+
+		struct Stats
+		{
+			uint64_t m_Negative = 0; // answered by the filter
+			uint64_t m_Positive = 0; // passed to the DB
+			uint64_t m_FalsePositive = 0; // passed to the DB, but not found there
+
+			double get_FpRate() const;
+		} m_Stats;
+
+		bool IsValid() const { return !m_vBits.empty(); }
+		void Invalidate();
+		void Reset(uint64_t nCapacity);
+
+		static uint64_t get_Hash(const Blob&);
+		void Insert(uint64_t hash);
+		void Insert(const Blob&);
+		bool MayContain(const Blob&);
+
+	private:
+		std::vector<uint64_t> m_vBits;
+		uint64_t m_Mask = 0; // bit index mask, size is a power of 2
+		uint64_t m_Keys = 0; // inserted since the last rebuild, including deleted ones
+		uint64_t m_Capacity = 0;
+	};
+
+	const KeyFilter::Stats& get_KrnFilterStats() const { return m_KrnFilter.m_Stats; }
+	const KeyFilter::Stats& get_UniqueFilterStats() const { return m_UniqueFilter.m_Stats; }
+
 	void CacheInsert(const Blob& key, const Blob& data);
 	bool CacheFind(const Blob& key, ByteBuffer&);
 	void CacheSetMaxSize(uint64_t);
@@ -784,6 +863,12 @@ private:
 	void CreateTables29();
 	void ExecQuick(const char*);
 	std::string ExecTextOut(const char*);
+
+	KeyFilter m_KrnFilter;
+	KeyFilter m_UniqueFilter;
+	void FilterEnsure(KeyFilter&, Query::Enum, const char* szSql);
+	void FilterEnsureKrn();
+	void FilterEnsureUnique();
 	bool ExecStep(sqlite3_stmt*);
 	int ExecStepRaw(sqlite3_stmt*);
 	bool ExecStep(Query::Enum, const char*); // returns true while there's a row
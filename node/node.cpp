@@ -377,6 +377,7 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 		Height hCountExtra = t.m_sidTrg.m_Height - t.m_Key.first.m_Height;
 
 		proto::GetBodyPack msg;
+		bool bCompact = false;
 
 		if (t.m_Key.first.m_Height <= m_Processor.m_SyncData.m_Target.m_Height)
 		{
@@ -398,9 +399,18 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 			msg.m_Top.m_Height = t.m_sidTrg.m_Height;
 			m_Processor.get_DB().get_StateHash(t.m_sidTrg.m_Row, msg.m_Top.m_Hash);
 			msg.m_CountExtra = hCountExtra;
+
+			bCompact = !hCountExtra && p.IsCompactBlockWanted();
 		}
 
-		p.Send(msg);
+		if (bCompact)
+		{
+			proto::GetBodyCompact msgCompact;
+			msgCompact.m_ID = msg.m_Top;
+			p.Send(msgCompact);
+		}
+		else
+			p.Send(msg);
 
 		t.m_nCount = std::min(static_cast<uint32_t>(msg.m_CountExtra), m_Cfg.m_BandwidthCtl.m_MaxBodyPackCount) + 1; // just an estimate, the actual num of blocks can be smaller
 		m_nTasksPackBody += t.m_nCount;
@@ -654,6 +664,8 @@ void Node::Processor::OnNewState()
     proto::NewTip msg;
     msg.m_Description = m_Cursor.m_Full;
 
+    proto::NodeConnection::SerializedOnce msgSer; // lazy
+
     for (PeerList::iterator it = get_ParentObj().m_lstPeers.begin(); get_ParentObj().m_lstPeers.end() != it; ++it)
     {
         Peer& peer = *it;
@@ -671,7 +683,10 @@ void Node::Processor::OnNewState()
 				continue;
 		}
 
-        peer.Send(msg);
+        if (msgSer.IsEmpty())
+            msgSer.Set(msg);
+
+        peer.Send(msgSer);
     }
 
     get_ParentObj().RefreshCongestions();
@@ -790,6 +805,7 @@ void Node::Processor::OnRolledBack()
     }
 
     get_ParentObj().m_TxDependent.Clear();
+	get_ParentObj().m_BodyCache.Clear();
 
 	IObserver* pObserver = get_ParentObj().m_Cfg.m_Observer;
 	if (pObserver)
@@ -800,7 +816,7 @@ void Node::Processor::MyExecutorMT::RunThread(uint32_t iThread)
 {
     MyExecutor::MyContext ctx;
     ctx.m_iThread = iThread;
-    ECC::InnerProduct::BatchContext::Scope scope(ctx.m_BatchCtx);
+    ECC::InnerProduct::BatchContext::Scope scope(*ctx.m_pBatchCtx);
 
     RunThreadCtx(ctx);
 }
@@ -933,6 +949,8 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
     m_lstPeers.push_back(*pPeer);
 
 	pPeer->m_UnsentHiMark = m_Cfg.m_BandwidthCtl.m_Drown;
+	pPeer->m_pCryptoOffload = &m_CryptoOffload;
+	pPeer->m_pCompression = &m_Compression;
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
@@ -969,7 +987,15 @@ void Node::Initialize(IExternalPOW* externalPOW)
 
     m_Processor.m_ExecutorMT.set_Threads(std::max<uint32_t>(m_Cfg.m_VerificationThreads, 1U));
 
+    m_SealExecutor.set_Threads(std::max<uint32_t>(m_Cfg.m_SealOffloadThreads, 1U)); // threads are started on demand
+    m_CryptoOffload.m_pExecutor = &m_SealExecutor;
+    m_CryptoOffload.m_Threshold = m_Cfg.m_SealOffloadThreshold;
+    m_Compression.m_Threshold = m_Cfg.m_CompressThreshold;
+
     m_Processor.m_Horizon = m_Cfg.m_Horizon;
+    if (m_Cfg.m_DbReaders)
+        m_Cfg.m_ProcessorParams.m_Wal = true;
+
     m_Processor.Initialize(m_Cfg.m_sPathLocal.c_str(), m_Cfg.m_ProcessorParams);
 
 	if (m_Cfg.m_ProcessorParams.m_EraseSelfID)
@@ -984,6 +1010,9 @@ void Node::Initialize(IExternalPOW* externalPOW)
     InitKeys();
     InitIDs();
 
+    if (m_Cfg.m_DbReaders)
+        m_DbReaders.Start(m_Cfg.m_sPathLocal, m_Cfg.m_DbReaders);
+
     LOG_INFO() << "Node ID=" << m_MyPublicID;
     LOG_INFO() << "Initial Tip: " << m_Processor.m_Cursor.m_ID;
 	LOG_INFO() << "Tx replication is OFF";
@@ -1185,6 +1214,9 @@ Node::~Node()
     }
     m_Miner.m_vThreads.clear();
 
+    m_DbReaders.Stop();
+    m_SealExecutor.Stop();
+
     for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; ++it)
         it->m_LoginFlags = 0; // prevent re-assigning of tasks in the next loop
 
@@ -1288,6 +1320,11 @@ void Node::Peer::SetupLogin(proto::Login& msg)
 	if (m_This.m_PostStartSynced)
 		msg.m_Flags |= proto::LoginFlags::SpreadingTransactions; // indicate ability to receive and broadcast transactions
 
+	if (m_This.m_Cfg.m_TxReconcile.m_Enabled)
+		msg.m_Flags |= proto::LoginFlags::TxReconcile;
+
+	msg.m_Flags |= proto::LoginFlags::CompactBlock; // always served
+
 	if (m_This.m_Cfg.m_Bbs.IsEnabled())
 		msg.m_Flags |= proto::LoginFlags::Bbs; // indicate ability to receive and broadcast BBS messages
 }
@@ -1627,7 +1664,16 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 
 	SetTxCursor(nullptr);
 
+	if (m_pDbRead)
+		m_pDbRead->m_pPeer = nullptr;
+	if (m_pAlive)
+		*m_pAlive = false;
+
     m_This.m_lstPeers.erase(PeerList::s_iterator_to(*this));
+
+    if (Flags::TxFlood & m_Flags)
+        m_This.m_TxAnnounce.OnFloodPeerGone();
+
     delete this;
 }
 
@@ -2018,6 +2064,18 @@ bool Node::Peer::GetBlock(proto::BodyBuffers& out, const NodeDB::StateID& sid, c
 		ThrowUnexpected();
 	}
 
+	BodyCache::Entry::Key::Type key;
+	bool bCache = m_This.m_BodyCache.MakeKey(key, sid, msg, bActive);
+	if (bCache)
+	{
+		const proto::BodyBuffers* pCached = m_This.m_BodyCache.Find(key);
+		if (pCached)
+		{
+			out = *pCached;
+			return true;
+		}
+	}
+
 	if (!m_This.m_Processor.GetBlock(sid, pE, pP, msg.m_Height0, msg.m_HorizonLo1, msg.m_HorizonHi1, bActive))
 		return false;
 
@@ -2046,9 +2104,146 @@ bool Node::Peer::GetBlock(proto::BodyBuffers& out, const NodeDB::StateID& sid, c
 		ser.swap_buf(out.m_Perishable);
 	}
 
+	if (bCache)
+		m_This.m_BodyCache.Insert(key, out);
+
+	return true;
+}
+
+int Node::BodyCache::Entry::Key::Type::cmp(const Type& v) const
+{
+	if (m_Row < v.m_Row)
+		return -1;
+	if (m_Row > v.m_Row)
+		return 1;
+	if (m_h0 < v.m_h0)
+		return -1;
+	if (m_h0 > v.m_h0)
+		return 1;
+	if (m_hLo1 < v.m_hLo1)
+		return -1;
+	if (m_hLo1 > v.m_hLo1)
+		return 1;
+	if (m_hHi1 < v.m_hHi1)
+		return -1;
+	if (m_hHi1 > v.m_hHi1)
+		return 1;
+	if (m_FlagE != v.m_FlagE)
+		return (m_FlagE < v.m_FlagE) ? -1 : 1;
+	if (m_FlagP != v.m_FlagP)
+		return (m_FlagP < v.m_FlagP) ? -1 : 1;
+	return 0;
+}
+
+size_t Node::BodyCache::Entry::get_Size() const
+{
+	return sizeof(*this) + m_Body.m_Eternal.size() + m_Body.m_Perishable.size();
+}
+
+void Node::BodyCache::Delete(Entry& x)
+{
+	m_Keys.erase(KeySet::s_iterator_to(x.m_Key));
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+
+	assert(m_Size >= x.get_Size());
+	m_Size -= x.get_Size();
+
+	delete &x;
+}
+
+void Node::BodyCache::ShrinkTo(size_t n)
+{
+	while (m_Size > n)
+		Delete(m_Mru.back().get_ParentObj());
+}
+
+void Node::BodyCache::Clear()
+{
+	ShrinkTo(0);
+}
+
+bool Node::BodyCache::MakeKey(Entry::Key::Type& key, const NodeDB::StateID& sid, const proto::GetBodyPack& msg, bool bActive)
+{
+	Node& n = get_ParentObj();
+	if (!n.m_Cfg.m_BandwidthCtl.m_BodyCacheSize)
+		return false;
+
+	NodeProcessor& p = n.m_Processor;
+	if (p.IsFastSync())
+		return false;
+
+	if ((m_TxoLo != p.m_Extra.m_TxoLo) || (m_TxoHi != p.m_Extra.m_TxoHi))
+	{
+		// horizons moved, some blocks may not be available anymore
+		Clear();
+		m_TxoLo = p.m_Extra.m_TxoLo;
+		m_TxoHi = p.m_Extra.m_TxoHi;
+	}
+
+	Height h = sid.m_Height;
+	if ((msg.m_HorizonLo1 > msg.m_HorizonHi1) || (msg.m_Height0 >= h) || (h > p.m_Cursor.m_ID.m_Height))
+		return false; // let the processor handle this
+
+	// Outputs are cut wrt their spend heights. Those may change only for heights above the current cursor.
+	key.m_hHi1 = std::max(msg.m_HorizonHi1, h);
+	if (key.m_hHi1 > p.m_Cursor.m_ID.m_Height)
+		return false;
+
+	key.m_hLo1 = std::max(msg.m_HorizonLo1, h - 1);
+
+	// h0 matters only if some inputs may be omitted. Otherwise only whether it's below genesis matters
+	if (key.m_hLo1 < h)
+		key.m_h0 = (msg.m_Height0 >= Rules::HeightGenesis) ? Rules::HeightGenesis : 0;
+	else
+		key.m_h0 = msg.m_Height0;
+
+	if (!bActive && !(NodeDB::StateFlags::Active & p.get_DB().GetStateFlags(sid.m_Row)))
+		return false; // non-active rows may be deleted and reused
+
+	key.m_Row = sid.m_Row;
+	key.m_FlagE = msg.m_FlagE;
+	key.m_FlagP = msg.m_FlagP;
+
 	return true;
 }
 
+const proto::BodyBuffers* Node::BodyCache::Find(const Entry::Key::Type& val)
+{
+	Entry::Key key;
+	key.m_Value = val;
+
+	KeySet::iterator it = m_Keys.find(key);
+	if (m_Keys.end() == it)
+		return nullptr;
+
+	Entry& x = it->get_ParentObj();
+	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	m_Mru.push_front(x.m_Mru);
+
+	return &x.m_Body;
+}
+
+void Node::BodyCache::Insert(const Entry::Key::Type& val, const proto::BodyBuffers& body)
+{
+	size_t nMaxSize = get_ParentObj().m_Cfg.m_BandwidthCtl.m_BodyCacheSize;
+
+	std::unique_ptr<Entry> pEntry(new Entry);
+	pEntry->m_Key.m_Value = val;
+	pEntry->m_Body = body;
+
+	size_t nSize = pEntry->get_Size();
+	if (nSize > nMaxSize)
+		return;
+
+	ShrinkTo(nMaxSize - nSize);
+
+	m_Keys.insert(pEntry->m_Key);
+	m_Mru.push_front(pEntry->m_Mru);
+	m_Size += nSize;
+
+	pEntry.release();
+}
+
 bool Node::Peer::ShouldAcceptBodyPack()
 {
     Task& t = get_FirstTask();
@@ -2137,6 +2332,53 @@ void Node::Peer::OnMsg(proto::BodyPack&& msg)
 	OnFirstTaskDone(eStatus);
 }
 
+bool Node::Peer::IsCompactBlockWanted() const
+{
+	return
+		m_This.m_Cfg.m_CompactBlocks.m_Enabled &&
+		(proto::LoginFlags::CompactBlock & m_LoginFlags);
+}
+
+void Node::Peer::OnMsg(proto::GetBodyCompact&& msg)
+{
+	const proto::NodeConnection::SerializedOnce* pMsg = m_This.m_CompactBlocks.Get(msg.m_ID);
+	if (pMsg)
+		Send(*pMsg);
+	else
+		Send(proto::DataMissing());
+}
+
+void Node::Peer::OnMsg(proto::BodyCompact&& msg)
+{
+	Task& t = get_FirstTask();
+
+	if (!t.m_Key.second || !t.m_Key.first.m_Height || !msg.m_Extra)
+		ThrowUnexpected();
+
+	CompactBlocks& cb = m_This.m_CompactBlocks; // alias
+	cb.m_Stats.m_Blocks++;
+	cb.m_Stats.m_Bytes += TxAnnounce::get_MsgSize(msg);
+
+	proto::Body msgBody;
+	if (cb.Rebuild(msgBody.m_Body, msg))
+	{
+		cb.m_Stats.m_Rebuilt++;
+		cb.m_Stats.m_BytesFull += msgBody.m_Body.m_Perishable.size() + msgBody.m_Body.m_Eternal.size();
+		cb.MaybeLogStats();
+
+		OnMsg(std::move(msgBody));
+	}
+	else
+	{
+		cb.MaybeLogStats();
+
+		// fallback to the full body. The task remains assigned
+		proto::GetBody msgOut;
+		msgOut.m_ID = t.m_Key.first;
+		Send(msgOut);
+	}
+}
+
 void Node::Peer::OnFirstTaskDone(NodeProcessor::DataStatus::Enum eStatus)
 {
     if (NodeProcessor::DataStatus::Invalid == eStatus)
@@ -2188,6 +2430,8 @@ void Node::OnTransactionDeferred(Transaction::Ptr&& pTx, std::unique_ptr<Merkle:
     else
         txd.m_Sender = Zero;
 
+    txd.m_Received_us = GetTime_us();
+
     //if (m_Cfg.m_LogTxFluff)
     //{
     //    Transaction::KeyType key;
@@ -2209,11 +2453,22 @@ void Node::OnTransactionDeferred(Transaction::Ptr&& pTx, std::unique_ptr<Merkle:
 
 void Node::TxDeferred::OnSchedule()
 {
-    if (!m_lst.empty())
+    uint32_t nMaxInFlight = get_ParentObj().m_Cfg.m_TxPipeline.m_MaxInFlight;
+    if (nMaxInFlight)
+    {
+        PushBatch();
+
+        if (m_InFlight >= nMaxInFlight)
+            cancel(); // will be resumed when some batch is done
+    }
+    else
     {
-        TxDeferred::Element& x = m_lst.front();
-        get_ParentObj().OnTransaction(std::move(x.m_pTx), std::move(x.m_pCtx), &x.m_Sender, x.m_Fluff, nullptr);
-        m_lst.pop_front();
+        if (!m_lst.empty())
+        {
+            TxDeferred::Element& x = m_lst.front();
+            get_ParentObj().OnTransaction(std::move(x.m_pTx), std::move(x.m_pCtx), &x.m_Sender, x.m_Fluff, nullptr);
+            m_lst.pop_front();
+        }
     }
 
     if (m_lst.empty())
@@ -2221,6 +2476,246 @@ void Node::TxDeferred::OnSchedule()
 
 }
 
+void Node::TxDeferred::Verified::ValidateAndSummarize(Height h)
+{
+    m_Ctx.Reset();
+    m_Ctx.m_Height.m_Min = h + 1;
+    m_Valid = m_Ctx.ValidateAndSummarize(*m_pTx, m_pTx->get_Reader());
+}
+
+void Node::TxDeferred::Batch::Verify()
+{
+    // The batch context is shared by all the txs. Don't use the one of the executor thread, since it may contain pending block verification data
+    {
+        ECC::InnerProduct::BatchContextEx<4> bc;
+        ECC::InnerProduct::BatchContext::Scope scope(bc);
+
+        for (auto& v : m_lst)
+            v.ValidateAndSummarize(m_Height);
+
+        if (bc.Flush())
+            return;
+    }
+
+    // at least one tx is invalid. Find the culprit(s)
+    m_Fallback = true;
+
+    for (auto& v : m_lst)
+    {
+        if (!v.m_Valid)
+            continue;
+
+        ECC::InnerProduct::BatchContextEx<4> bc;
+        ECC::InnerProduct::BatchContext::Scope scope(bc);
+
+        v.ValidateAndSummarize(m_Height);
+        if (v.m_Valid)
+            v.m_Valid = bc.Flush();
+    }
+}
+
+struct Node::TxDeferred::Task
+    :public Executor::TaskAsync
+{
+    TxDeferred* m_pThis;
+    std::unique_ptr<Batch> m_pBatch;
+
+    virtual void Exec(Executor::Context&) override
+    {
+        m_pBatch->Verify();
+        m_pBatch->m_Verified_us = GetTime_us();
+
+        std::unique_lock<std::mutex> scope(m_pThis->m_MutexDone);
+        m_pThis->m_lstDone.push_back(std::move(m_pBatch));
+        m_pThis->m_pEvtDone->post();
+    }
+};
+
+void Node::TxDeferred::PushBatch()
+{
+    const Config::TxPipeline& cfg = get_ParentObj().m_Cfg.m_TxPipeline;
+    if (m_lst.empty() || (m_InFlight >= cfg.m_MaxInFlight))
+        return;
+
+    uint32_t nMax = std::min(cfg.m_MaxInFlight - m_InFlight, std::max(cfg.m_BatchSize, 1U));
+
+    if (!m_pEvtDone)
+        m_pEvtDone = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { OnBatchesDone(); });
+
+    auto pTask = std::make_unique<Task>();
+    pTask->m_pThis = this;
+    pTask->m_pBatch = std::make_unique<Batch>();
+
+    Batch& b = *pTask->m_pBatch;
+    b.m_Height = get_ParentObj().m_Processor.m_Cursor.m_ID.m_Height;
+    b.m_Dispatched_us = GetTime_us();
+
+    for (uint32_t i = 0; (i < nMax) && !m_lst.empty(); i++, m_lst.pop_front())
+    {
+        Verified& v = b.m_lst.emplace_back();
+        v.m_Elem = std::move(m_lst.front());
+        v.m_pTx = v.m_Elem.m_pTx.get();
+
+        m_Stats.m_Queued.Add(b.m_Dispatched_us - v.m_Elem.m_Received_us);
+    }
+
+    m_InFlight += static_cast<uint32_t>(b.m_lst.size());
+    m_Stats.m_Batches++;
+
+    get_ParentObj().m_Processor.m_ExecutorMT.Push(std::move(pTask));
+}
+
+void Node::TxDeferred::OnBatchesDone()
+{
+    while (true)
+    {
+        std::unique_ptr<Batch> pBatch;
+
+        {
+            std::unique_lock<std::mutex> scope(m_MutexDone);
+            if (m_lstDone.empty())
+                break;
+
+            pBatch = std::move(m_lstDone.front());
+            m_lstDone.pop_front();
+        }
+
+        OnBatchDone(*pBatch);
+    }
+
+    if (!m_lst.empty())
+        start();
+
+    MaybeLogStats();
+}
+
+void Node::TxDeferred::OnBatchDone(Batch& b)
+{
+    uint32_t nCount = static_cast<uint32_t>(b.m_lst.size());
+    assert(m_InFlight >= nCount);
+    m_InFlight -= nCount;
+
+    m_Stats.m_ContextFree.Add(b.m_Verified_us - b.m_Dispatched_us);
+    if (b.m_Fallback)
+        m_Stats.m_BatchFallbacks++;
+
+    Node& n = get_ParentObj();
+
+    // context-free verification depends on the height (fork rules)
+    bool bStale = (b.m_Height != n.m_Processor.m_Cursor.m_ID.m_Height);
+    if (bStale)
+        m_Stats.m_Stale += nCount;
+
+    for (auto& v : b.m_lst)
+    {
+        if (!(bStale || v.m_Valid))
+            m_Stats.m_Rejected++;
+
+        uint64_t t0_us = GetTime_us();
+
+        m_pVerified = bStale ? nullptr : &v;
+        n.OnTransaction(std::move(v.m_Elem.m_pTx), std::move(v.m_Elem.m_pCtx), &v.m_Elem.m_Sender, v.m_Elem.m_Fluff, nullptr);
+        m_pVerified = nullptr;
+
+        m_Stats.m_Context.Add(GetTime_us() - t0_us);
+    }
+}
+
+bool Node::TxDeferred::get_Verified(Transaction::Context& ctx, const Transaction& tx, bool& bValid) const
+{
+    if (!m_pVerified || (m_pVerified->m_pTx != &tx))
+        return false;
+
+    bValid = m_pVerified->m_Valid && ctx.Merge(m_pVerified->m_Ctx);
+    return true;
+}
+
+void Node::TxDeferred::Stats::Reset()
+{
+    m_Queued.Reset();
+    m_ContextFree.Reset();
+    m_Context.Reset();
+    m_Batches = 0;
+    m_BatchFallbacks = 0;
+    m_Rejected = 0;
+    m_Stale = 0;
+    m_LastLog_ms = GetTimeNnz_ms();
+}
+
+void Node::TxAnnounce::Stats::Reset()
+{
+    m_Txs = 0;
+    m_BytesFlood = 0;
+    m_BytesRecon = 0;
+    m_Rounds = 0;
+    m_Failed = 0;
+    m_Diff = 0;
+    m_LastLog_ms = GetTimeNnz_ms();
+}
+
+template <typename TMsg>
+size_t Node::TxAnnounce::get_MsgSize(const TMsg& msg)
+{
+    SerializerSizeCounter ssc;
+    ssc & msg;
+    return ssc.m_Counter.m_Value + MsgHeader::SIZE;
+}
+
+void Node::TxAnnounce::MaybeLogStats()
+{
+    uint32_t nPeriod_ms = get_ParentObj().m_Cfg.m_TxReconcile.m_StatsPeriod_ms;
+    if (!nPeriod_ms || (GetTime_ms() - m_Stats.m_LastLog_ms < nPeriod_ms))
+        return;
+
+    double kTx = m_Stats.m_Txs ? (1. / m_Stats.m_Txs) : 0.;
+
+    LOG_INFO() << "Tx announcements: txs=" << m_Stats.m_Txs
+        << ", flood bytes/tx=" << m_Stats.m_BytesFlood * kTx
+        << ", recon bytes/tx=" << m_Stats.m_BytesRecon * kTx
+        << ", rounds=" << m_Stats.m_Rounds
+        << ", failed=" << m_Stats.m_Failed
+        << ", diff=" << m_Stats.m_Diff;
+
+    m_Stats.Reset();
+}
+
+void Node::TxAnnounce::OnFloodPeerGone()
+{
+    PeerList& lst = get_ParentObj().m_lstPeers; // alias
+    for (PeerList::iterator it = lst.begin(); lst.end() != it; ++it)
+    {
+        Peer& peer = *it;
+        if ((Peer::Flags::Accepted & peer.m_Flags) || !peer.IsTxReconciling())
+            continue;
+
+        peer.m_Flags |= Peer::Flags::TxFlood;
+
+        auto& v = peer.m_TxReconcile.m_vPending; // alias
+        peer.AnnounceTxs(v, false);
+        v.clear();
+        break;
+    }
+}
+
+void Node::TxDeferred::MaybeLogStats()
+{
+    uint32_t nPeriod_ms = get_ParentObj().m_Cfg.m_TxPipeline.m_StatsPeriod_ms;
+    if (!nPeriod_ms || (GetTime_ms() - m_Stats.m_LastLog_ms < nPeriod_ms))
+        return;
+
+    LOG_INFO() << "Tx pipeline: batches=" << m_Stats.m_Batches
+        << ", fallbacks=" << m_Stats.m_BatchFallbacks
+        << ", rejected=" << m_Stats.m_Rejected
+        << ", stale=" << m_Stats.m_Stale
+        << ", InFlight=" << m_InFlight
+        << ", Deferred=" << m_lst.size()
+        << "\n\tQueued: " << m_Stats.m_Queued
+        << "\n\tContext-free: " << m_Stats.m_ContextFree
+        << "\n\tContext: " << m_Stats.m_Context;
+
+    m_Stats.Reset();
+}
+
 uint8_t Node::OnTransaction(Transaction::Ptr&& pTx, std::unique_ptr<Merkle::Hash>&& pCtx, const PeerID* pSender, bool bFluff, std::ostream* pExtraInfo)
 {
     return 
@@ -2270,7 +2765,11 @@ uint8_t Node::ValidateTx2(Transaction::Context& ctx, const Transaction& tx, uint
 {
     ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
 
-    if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
+    bool bValid;
+    if (!m_TxDeferred.get_Verified(ctx, tx, bValid))
+        bValid = m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader());
+
+    if (!(bValid && ctx.IsValidTransaction()))
     {
         if (pExtraInfo)
             *pExtraInfo << "Context-free validation failed";
@@ -2836,9 +3335,7 @@ uint8_t Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, std::ostream* pExtra
 void Node::OnTransactionFluff(TxPool::Fluff::Element& x, const PeerID* pSender)
 {
     m_TxPool.SetState(x, TxPool::Fluff::State::Fluffed);
-
-    proto::HaveTransaction msgOut;
-    msgOut.m_ID = x.m_Tx.m_Key;
+    m_TxAnnounce.m_Stats.m_Txs++;
 
     for (PeerList::iterator it2 = m_lstPeers.begin(); m_lstPeers.end() != it2; ++it2)
     {
@@ -2848,10 +3345,11 @@ void Node::OnTransactionFluff(TxPool::Fluff::Element& x, const PeerID* pSender)
         if (!(peer.m_LoginFlags & proto::LoginFlags::SpreadingTransactions) || peer.IsChocking())
             continue;
 
-        peer.Send(msgOut);
+        peer.AnnounceTx(x.m_Tx.m_Key);
         peer.SetTxCursor(x.m_pSend);
     }
 
+    m_TxAnnounce.MaybeLogStats();
     m_Miner.SoftRestart();
 }
 
@@ -3008,6 +3506,9 @@ void Node::Peer::OnLogin(proto::Login&& msg, uint32_t nFlagsPrev)
     MaybeSendSerif();
     MaybeSendDependent();
 
+	if ((m_LoginFlags ^ nFlagsPrev) & proto::LoginFlags::TxReconcile)
+		OnTxReconcileChanged();
+
 	if (b != ShouldFinalizeMining()) {
 		// stupid compiler insists on parentheses!
 		m_This.m_Miner.OnFinalizerChanged(b ? NULL : this);
@@ -3081,54 +3582,198 @@ void Node::Peer::BroadcastTxs()
 			continue; // already deleted
         auto& x = *m_pCursorTx->m_pThis;
 
-		proto::HaveTransaction msgOut;
-		msgOut.m_ID = x.m_Tx.m_Key;
-		Send(msgOut);
+		AnnounceTx(x.m_Tx.m_Key);
 
 		nExtra += x.m_Profit.m_Stats.m_Size;
 		if (IsChocking(nExtra))
 			break;
 	}
 }
-void Node::Peer::BroadcastBbs()
+
+bool Node::Peer::IsTxReconciling() const
 {
-	m_This.m_Bbs.MaybeCleanup();
+	return
+		m_This.m_Cfg.m_TxReconcile.m_Enabled &&
+		(proto::LoginFlags::TxReconcile & m_LoginFlags) &&
+		!(Flags::TxFlood & m_Flags);
+}
 
-	if (!(proto::LoginFlags::Bbs & m_LoginFlags))
-		return;
+void Node::Peer::AnnounceTx(const Transaction::KeyType& key)
+{
+	if (IsTxReconciling())
+	{
+		auto& v = m_TxReconcile.m_vPending; // alias
+		if (v.size() >= m_This.m_Cfg.m_TxReconcile.m_MaxPending)
+		{
+			AnnounceTxs(v, false);
+			v.clear();
+		}
 
-	if (IsChocking())
-		return;
+		v.push_back(key);
+	}
+	else
+	{
+		proto::HaveTransaction msgOut;
+		msgOut.m_ID = key;
+		Send(msgOut);
 
-	size_t nExtra = 0;
+		m_This.m_TxAnnounce.m_Stats.m_BytesFlood += TxAnnounce::get_MsgSize(msgOut);
+	}
+}
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbsLite wlk;
+void Node::Peer::AnnounceTxs(const std::vector<Transaction::KeyType>& v, bool bRecon)
+{
+	proto::HaveTransaction msgOut;
+	size_t nSize = TxAnnounce::get_MsgSize(msgOut);
 
-	wlk.m_ID = m_CursorBbs;
-	for (db.EnumAllBbsSeq(wlk); wlk.MoveNext(); )
+	for (size_t i = 0; i < v.size(); i++)
 	{
-		proto::BbsHaveMsg msgOut;
-		msgOut.m_Key = wlk.m_Key;
+		msgOut.m_ID = v[i];
 		Send(msgOut);
-
-		nExtra += wlk.m_Size;
-		if (IsChocking(nExtra))
-			break;
 	}
 
-	m_CursorBbs = wlk.m_ID;
+	(bRecon ? m_This.m_TxAnnounce.m_Stats.m_BytesRecon : m_This.m_TxAnnounce.m_Stats.m_BytesFlood) += nSize * v.size();
 }
 
-void Node::Peer::MaybeSendSerif()
+template <typename TMsg>
+void Node::Peer::SendTxReconcile(const TMsg& msg)
 {
-    if (!(Flags::Viewer & m_Flags) || (Flags::SerifSent & m_Flags))
-        return;
+	Send(msg);
+	m_This.m_TxAnnounce.m_Stats.m_BytesRecon += TxAnnounce::get_MsgSize(msg);
+}
 
-    proto::EventsSerif msg;
+void Node::Peer::OnTxReconcileChanged()
+{
+	const Config::TxReconcile& cfg = m_This.m_Cfg.m_TxReconcile;
 
-    Blob blob(msg.m_Value);
-    m_This.m_Processor.get_DB().ParamGet(NodeDB::ParamID::EventsSerif, &msg.m_Height, &blob);
+	if (cfg.m_Enabled && (proto::LoginFlags::TxReconcile & m_LoginFlags))
+	{
+		if (Flags::Accepted & m_Flags)
+			return; // the outbound side initiates the rounds
+
+		uint32_t nFlood = 0;
+		for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; ++it)
+			if (Flags::TxFlood & it->m_Flags)
+				nFlood++;
+
+		if (nFlood < cfg.m_FloodPeers)
+			m_Flags |= Flags::TxFlood;
+
+		if (!m_TxReconcile.m_pTimer)
+			m_TxReconcile.m_pTimer = io::Timer::create(io::Reactor::get_Current());
+
+		m_TxReconcile.m_pTimer->start(cfg.m_Period_ms, true, [this]() { OnTxReconcileTimer(); });
+	}
+	else
+	{
+		m_Flags &= ~Flags::TxFlood;
+		if (m_TxReconcile.m_pTimer)
+			m_TxReconcile.m_pTimer->cancel();
+
+		// announce whatever is pending
+		AnnounceTxs(m_TxReconcile.m_vRound, false);
+		AnnounceTxs(m_TxReconcile.m_vPending, false);
+
+		m_TxReconcile.m_vRound.clear();
+		m_TxReconcile.m_vPending.clear();
+		m_TxReconcile.m_Requested = false;
+		m_TxReconcile.m_Serving = false;
+	}
+}
+
+void Node::Peer::TakeTxReconcileRound()
+{
+	auto& v = m_TxReconcile.m_vRound; // alias
+	v.clear();
+	v.swap(m_TxReconcile.m_vPending);
+
+	std::sort(v.begin(), v.end());
+	v.erase(std::unique(v.begin(), v.end()), v.end());
+
+	// skip those already gone from the pool
+	size_t n = 0;
+	for (size_t i = 0; i < v.size(); i++)
+	{
+		TxPool::Fluff::Element::Tx key;
+		key.m_Key = v[i];
+		if (m_This.m_TxPool.m_setTxs.end() != m_This.m_TxPool.m_setTxs.find(key))
+			v[n++] = v[i];
+	}
+	v.resize(n);
+}
+
+void Node::Peer::get_TxReconcileSketch(TxPool::Sketch& sk, uint32_t nCells) const
+{
+	sk.Reset(nCells);
+	for (size_t i = 0; i < m_TxReconcile.m_vRound.size(); i++)
+		sk.Add(TxPool::Sketch::get_ShortID(m_TxReconcile.m_vRound[i], m_TxReconcile.m_Salt));
+}
+
+void Node::Peer::OnTxReconcileTimer()
+{
+	if (m_TxReconcile.m_Requested)
+	{
+		if (GetTime_ms() - m_TxReconcile.m_Requested_ms >= m_This.m_Cfg.m_TxReconcile.m_Timeout_ms)
+		{
+			LOG_WARNING() << "Peer " << m_RemoteAddr << " tx reconciliation timeout";
+			DeleteSelf(false, ByeReason::Timeout);
+		}
+		return;
+	}
+
+	if (IsChocking())
+		return;
+
+	TakeTxReconcileRound();
+	ECC::GenRandom(&m_TxReconcile.m_Salt, sizeof(m_TxReconcile.m_Salt));
+
+	proto::TxReconcileReq msg;
+	msg.m_Salt = m_TxReconcile.m_Salt;
+	msg.m_SetSize = static_cast<uint32_t>(m_TxReconcile.m_vRound.size());
+	SendTxReconcile(msg);
+
+	m_TxReconcile.m_Requested = true;
+	m_TxReconcile.m_Requested_ms = GetTime_ms();
+}
+void Node::Peer::BroadcastBbs()
+{
+	m_This.m_Bbs.MaybeCleanup();
+
+	if (!(proto::LoginFlags::Bbs & m_LoginFlags))
+		return;
+
+	if (IsChocking())
+		return;
+
+	size_t nExtra = 0;
+
+	NodeDB& db = m_This.m_Processor.get_DB();
+	NodeDB::WalkerBbsLite wlk;
+
+	wlk.m_ID = m_CursorBbs;
+	for (db.EnumAllBbsSeq(wlk); wlk.MoveNext(); )
+	{
+		proto::BbsHaveMsg msgOut;
+		msgOut.m_Key = wlk.m_Key;
+		Send(msgOut);
+
+		nExtra += wlk.m_Size;
+		if (IsChocking(nExtra))
+			break;
+	}
+
+	m_CursorBbs = wlk.m_ID;
+}
+
+void Node::Peer::MaybeSendSerif()
+{
+    if (!(Flags::Viewer & m_Flags) || (Flags::SerifSent & m_Flags))
+        return;
+
+    proto::EventsSerif msg;
+
+    Blob blob(msg.m_Value);
+    m_This.m_Processor.get_DB().ParamGet(NodeDB::ParamID::EventsSerif, &msg.m_Height, &blob);
 
     Send(msg);
     m_Flags |= Flags::SerifSent;
@@ -3219,7 +3864,445 @@ void Node::Peer::OnMsg(proto::GetTransaction&& msg)
     if (m_This.m_TxPool.m_setTxs.end() == it)
         return; // don't have it
 
-    SendTx(it->get_ParentObj().m_pValue, true);
+    Transaction::Ptr& pTx = it->get_ParentObj().m_pValue;
+    if (get_Ext() >= 9)
+        Send(m_This.m_TxSerialized.Get(pTx));
+    else
+        SendTx(pTx, true); // old peers get NewTransaction0
+}
+
+void Node::Peer::OnMsg(proto::TxReconcileReq&& msg)
+{
+    if (!m_This.m_Cfg.m_TxReconcile.m_Enabled || !(Flags::Accepted & m_Flags) || m_TxReconcile.m_Serving)
+        ThrowUnexpected();
+
+    TakeTxReconcileRound();
+    m_TxReconcile.m_Salt = msg.m_Salt;
+    m_TxReconcile.m_Serving = true;
+
+    uint32_t nMy = static_cast<uint32_t>(m_TxReconcile.m_vRound.size());
+    uint32_t nMin = std::min(nMy, msg.m_SetSize);
+    uint32_t nDiff = std::max(nMy, msg.m_SetSize) - nMin;
+    nDiff += static_cast<uint32_t>(uint64_t(nMin) * m_This.m_Cfg.m_TxReconcile.m_DiffFactor_pct / 100);
+
+    proto::TxReconcileSketch msgOut;
+    msgOut.m_SetSize = nMy;
+
+    if (nDiff > TxPool::Sketch::s_MaxCells)
+        nDiff = TxPool::Sketch::s_MaxCells; // too big anyway, avoid overflow
+
+    uint32_t nCells = TxPool::Sketch::get_Cells(nDiff);
+    if (nCells <= TxPool::Sketch::s_MaxCells)
+    {
+        TxPool::Sketch sk;
+        get_TxReconcileSketch(sk, nCells);
+        sk.Export(msgOut.m_Sketch);
+    }
+    // otherwise empty sketch, the initiator falls back to the full announcement
+
+    SendTxReconcile(msgOut);
+}
+
+void Node::Peer::OnMsg(proto::TxReconcileSketch&& msg)
+{
+    if (!m_TxReconcile.m_Requested)
+        ThrowUnexpected();
+    m_TxReconcile.m_Requested = false;
+
+    auto& stats = m_This.m_TxAnnounce.m_Stats;
+    stats.m_Rounds++;
+
+    proto::TxReconcileDiff msgOut;
+    msgOut.m_Fallback = 1;
+
+    TxPool::Sketch skPeer;
+    if (!msg.m_Sketch.empty())
+    {
+        if (!skPeer.Import(msg.m_Sketch))
+            ThrowUnexpected();
+
+        TxPool::Sketch sk;
+        get_TxReconcileSketch(sk, static_cast<uint32_t>(skPeer.m_vCells.size()));
+        sk.Subtract(skPeer);
+
+        std::vector<uint64_t> vMine;
+        if (sk.Decode(vMine, msgOut.m_Missing))
+        {
+            msgOut.m_Fallback = 0;
+            stats.m_Diff += vMine.size() + msgOut.m_Missing.size();
+
+            // announce ours that the peer doesn't have
+            std::sort(vMine.begin(), vMine.end());
+
+            std::vector<Transaction::KeyType> vAnnounce;
+            for (size_t i = 0; i < m_TxReconcile.m_vRound.size(); i++)
+            {
+                const auto& key = m_TxReconcile.m_vRound[i];
+                if (std::binary_search(vMine.begin(), vMine.end(), TxPool::Sketch::get_ShortID(key, m_TxReconcile.m_Salt)))
+                    vAnnounce.push_back(key);
+            }
+
+            AnnounceTxs(vAnnounce, true);
+        }
+        else
+            msgOut.m_Missing.clear();
+    }
+
+    if (msgOut.m_Fallback)
+    {
+        stats.m_Failed++;
+        AnnounceTxs(m_TxReconcile.m_vRound, true);
+    }
+
+    m_TxReconcile.m_vRound.clear();
+    SendTxReconcile(msgOut);
+
+    m_This.m_TxAnnounce.MaybeLogStats();
+}
+
+void Node::Peer::OnMsg(proto::TxReconcileDiff&& msg)
+{
+    if (!m_TxReconcile.m_Serving)
+        ThrowUnexpected();
+    m_TxReconcile.m_Serving = false;
+
+    if (msg.m_Fallback)
+        AnnounceTxs(m_TxReconcile.m_vRound, true);
+    else
+    {
+        std::sort(msg.m_Missing.begin(), msg.m_Missing.end());
+
+        std::vector<Transaction::KeyType> vAnnounce;
+        for (size_t i = 0; i < m_TxReconcile.m_vRound.size(); i++)
+        {
+            const auto& key = m_TxReconcile.m_vRound[i];
+            if (std::binary_search(msg.m_Missing.begin(), msg.m_Missing.end(), TxPool::Sketch::get_ShortID(key, m_TxReconcile.m_Salt)))
+                vAnnounce.push_back(key);
+        }
+
+        AnnounceTxs(vAnnounce, true);
+    }
+
+    m_TxReconcile.m_vRound.clear();
+}
+
+const proto::NodeConnection::SerializedOnce& Node::TxSerialized::Get(const Transaction::Ptr& pTx)
+{
+    for (auto it = m_Entries.begin(); m_Entries.end() != it; ++it)
+    {
+        if (it->m_pTx == pTx)
+        {
+            if (m_Entries.begin() != it)
+            {
+                Entry x = std::move(*it);
+                m_Entries.erase(it);
+                m_Entries.push_front(std::move(x));
+            }
+            return m_Entries.front().m_Msg;
+        }
+    }
+
+    if (m_Entries.size() >= s_Max)
+        m_Entries.pop_back();
+
+    Entry& x = m_Entries.emplace_front();
+    x.m_pTx = pTx;
+
+    proto::NewTransaction msg;
+    msg.m_Fluff = true;
+    TemporarySwap scope(msg.m_Transaction, x.m_pTx);
+
+    x.m_Msg.Set(msg);
+    return x.m_Msg;
+}
+
+void Node::CompactBlocks::Stats::Reset()
+{
+    m_Blocks = 0;
+    m_Rebuilt = 0;
+    m_Missing = 0;
+    m_Mismatch = 0;
+    m_Bytes = 0;
+    m_BytesFull = 0;
+    m_LastLog_ms = GetTime_ms();
+}
+
+void Node::CompactBlocks::MaybeLogStats()
+{
+    uint32_t nPeriod_ms = get_ParentObj().m_Cfg.m_CompactBlocks.m_StatsPeriod_ms;
+    if (!nPeriod_ms || (GetTime_ms() - m_Stats.m_LastLog_ms < nPeriod_ms))
+        return;
+
+    LOG_INFO() << "Compact blocks: received=" << m_Stats.m_Blocks
+        << ", rebuilt=" << m_Stats.m_Rebuilt
+        << ", missing=" << m_Stats.m_Missing
+        << ", mismatch=" << m_Stats.m_Mismatch
+        << ", bytes=" << m_Stats.m_Bytes
+        << ", rebuilt bytes=" << m_Stats.m_BytesFull;
+
+    m_Stats.Reset();
+}
+
+void Node::CompactBlocks::get_Checksum(Merkle::Hash& hv, const proto::BodyBuffers& bb)
+{
+    ECC::Hash::Processor()
+        << "blk.compact"
+        << static_cast<uint64_t>(bb.m_Perishable.size())
+        << Blob(bb.m_Perishable)
+        << Blob(bb.m_Eternal)
+        >> hv;
+}
+
+const proto::NodeConnection::SerializedOnce* Node::CompactBlocks::Get(const Block::SystemState::ID& id)
+{
+    Node& n = get_ParentObj();
+    if (id.m_Height + n.m_Cfg.m_CompactBlocks.m_MaxDepth < n.m_Processor.m_Cursor.m_ID.m_Height)
+        return nullptr;
+
+    if (m_Msg.IsEmpty() || (m_ID != id))
+    {
+        NodeDB::StateID sid;
+        sid.m_Row = n.m_Processor.get_DB().StateFindSafe(id);
+        if (!sid.m_Row)
+            return nullptr;
+        sid.m_Height = id.m_Height;
+
+        proto::BodyCompact msg;
+        if (!Build(msg, sid))
+            return nullptr;
+
+        m_ID = id;
+        m_Msg.Set(msg);
+    }
+
+    return &m_Msg;
+}
+
+bool Node::CompactBlocks::Build(proto::BodyCompact& msg, const NodeDB::StateID& sid)
+{
+    Node& n = get_ParentObj();
+
+    proto::BodyBuffers bb;
+    if (!n.m_Processor.GetBlock(sid, &bb.m_Eternal, &bb.m_Perishable, 0, 0, 0, false))
+        return false;
+
+    Block::Body block;
+
+    Deserializer der;
+    der.reset(bb.m_Perishable);
+    der & Cast::Down<Block::BodyBase>(block);
+    der & Cast::Down<TxVectors::Perishable>(block);
+
+    der.reset(bb.m_Eternal);
+    der & Cast::Down<TxVectors::Eternal>(block);
+
+    get_Checksum(msg.m_Checksum, bb);
+    ECC::GenRandom(&msg.m_Salt, sizeof(msg.m_Salt));
+
+    // Pool txs, all the kernels of which are in the block. Normally they were relayed to the peer as well.
+    // At this point they're most likely already outdated, i.e. not in the tx set.
+    std::map<Merkle::Hash, bool> mapKrn; // block kernels, taken by a pool tx
+    for (const auto& pKrn : block.m_vKernels)
+        mapKrn[pKrn->m_Internal.m_ID] = false;
+
+    std::vector<const Transaction*> vTxs;
+
+    auto fnAddTx = [&mapKrn, &vTxs](const Transaction& tx)
+    {
+        if (tx.m_vKernels.empty())
+            return;
+
+        for (const auto& pKrn : tx.m_vKernels)
+        {
+            auto it = mapKrn.find(pKrn->m_Internal.m_ID);
+            if ((mapKrn.end() == it) || it->second)
+                return;
+        }
+
+        for (const auto& pKrn : tx.m_vKernels)
+            mapKrn[pKrn->m_Internal.m_ID] = true;
+
+        vTxs.push_back(&tx);
+    };
+
+    for (auto it = n.m_TxPool.m_setTxs.begin(); n.m_TxPool.m_setTxs.end() != it; ++it)
+        fnAddTx(*it->get_ParentObj().m_pValue);
+
+    for (auto it = n.m_TxPool.m_lstOutdated.begin(); n.m_TxPool.m_lstOutdated.end() != it; ++it)
+        fnAddTx(*it->get_ParentObj().m_pValue);
+
+    std::set<ECC::Point> setIns, setOuts;
+    for (const auto& pInp : block.m_vInputs)
+        setIns.insert(pInp->m_Commitment);
+    for (const auto& pOutp : block.m_vOutputs)
+        setOuts.insert(pOutp->m_Commitment);
+
+    std::set<ECC::Point> setInsKnown, setOutsKnown;
+
+    while (true)
+    {
+        setOutsKnown.clear();
+        for (size_t i = 0; i < vTxs.size(); i++)
+            for (const auto& pOutp : vTxs[i]->m_vOutputs)
+                setOutsKnown.insert(pOutp->m_Commitment);
+
+        // inputs removed by the cut-through must spend the outputs of other known txs, otherwise the peer won't get those outputs
+        size_t nTxs = vTxs.size();
+        for (size_t i = 0; i < vTxs.size(); )
+        {
+            bool bOk = true;
+            for (const auto& pInp : vTxs[i]->m_vInputs)
+            {
+                if (!setIns.count(pInp->m_Commitment) && !setOutsKnown.count(pInp->m_Commitment))
+                {
+                    bOk = false;
+                    break;
+                }
+            }
+
+            if (bOk)
+                i++;
+            else
+            {
+                vTxs[i] = vTxs.back();
+                vTxs.pop_back();
+            }
+        }
+
+        if (vTxs.size() == nTxs)
+            break;
+    }
+
+    std::set<Merkle::Hash> setKrnKnown;
+    for (size_t i = 0; i < vTxs.size(); i++)
+    {
+        for (const auto& pKrn : vTxs[i]->m_vKernels)
+            setKrnKnown.insert(pKrn->m_Internal.m_ID);
+        for (const auto& pInp : vTxs[i]->m_vInputs)
+            setInsKnown.insert(pInp->m_Commitment);
+    }
+
+    // the rest is sent explicitly: coinbase, fees, offset, and the txs the peer is not expected to have
+    msg.m_Extra = std::make_shared<Transaction>();
+    Transaction& txE = *msg.m_Extra;
+    txE.m_Offset = block.m_Offset;
+
+    TxVectors::Writer wr(txE, txE);
+
+    // all the kernels are listed, to preserve their order (non-standard kernels are not sorted)
+    msg.m_Kernels.reserve(block.m_vKernels.size());
+    for (const auto& pKrn : block.m_vKernels)
+    {
+        msg.m_Kernels.push_back(TxPool::Sketch::get_ShortID(pKrn->m_Internal.m_ID, msg.m_Salt));
+        if (!setKrnKnown.count(pKrn->m_Internal.m_ID))
+            wr.Write(*pKrn);
+    }
+
+    for (const auto& pInp : block.m_vInputs)
+        if (!setInsKnown.count(pInp->m_Commitment))
+            wr.Write(*pInp);
+
+    for (const auto& pOutp : block.m_vOutputs)
+        if (!setOutsKnown.count(pOutp->m_Commitment))
+            wr.Write(*pOutp);
+
+    // outputs of the known txs, spent in the same block by the unknown txs. Those inputs were removed by the cut-through
+    for (const auto& c : setOutsKnown)
+    {
+        if (!setOuts.count(c) && !setInsKnown.count(c))
+        {
+            Input inp;
+            inp.m_Commitment = c;
+            wr.Write(inp);
+        }
+    }
+
+    return true;
+}
+
+bool Node::CompactBlocks::Rebuild(proto::BodyBuffers& out, const proto::BodyCompact& msg)
+{
+    assert(msg.m_Extra);
+    const Transaction& txE = *msg.m_Extra;
+
+    struct Entry {
+        const TxKernel* m_pKrn;
+        const Transaction* m_pTx; // null for the explicit kernels
+    };
+
+    std::map<uint64_t, Entry> mapKrn;
+    for (const auto& pKrn : txE.m_vKernels)
+        mapKrn[TxPool::Sketch::get_ShortID(pKrn->m_Internal.m_ID, msg.m_Salt)] = Entry{ pKrn.get(), nullptr };
+
+    if (mapKrn.size() < msg.m_Kernels.size())
+    {
+        std::set<uint64_t> setWanted(msg.m_Kernels.begin(), msg.m_Kernels.end());
+
+        const TxPool::Fluff& txp = get_ParentObj().m_TxPool; // alias
+        for (auto it = txp.m_setTxs.begin(); txp.m_setTxs.end() != it; ++it)
+        {
+            const Transaction& tx = *it->get_ParentObj().m_pValue;
+            for (const auto& pKrn : tx.m_vKernels)
+            {
+                uint64_t id = TxPool::Sketch::get_ShortID(pKrn->m_Internal.m_ID, msg.m_Salt);
+                if (setWanted.count(id))
+                    mapKrn.emplace(id, Entry{ pKrn.get(), &tx });
+            }
+        }
+    }
+
+    Block::Body block;
+    block.m_Offset = txE.m_Offset;
+
+    TxVectors::Writer wr(block, block);
+    std::set<const Transaction*> setTxs;
+
+    for (size_t i = 0; i < msg.m_Kernels.size(); i++)
+    {
+        auto it = mapKrn.find(msg.m_Kernels[i]);
+        if (mapKrn.end() == it)
+        {
+            m_Stats.m_Missing++;
+            return false;
+        }
+
+        const Entry& e = it->second;
+        wr.Write(*e.m_pKrn);
+
+        if (e.m_pTx && setTxs.insert(e.m_pTx).second)
+        {
+            for (const auto& pInp : e.m_pTx->m_vInputs)
+                wr.Write(*pInp);
+            for (const auto& pOutp : e.m_pTx->m_vOutputs)
+                wr.Write(*pOutp);
+        }
+    }
+
+    for (const auto& pInp : txE.m_vInputs)
+        wr.Write(*pInp);
+    for (const auto& pOutp : txE.m_vOutputs)
+        wr.Write(*pOutp);
+
+    block.NormalizeP(); // sort, cut-through. Kernels are already in order
+
+    Serializer ser;
+    ser & Cast::Down<Block::BodyBase>(block);
+    ser & Cast::Down<TxVectors::Perishable>(block);
+    ser.swap_buf(out.m_Perishable);
+
+    ser.reset();
+    ser & Cast::Down<TxVectors::Eternal>(block);
+    ser.swap_buf(out.m_Eternal);
+
+    Merkle::Hash hv;
+    get_Checksum(hv, out);
+    if (hv != msg.m_Checksum)
+    {
+        m_Stats.m_Mismatch++;
+        return false;
+    }
+
+    return true;
 }
 
 void Node::Peer::SendTx(Transaction::Ptr& ptx, bool bFluff, const Merkle::Hash* pCtx /* = nullptr */)
@@ -3499,26 +4582,280 @@ void Node::Peer::OnMsg(proto::GetProofAsset&& msg)
     Send(msgOut);
 }
 
-void Node::Peer::OnMsg(proto::GetShieldedList&& msg)
+void Node::DbReaders::Start(const std::string& sPath, uint32_t nThreads)
 {
-	proto::ShieldedList msgOut;
+    assert(!IsEnabled());
 
-	Processor& p = m_This.m_Processor;
-	if ((msg.m_Id0 < p.m_Extra.m_ShieldedOutputs) && msg.m_Count)
-	{
-        std::setmin(msg.m_Count, Rules::get().Shielded.m_ProofMax.get_N() * 2); // no reason to ask for more
+    m_pEvtDone = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { OnTasksDone(); });
+    m_Run = true;
+
+    for (uint32_t i = 0; i < nThreads; i++)
+        m_vThreads.emplace_back(&DbReaders::RunThread, this, sPath);
+
+    LOG_INFO() << "DB readers: " << nThreads;
+}
+
+void Node::DbReaders::DeleteAll(TaskList& lst)
+{
+    while (!lst.empty())
+    {
+        Task& t = lst.front();
+        lst.pop_front();
+
+        if (t.m_pPeer)
+            t.m_pPeer->m_pDbRead = nullptr;
+
+        delete &t;
+    }
+}
+
+void Node::DbReaders::Stop()
+{
+    if (!IsEnabled())
+        return;
+
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        m_Run = false;
+        m_NewTask.notify_all();
+    }
+
+    for (auto& t : m_vThreads)
+        if (t.joinable())
+            t.join();
+
+    m_vThreads.clear();
+
+    DeleteAll(m_queTasks);
+    DeleteAll(m_lstDone);
+
+    m_pEvtDone.reset();
+}
+
+void Node::DbReaders::Push(Task::Ptr&& pTask)
+{
+    assert(pTask && IsEnabled());
+
+    std::unique_lock<std::mutex> scope(m_Mutex);
+    m_queTasks.push_back(*pTask.release());
+    m_NewTask.notify_one();
+}
+
+void Node::DbReaders::RunThread(const std::string& sPath)
+{
+    NodeDB db;
+    try {
+        db.OpenReader(sPath.c_str());
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "DB reader open failed: " << e.what(); // the tasks will fail, and be handled in the node thread
+    }
+
+    std::unique_lock<std::mutex> scope(m_Mutex);
+
+    while (m_Run)
+    {
+        if (m_queTasks.empty())
+        {
+            m_NewTask.wait(scope);
+            continue;
+        }
+
+        Task& t = m_queTasks.front();
+        m_queTasks.pop_front();
+
+        scope.unlock();
+
+        if (db.IsOpen())
+        {
+            try {
+                NodeDB::Transaction tx(db); // all the reads are from the same snapshot
+                t.Exec(db);
+                tx.Commit();
+
+                t.m_Done = true;
+
+            } catch (const std::exception& e) {
+                LOG_WARNING() << "DB reader: " << e.what();
+            }
+        }
+
+        scope.lock();
+
+        m_lstDone.push_back(t);
+        m_pEvtDone->post();
+    }
+}
+
+void Node::DbReaders::OnTasksDone()
+{
+    TaskList lst;
+    {
+        std::unique_lock<std::mutex> scope(m_Mutex);
+        lst.swap(m_lstDone);
+    }
+
+    while (!lst.empty())
+    {
+        Task::Ptr pTask(&lst.front());
+        lst.pop_front();
+
+        if (pTask->m_pPeer)
+            pTask->m_pPeer->OnDbReadDone(*pTask);
+    }
+}
+
+void Node::Peer::get_DbReadCtx(DbReadCtx& ctx)
+{
+    const Processor& p = m_This.m_Processor;
+
+    ctx.m_ShieldedOutputs = p.m_Extra.m_ShieldedOutputs;
+    ctx.m_hEventsMax = p.IsFastSync() ? p.m_SyncData.m_h0 : MaxHeight;
+
+    size_t nUnsent = get_Unsent();
+    size_t nLimit = m_This.m_Cfg.m_BandwidthCtl.m_Chocking;
+    ctx.m_nSizeMax = ((Flags::Chocking & m_Flags) || (nUnsent >= nLimit)) ? 0 : (nLimit - nUnsent);
+}
+
+bool Node::Peer::CanReadAsync() const
+{
+    // readers see only the committed data
+    return m_This.m_DbReaders.IsEnabled() && !m_This.m_Processor.m_bFlushPending;
+}
 
-		TxoID n = p.m_Extra.m_ShieldedOutputs - msg.m_Id0;
+template <typename TMsgIn, typename TMsgOut>
+void Node::Peer::ServeDbRead(TMsgIn&& msg)
+{
+    struct MyTask
+        :public DbReaders::Task
+    {
+        DbReadCtx m_Ctx;
+        TMsgIn m_In;
+        TMsgOut m_Out;
 
-		if (msg.m_Count > n)
-			msg.m_Count = static_cast<uint32_t>(n);
+        virtual void Exec(NodeDB& db) override
+        {
+            ReadDb(db, m_Ctx, m_In, m_Out);
+        }
+
+        virtual void OnDone(Peer& p) override
+        {
+            if (m_Done)
+            {
+                p.Send(m_Out);
+                p.IsChocking();
+            }
+            else
+                p.ServeDbReadSync<TMsgIn, TMsgOut>(m_In); // the snapshot doesn't fit (probably rolled back), retry with the current state
+        }
+    };
 
-		msgOut.m_Items.resize(msg.m_Count);
-		p.get_DB().ShieldedRead(msg.m_Id0, &msgOut.m_Items.front(), msg.m_Count);
-        p.get_DB().ShieldedStateRead(msg.m_Id0 + msg.m_Count - 1, &msgOut.m_State1, 1);
+    if (!CanReadAsync())
+    {
+        ServeDbReadSync<TMsgIn, TMsgOut>(msg);
+        return;
     }
 
+    auto pTask = std::make_unique<MyTask>();
+    get_DbReadCtx(pTask->m_Ctx);
+    pTask->m_In = std::move(msg);
+    pTask->m_pPeer = this;
+
+    m_pDbRead = pTask.get();
+    m_This.m_DbReaders.Push(std::move(pTask));
+}
+
+template <typename TMsgIn, typename TMsgOut>
+void Node::Peer::ServeDbReadSync(const TMsgIn& msg)
+{
+    DbReadCtx ctx;
+    get_DbReadCtx(ctx);
+
+    TMsgOut msgOut;
+    ReadDb(m_This.m_Processor.get_DB(), ctx, msg, msgOut);
+
     Send(msgOut);
+    IsChocking();
+}
+
+void Node::Peer::OnDbReadDone(DbReaders::Task& t)
+{
+    assert(m_pDbRead == &t);
+    m_pDbRead = nullptr;
+
+    bool bAlive = true;
+    m_pAlive = &bAlive;
+
+    try {
+        t.OnDone(*this);
+    } catch (const proto::NodeProcessingException& e) {
+        OnProcessingExc(e);
+    } catch (const std::exception& e) {
+        OnExc(e);
+    }
+
+    // resume the held messages, unless another request went to the readers
+    while (bAlive && !m_pDbRead && !m_lstHeld.empty())
+    {
+        auto fn = std::move(m_lstHeld.front().m_fn);
+        assert(m_HeldSize >= m_lstHeld.front().m_Size);
+        m_HeldSize -= m_lstHeld.front().m_Size;
+        m_lstHeld.pop_front();
+
+        try {
+            fn();
+        } catch (const proto::NodeProcessingException& e) {
+            OnProcessingExc(e);
+        } catch (const std::exception& e) {
+            OnExc(e);
+        }
+    }
+
+    if (bAlive)
+        m_pAlive = nullptr;
+}
+
+#define THE_MACRO(code, msg) \
+bool Node::Peer::OnMsg2(proto::msg&& v) \
+{ \
+    if (m_pDbRead) \
+    { \
+        SerializerSizeCounter ssc; \
+        ssc & v; \
+        if ((m_lstHeld.size() >= s_MaxHeld) || (m_HeldSize + ssc.m_Counter.m_Value > s_MaxHeldSize)) \
+            ThrowUnexpected("too many held msgs"); \
+        auto pMsg = std::make_shared<proto::msg>(std::move(v)); \
+        auto& x = m_lstHeld.emplace_back(); \
+        x.m_fn = [this, pMsg]() { proto::NodeConnection::OnMsg2(std::move(*pMsg)); }; \
+        x.m_Size = ssc.m_Counter.m_Value; \
+        m_HeldSize += x.m_Size; \
+        return true; \
+    } \
+    return proto::NodeConnection::OnMsg2(std::move(v)); \
+}
+
+BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
+void Node::Peer::OnMsg(proto::GetShieldedList&& msg)
+{
+	ServeDbRead<proto::GetShieldedList, proto::ShieldedList>(std::move(msg));
+}
+
+void Node::Peer::ReadDb(NodeDB& db, const DbReadCtx& ctx, const proto::GetShieldedList& msg, proto::ShieldedList& msgOut)
+{
+	if ((msg.m_Id0 < ctx.m_ShieldedOutputs) && msg.m_Count)
+	{
+		uint32_t nCount = std::min(msg.m_Count, Rules::get().Shielded.m_ProofMax.get_N() * 2); // no reason to ask for more
+
+		TxoID n = ctx.m_ShieldedOutputs - msg.m_Id0;
+
+		if (nCount > n)
+			nCount = static_cast<uint32_t>(n);
+
+		msgOut.m_Items.resize(nCount);
+		db.ShieldedRead(msg.m_Id0, &msgOut.m_Items.front(), nCount);
+		db.ShieldedStateRead(msg.m_Id0 + nCount - 1, &msgOut.m_State1, 1);
+	}
 }
 
 bool Node::Processor::BuildCwp()
@@ -3666,6 +5003,8 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
     Bbs::Subscription::InBbs key;
     key.m_Channel = msg.m_Channel;
 
+    proto::NodeConnection::SerializedOnce msgSer; // lazy
+
     for (std::pair<It, It> range = m_This.m_Bbs.m_Subscribed.equal_range(key); range.first != range.second; range.first++)
     {
         Bbs::Subscription& s = range.first->get_ParentObj();
@@ -3674,7 +5013,14 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (s.m_pPeer->IsChocking())
             continue;
 
-        s.m_pPeer->SendBbsMsg(wlk.m_Data);
+        if (msgSer.IsEmpty())
+        {
+            proto::BbsMsg msgBbs;
+            Peer::ExportBbsMsg(msgBbs, wlk.m_Data);
+            msgSer.Set(msgBbs);
+        }
+
+        s.m_pPeer->Send(msgSer);
 		s.m_Cursor = id;
 
 		s.m_pPeer->IsChocking(); // in case it's chocking - for faster recovery recheck it ASAP
@@ -3717,13 +5063,18 @@ void Node::Peer::OnMsg(proto::BbsGetMsg&& msg)
     SendBbsMsg(wlk.m_Data);
 }
 
-void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
+void Node::Peer::ExportBbsMsg(proto::BbsMsg& msgOut, const NodeDB::WalkerBbs::Data& d)
 {
-	proto::BbsMsg msgOut;
 	msgOut.m_Channel = d.m_Channel;
 	msgOut.m_TimePosted = d.m_TimePosted;
 	d.m_Message.Export(msgOut.m_Message);
 	msgOut.m_Nonce = d.m_Nonce;
+}
+
+void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
+{
+	proto::BbsMsg msgOut;
+	ExportBbsMsg(msgOut, d);
 	Send(msgOut);
 }
 
@@ -3789,39 +5140,39 @@ void Node::Peer::OnMsg(proto::BbsResetSync&& msg)
 
 void Node::Peer::OnMsg(proto::GetEvents&& msg)
 {
-    proto::Events msgOut;
-
     if (Flags::Viewer & m_Flags)
+        ServeDbRead<proto::GetEvents, proto::Events>(std::move(msg));
+    else
     {
-		Processor& p = m_This.m_Processor;
-		NodeDB& db = p.get_DB();
-        NodeDB::WalkerEvent wlk;
+        LOG_WARNING() << "Peer " << m_RemoteAddr << " Unauthorized Utxo events request.";
+        Send(proto::Events());
+    }
+}
 
-        Height hLast = 0;
-        uint32_t nCount = 0;
+void Node::Peer::ReadDb(NodeDB& db, const DbReadCtx& ctx, const proto::GetEvents& msg, proto::Events& msgOut)
+{
+    NodeDB::WalkerEvent wlk;
 
-        Serializer ser, serCvt;
+    Height hLast = 0;
+    uint32_t nCount = 0;
 
-        for (db.EnumEvents(wlk, msg.m_HeightMin); wlk.MoveNext(); hLast = wlk.m_Height)
-        {
-            if ((nCount >= proto::Event::s_Max) && (wlk.m_Height != hLast))
-                break;
+    Serializer ser;
 
-			if (p.IsFastSync() && (wlk.m_Height > p.m_SyncData.m_h0))
-				break;
+    for (db.EnumEvents(wlk, msg.m_HeightMin); wlk.MoveNext(); hLast = wlk.m_Height)
+    {
+        if ((nCount >= proto::Event::s_Max) && (wlk.m_Height != hLast))
+            break;
 
-            ser & wlk.m_Height;
-            ser.WriteRaw(wlk.m_Body.p, wlk.m_Body.n);
+        if (wlk.m_Height > ctx.m_hEventsMax)
+            break;
 
-            nCount++;   
-		}
+        ser & wlk.m_Height;
+        ser.WriteRaw(wlk.m_Body.p, wlk.m_Body.n);
 
-        ser.swap_buf(msgOut.m_Events);
+        nCount++;
     }
-    else
-        LOG_WARNING() << "Peer " << m_RemoteAddr << " Unauthorized Utxo events request.";
 
-    Send(msgOut);
+    ser.swap_buf(msgOut.m_Events);
 }
 
 void Node::Peer::OnMsg(proto::BlockFinalization&& msg)
@@ -3936,6 +5287,12 @@ void Node::Peer::OnMsg(proto::GetShieldedOutputsAt&& msg)
 
 void Node::Peer::OnMsg(proto::ContractVarsEnum&& msg)
 {
+    if (!m_Dependent.m_pQuery)
+    {
+        ServeDbRead<proto::ContractVarsEnum, proto::ContractVars>(std::move(msg));
+        return;
+    }
+
     struct Wrk
         :public NodeProcessor::IWorker
     {
@@ -3950,46 +5307,60 @@ void Node::Peer::OnMsg(proto::ContractVarsEnum&& msg)
 
         void Do() override
         {
-            NodeDB::WalkerContractData wlk;
-            m_This.m_This.m_Processor.get_DB().ContractDataEnum(wlk, m_In.m_KeyMin, m_In.m_KeyMax);
+            DbReadCtx ctx;
+            m_This.get_DbReadCtx(ctx);
+            ReadDb(m_This.m_This.m_Processor.get_DB(), ctx, m_In, m_Out);
+        }
+    };
 
-            Serializer ser;
+    Wrk wrk(*this, msg);
 
-            while (true)
-            {
-                if (!wlk.MoveNext())
-                    break;
+    m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
 
-                if (m_In.m_bSkipMin && (wlk.m_Key == m_In.m_KeyMin))
-                    continue; // skip
+    Send(wrk.m_Out);
+    IsChocking();
+}
 
-                ser
-                    & wlk.m_Key.n
-                    & wlk.m_Val.n;
+void Node::Peer::ReadDb(NodeDB& db, const DbReadCtx& ctx, const proto::ContractVarsEnum& msg, proto::ContractVars& msgOut)
+{
+    NodeDB::WalkerContractData wlk;
+    db.ContractDataEnum(wlk, msg.m_KeyMin, msg.m_KeyMax);
 
-                ser.WriteRaw(wlk.m_Key.p, wlk.m_Key.n);
-                ser.WriteRaw(wlk.m_Val.p, wlk.m_Val.n);
+    Serializer ser;
 
-                if (m_This.IsChocking(ser.buffer().second))
-                {
-                    m_Out.m_bMore = true;
-                    break;
-                }
-            }
+    while (true)
+    {
+        if (!wlk.MoveNext())
+            break;
 
-            ser.swap_buf(m_Out.m_Result);
-        }
-    };
+        if (msg.m_bSkipMin && (wlk.m_Key == msg.m_KeyMin))
+            continue; // skip
 
-    Wrk wrk(*this, msg);
+        ser
+            & wlk.m_Key.n
+            & wlk.m_Val.n;
 
-    m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
+        ser.WriteRaw(wlk.m_Key.p, wlk.m_Key.n);
+        ser.WriteRaw(wlk.m_Val.p, wlk.m_Val.n);
 
-    Send(wrk.m_Out);
+        if (ser.buffer().second > ctx.m_nSizeMax)
+        {
+            msgOut.m_bMore = true;
+            break;
+        }
+    }
+
+    ser.swap_buf(msgOut.m_Result);
 }
 
 void Node::Peer::OnMsg(proto::ContractLogsEnum&& msg)
 {
+    if (!m_Dependent.m_pQuery)
+    {
+        ServeDbRead<proto::ContractLogsEnum, proto::ContractLogs>(std::move(msg));
+        return;
+    }
+
     struct Wrk
         :public NodeProcessor::IWorker
     {
@@ -4004,56 +5375,63 @@ void Node::Peer::OnMsg(proto::ContractLogsEnum&& msg)
 
         void Do() override
         {
-            auto& db = m_This.m_This.m_Processor.get_DB();
+            DbReadCtx ctx;
+            m_This.get_DbReadCtx(ctx);
+            ReadDb(m_This.m_This.m_Processor.get_DB(), ctx, m_In, m_Out);
+        }
+    };
 
-            NodeDB::ContractLog::Walker wlk;
-            if (m_In.m_KeyMin.empty() && m_In.m_KeyMax.empty())
-                db.ContractLogEnum(wlk, m_In.m_PosMin, m_In.m_PosMax);
-            else
-                db.ContractLogEnum(wlk, m_In.m_KeyMin, m_In.m_KeyMax, m_In.m_PosMin, m_In.m_PosMax);
+    Wrk wrk(*this, msg);
 
-            Serializer ser;
+    m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
 
-            while (true)
-            {
-                if (!wlk.MoveNext())
-                    break;
+    Send(wrk.m_Out);
+    IsChocking();
+}
 
-                HeightPos dp;
-                dp.m_Height = wlk.m_Entry.m_Pos.m_Height - m_In.m_PosMin.m_Height;
-                if (dp.m_Height)
-                {
-                    m_In.m_PosMin.m_Height = wlk.m_Entry.m_Pos.m_Height;
-                    m_In.m_PosMin.m_Pos = 0;
-                }
+void Node::Peer::ReadDb(NodeDB& db, const DbReadCtx& ctx, const proto::ContractLogsEnum& msg, proto::ContractLogs& msgOut)
+{
+    NodeDB::ContractLog::Walker wlk;
+    if (msg.m_KeyMin.empty() && msg.m_KeyMax.empty())
+        db.ContractLogEnum(wlk, msg.m_PosMin, msg.m_PosMax);
+    else
+        db.ContractLogEnum(wlk, msg.m_KeyMin, msg.m_KeyMax, msg.m_PosMin, msg.m_PosMax);
 
-                dp.m_Pos = wlk.m_Entry.m_Pos.m_Pos - m_In.m_PosMin.m_Pos;
-                m_In.m_PosMin.m_Pos = wlk.m_Entry.m_Pos.m_Pos;
+    HeightPos posPrev = msg.m_PosMin;
+    Serializer ser;
 
-                ser
-                    & dp
-                    & wlk.m_Entry.m_Key.n
-                    & wlk.m_Entry.m_Val.n;
+    while (true)
+    {
+        if (!wlk.MoveNext())
+            break;
 
-                ser.WriteRaw(wlk.m_Entry.m_Key.p, wlk.m_Entry.m_Key.n);
-                ser.WriteRaw(wlk.m_Entry.m_Val.p, wlk.m_Entry.m_Val.n);
+        HeightPos dp;
+        dp.m_Height = wlk.m_Entry.m_Pos.m_Height - posPrev.m_Height;
+        if (dp.m_Height)
+        {
+            posPrev.m_Height = wlk.m_Entry.m_Pos.m_Height;
+            posPrev.m_Pos = 0;
+        }
 
-                if (m_This.IsChocking(ser.buffer().second))
-                {
-                    m_Out.m_bMore = true;
-                    break;
-                }
-            }
+        dp.m_Pos = wlk.m_Entry.m_Pos.m_Pos - posPrev.m_Pos;
+        posPrev.m_Pos = wlk.m_Entry.m_Pos.m_Pos;
 
-            ser.swap_buf(m_Out.m_Result);
-        }
-    };
+        ser
+            & dp
+            & wlk.m_Entry.m_Key.n
+            & wlk.m_Entry.m_Val.n;
 
-    Wrk wrk(*this, msg);
+        ser.WriteRaw(wlk.m_Entry.m_Key.p, wlk.m_Entry.m_Key.n);
+        ser.WriteRaw(wlk.m_Entry.m_Val.p, wlk.m_Entry.m_Val.n);
 
-    m_This.m_Processor.ExecInDependentContext(wrk, m_Dependent.m_pQuery.get(), m_This.m_TxDependent);
+        if (ser.buffer().second > ctx.m_nSizeMax)
+        {
+            msgOut.m_bMore = true;
+            break;
+        }
+    }
 
-    Send(wrk.m_Out);
+    ser.swap_buf(msgOut.m_Result);
 }
 
 void Node::Peer::OnMsg(proto::GetContractVar&& msg)
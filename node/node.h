@@ -84,6 +84,51 @@ struct Node
 		// negative: number of cores minus number of mining threads.
 		int m_VerificationThreads = 0;
 
+		struct TxPipeline
+		{
+			// Pipelined admission of deferred (received from peers) transactions.
+			// Context-free verification is done by the verification threads, in batches. Only the context-dependent part is done in the node thread.
+			uint32_t m_MaxInFlight = 0; // max num of txs being verified concurrently. Set to 0 to verify them synchronously in the node thread
+			uint32_t m_BatchSize = 16; // max txs per verification task
+			uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the latency stats. 0 - never
+
+		} m_TxPipeline;
+
+		struct TxReconcile
+		{
+			// Erlay-style announcement of the fluffed txs. Instead of HaveTransaction to each peer, the announcements are accumulated per peer,
+			// and periodically reconciled via the set sketches (rounds are initiated by the outbound side). Peers that don't support it are flooded as before.
+			bool m_Enabled = false;
+			uint32_t m_FloodPeers = 4; // outbound peers that are still flooded, for the fast propagation
+			uint32_t m_Period_ms = 1000; // reconciliation round period, per outbound peer
+			uint32_t m_DiffFactor_pct = 25; // expected difference wrt the smaller set, to size the sketch
+			uint32_t m_MaxPending = 4096; // beyond this the pending announcements are flooded (i.e. the peer doesn't run the rounds)
+			uint32_t m_Timeout_ms = 10000; // initiator: the peer is dropped if the sketch doesn't arrive in time
+			uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the announcement bandwidth stats. 0 - never
+
+		} m_TxReconcile;
+
+		struct CompactBlocks
+		{
+			// Single new blocks are requested from the peers that support it as the kernel short IDs + the elements the sender expects to be missing,
+			// and rebuilt from the tx pool. If some kernels aren't found, or the rebuilt body differs - the full body is requested.
+			bool m_Enabled = false;
+			uint32_t m_MaxDepth = 3; // served only for the blocks this close to the tip, others are unlikely to be in the peer's pool
+			uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the stats. 0 - never
+
+		} m_CompactBlocks;
+
+		// Outbound messages of at least this size are sealed (MAC + encryption) by the dedicated threads, not in the node thread. 0 - disabled
+		size_t m_SealOffloadThreshold = 0;
+		uint32_t m_SealOffloadThreads = 2; // separate from the verification threads, so that the replies don't wait behind the bulk verification
+
+		// Large sync replies (block bodies, header packs, shielded lists) are LZ-compressed for the peers that support it, if at least this size. 0 - disabled
+		size_t m_CompressThreshold = 4096;
+
+		// Num of threads that serve heavy read-only peer requests (events, shielded list, contract vars/logs) via separate read-only DB connections.
+		// Turns on the WAL journal mode of the DB. 0: disabled, all the requests are served in the node thread.
+		uint32_t m_DbReaders = 0;
+
 		struct RollbackLimit
 		{
 			Height m_Max = 60; // artificial restriction on how much the node will rollback automatically
@@ -121,6 +166,8 @@ struct Node
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
 
+			size_t m_BodyCacheSize = 1024 * 1024 * 64; // recently served (pre-cut) block bodies. Set to 0 to disable
+
 		} m_BandwidthCtl;
 
 		struct TestMode {
@@ -180,6 +227,10 @@ struct Node
 	void Initialize(IExternalPOW* externalPOW=nullptr);
 
 	NodeProcessor& get_Processor() { return m_Processor; } // for tests only!
+	const proto::NodeConnection::CryptoOffload::Stats& get_CryptoOffloadStats() const { return m_CryptoOffload.m_Stats; } // for tests only!
+	uint64_t get_CompactBlocksRebuilt() const { return m_CompactBlocks.m_Stats.m_Rebuilt; } // for tests only!
+	uint64_t get_TxPipelineBatches() const { return m_TxDeferred.m_Stats.m_Batches; } // for tests only!
+	uint64_t get_TxPipelineRejected() const { return m_TxDeferred.m_Stats.m_Rejected; } // for tests only!
 
 	struct SyncStatus
 	{
@@ -369,6 +420,146 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Dandelion)
 	} m_Dandelion;
 
+	struct BodyCache
+	{
+		// Block bodies served to peers, already cut wrt requested horizons
+		struct Entry
+		{
+			struct Key
+				:public boost::intrusive::set_base_hook<>
+			{
+				struct Type
+				{
+					uint64_t m_Row;
+					Height m_h0; // normalized, see MakeKey()
+					Height m_hLo1;
+					Height m_hHi1;
+					uint8_t m_FlagE;
+					uint8_t m_FlagP;
+
+					int cmp(const Type&) const;
+					COMPARISON_VIA_CMP
+				};
+
+				Type m_Value;
+				bool operator < (const Key& x) const { return m_Value < x.m_Value; }
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
+			} m_Key;
+
+			struct Mru
+				:public boost::intrusive::list_base_hook<>
+			{
+				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
+			} m_Mru;
+
+			proto::BodyBuffers m_Body;
+
+			size_t get_Size() const;
+		};
+
+		typedef boost::intrusive::multiset<Entry::Key> KeySet;
+		typedef boost::intrusive::list<Entry::Mru> MruList;
+
+		KeySet m_Keys;
+		MruList m_Mru;
+		size_t m_Size = 0; // total bytes
+
+		// processor horizons at the moment the cached bodies were cut
+		Height m_TxoLo = 0;
+		Height m_TxoHi = 0;
+
+		~BodyCache() { Clear(); }
+
+		void Clear();
+		void Delete(Entry&);
+		void ShrinkTo(size_t);
+
+		bool MakeKey(Entry::Key::Type&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive); // returns false if the result shouldn't be cached
+		const proto::BodyBuffers* Find(const Entry::Key::Type&); // modifies MRU if found
+		void Insert(const Entry::Key::Type&, const proto::BodyBuffers&);
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_BodyCache)
+	} m_BodyCache;
+
+	proto::NodeConnection::CryptoOffload m_CryptoOffload; // shared by the peers
+	ExecutorMT_R m_SealExecutor; // for m_CryptoOffload, must be destroyed before it
+	proto::NodeConnection::Compression m_Compression; // shared by the peers
+
+	struct TxAnnounce
+	{
+		struct Stats
+		{
+			uint64_t m_Txs; // fluffed
+			uint64_t m_BytesFlood; // HaveTransaction to the flooded peers
+			uint64_t m_BytesRecon; // reconciliation messages, and HaveTransaction for the decoded difference
+			uint64_t m_Rounds;
+			uint64_t m_Failed; // sketch too big or not decoded, everything announced
+			uint64_t m_Diff; // decoded elements
+			uint32_t m_LastLog_ms;
+
+			Stats() { Reset(); }
+			void Reset();
+
+		} m_Stats;
+
+		template <typename TMsg>
+		static size_t get_MsgSize(const TMsg&);
+
+		void MaybeLogStats();
+		void OnFloodPeerGone(); // pick another outbound peer to flood
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxAnnounce)
+	} m_TxAnnounce;
+
+	struct TxSerialized
+	{
+		// Fluffed txs recently requested by peers. Once announced, most of the peers ask for the same tx, it's serialized only once
+		struct Entry
+		{
+			Transaction::Ptr m_pTx; // keeps it alive, so that the pointer comparison is valid
+			proto::NodeConnection::SerializedOnce m_Msg;
+		};
+
+		std::deque<Entry> m_Entries; // MRU first
+		static const size_t s_Max = 16;
+
+		const proto::NodeConnection::SerializedOnce& Get(const Transaction::Ptr&);
+
+	} m_TxSerialized;
+
+	struct CompactBlocks
+	{
+		struct Stats
+		{
+			uint64_t m_Blocks; // received in the compact form
+			uint64_t m_Rebuilt;
+			uint64_t m_Missing; // some kernels not in the pool, full body requested
+			uint64_t m_Mismatch; // rebuilt body differs, full body requested
+			uint64_t m_Bytes; // compact messages received
+			uint64_t m_BytesFull; // size of the rebuilt bodies
+			uint32_t m_LastLog_ms;
+
+			Stats() { Reset(); }
+			void Reset();
+
+		} m_Stats;
+
+		// The last served block. Once announced, most of the peers ask for the same one
+		Block::SystemState::ID m_ID;
+		proto::NodeConnection::SerializedOnce m_Msg;
+
+		CompactBlocks() { ZeroObject(m_ID); }
+
+		const proto::NodeConnection::SerializedOnce* Get(const Block::SystemState::ID&); // null if the block is unavailable
+		bool Build(proto::BodyCompact&, const NodeDB::StateID&);
+		bool Rebuild(proto::BodyBuffers&, const proto::BodyCompact&);
+		static void get_Checksum(Merkle::Hash&, const proto::BodyBuffers&);
+
+		void MaybeLogStats();
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_CompactBlocks)
+	} m_CompactBlocks;
+
 	struct TxDeferred
 		:public io::IdleEvt
 	{
@@ -378,15 +569,115 @@ private:
 			std::unique_ptr<Merkle::Hash> m_pCtx;
 			PeerID m_Sender;
 			bool m_Fluff;
+			uint64_t m_Received_us;
 		};
 
 		std::list<Element> m_lst;
 
 		virtual void OnSchedule() override;
 
+		// pipelined mode
+		struct Verified
+		{
+			Element m_Elem;
+			const Transaction* m_pTx; // remains valid after m_Elem.m_pTx is moved-out
+			Transaction::Context::Params m_Pars;
+			Transaction::Context m_Ctx;
+			bool m_Valid;
+
+			Verified() :m_Ctx(m_Pars) {}
+
+			void ValidateAndSummarize(Height);
+		};
+
+		struct Batch
+		{
+			std::list<Verified> m_lst;
+			Height m_Height; // tip height at the moment of dispatch
+			uint64_t m_Dispatched_us;
+			uint64_t m_Verified_us;
+			bool m_Fallback = false;
+
+			void Verify(); // context-free part, invoked in the verification thread
+		};
+
+		struct Task;
+
+		uint32_t m_InFlight = 0;
+		std::mutex m_MutexDone;
+		std::list<std::unique_ptr<Batch> > m_lstDone; // protected by mutex
+		io::AsyncEvent::Ptr m_pEvtDone;
+
+		const Verified* m_pVerified = nullptr; // set while the context-dependent part is processed
+
+		void PushBatch();
+		void OnBatchesDone();
+		void OnBatchDone(Batch&);
+		bool get_Verified(Transaction::Context&, const Transaction&, bool& bValid) const;
+
+		struct Stats
+		{
+			LatencyStats m_Queued; // waiting for a verification slot
+			LatencyStats m_ContextFree; // verification threads, including the executor queue
+			LatencyStats m_Context; // context-dependent part, node thread
+			uint64_t m_Batches;
+			uint64_t m_BatchFallbacks; // batched verification failed, each tx re-verified individually
+			uint64_t m_Rejected;
+			uint64_t m_Stale; // tip changed while verifying, re-verified synchronously
+			uint32_t m_LastLog_ms;
+
+			Stats() { Reset(); }
+			void Reset();
+
+		} m_Stats;
+
+		void MaybeLogStats();
+
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxDeferred)
 	} m_TxDeferred;
 
+	// Read-only DB connections (WAL snapshots), each in its own thread
+	struct DbReaders
+	{
+		struct Task
+			:public boost::intrusive::list_base_hook<>
+		{
+			typedef std::unique_ptr<Task> Ptr;
+
+			Peer* m_pPeer = nullptr; // reset if the peer is deleted meanwhile
+			bool m_Done = false; // set if executed successfully
+
+			virtual ~Task() {}
+			virtual void Exec(NodeDB&) = 0; // invoked in the reader thread
+			virtual void OnDone(Peer&) = 0; // invoked in the node thread, either on success or failure
+		};
+
+		~DbReaders() { Stop(); }
+
+		void Start(const std::string& sPath, uint32_t nThreads);
+		void Stop();
+		bool IsEnabled() const { return !m_vThreads.empty(); }
+		void Push(Task::Ptr&&);
+
+	private:
+		typedef boost::intrusive::list<Task> TaskList;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_NewTask;
+		TaskList m_queTasks; // protected by mutex
+		TaskList m_lstDone; // protected by mutex
+		bool m_Run = false;
+
+		std::vector<std::thread> m_vThreads;
+		io::AsyncEvent::Ptr m_pEvtDone;
+
+		void RunThread(const std::string& sPath);
+		void OnTasksDone();
+		static void DeleteAll(TaskList&);
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_DbReaders)
+	} m_DbReaders;
+
 	void OnTransactionDeferred(Transaction::Ptr&&, std::unique_ptr<Merkle::Hash>&&, const PeerID*, bool bFluff);
 	uint8_t OnTransactionStem(Transaction::Ptr&&, std::ostream* pExtraInfo);
 	uint8_t OnTransactionFluff(Transaction::Ptr&&, std::ostream* pExtraInfo, const PeerID*, const TxPool::Stats*);
@@ -513,6 +804,7 @@ private:
 			static const uint16_t Chocking		= 0x200;
 			static const uint16_t Viewer		= 0x400;
 			static const uint16_t Accepted		= 0x800;
+			static const uint16_t TxFlood		= 0x1000; // outbound, reconciliation supported, but still flooded
 		};
 
 		uint16_t m_Flags;
@@ -539,6 +831,50 @@ private:
 		io::Timer::Ptr m_pTimerRequest;
 		io::Timer::Ptr m_pTimerPeers;
 
+		struct TxReconcile
+		{
+			std::vector<Transaction::KeyType> m_vPending; // to be announced in the next round
+			std::vector<Transaction::KeyType> m_vRound; // being reconciled
+			uint64_t m_Salt = 0;
+			bool m_Requested = false; // initiator: waiting for the sketch
+			uint32_t m_Requested_ms = 0;
+			bool m_Serving = false; // responder: waiting for the diff
+			io::Timer::Ptr m_pTimer;
+		} m_TxReconcile;
+
+		// a request being served by a db reader. Subsequent incoming messages are held meanwhile, to preserve the order of responses
+		DbReaders::Task* m_pDbRead = nullptr;
+		struct Held
+		{
+			std::function<void()> m_fn;
+			size_t m_Size; // serialized
+		};
+		std::list<Held> m_lstHeld;
+		size_t m_HeldSize = 0;
+		static const uint32_t s_MaxHeld = 256; // the peer is disconnected beyond either limit
+		static const size_t s_MaxHeldSize = proto::NodeConnection::s_MaxMsgSize * 2;
+		bool* m_pAlive = nullptr; // reset if deleted while the held messages are processed
+
+		struct DbReadCtx
+		{
+			TxoID m_ShieldedOutputs;
+			Height m_hEventsMax;
+			size_t m_nSizeMax; // for enumerations
+		};
+
+		void get_DbReadCtx(DbReadCtx&);
+		bool CanReadAsync() const;
+		template <typename TMsgIn, typename TMsgOut>
+		void ServeDbRead(TMsgIn&&);
+		template <typename TMsgIn, typename TMsgOut>
+		void ServeDbReadSync(const TMsgIn&);
+		void OnDbReadDone(DbReaders::Task&);
+
+		static void ReadDb(NodeDB&, const DbReadCtx&, const proto::GetShieldedList&, proto::ShieldedList&);
+		static void ReadDb(NodeDB&, const DbReadCtx&, const proto::GetEvents&, proto::Events&);
+		static void ReadDb(NodeDB&, const DbReadCtx&, const proto::ContractVarsEnum&, proto::ContractVars&);
+		static void ReadDb(NodeDB&, const DbReadCtx&, const proto::ContractLogsEnum&, proto::ContractLogs&);
+
 		Peer(Node& n) :m_This(n) {}
 
 		void TakeTasks();
@@ -550,6 +886,7 @@ private:
 		void OnRequestTimeout();
 		void OnResendPeers();
 		void SendBbsMsg(const NodeDB::WalkerBbs::Data&);
+		static void ExportBbsMsg(proto::BbsMsg&, const NodeDB::WalkerBbs::Data&);
 		void DeleteSelf(bool bIsError, uint8_t nByeReason);
 		void BroadcastTxs();
 		void BroadcastBbs();
@@ -558,7 +895,17 @@ private:
 		void MaybeSendDependent();
 		void OnChocking();
 		void SetTxCursor(TxPool::Fluff::Element::Send*);
+		bool IsTxReconciling() const;
+		void AnnounceTx(const Transaction::KeyType&);
+		void AnnounceTxs(const std::vector<Transaction::KeyType>&, bool bRecon);
+		void OnTxReconcileChanged();
+		void OnTxReconcileTimer();
+		void TakeTxReconcileRound();
+		void get_TxReconcileSketch(TxPool::Sketch&, uint32_t nCells) const;
+		template <typename TMsg>
+		void SendTxReconcile(const TMsg&);
 		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive);
+		bool IsCompactBlockWanted() const;
 
 		bool IsChocking(size_t nExtra = 0);
 		bool ShouldAssignTasks();
@@ -606,9 +953,14 @@ private:
 		virtual void OnMsg(proto::GetBodyPack&&) override;
 		virtual void OnMsg(proto::Body&&) override;
 		virtual void OnMsg(proto::BodyPack&&) override;
+		virtual void OnMsg(proto::GetBodyCompact&&) override;
+		virtual void OnMsg(proto::BodyCompact&&) override;
 		virtual void OnMsg(proto::NewTransaction&&) override;
 		virtual void OnMsg(proto::HaveTransaction&&) override;
 		virtual void OnMsg(proto::GetTransaction&&) override;
+		virtual void OnMsg(proto::TxReconcileReq&&) override;
+		virtual void OnMsg(proto::TxReconcileSketch&&) override;
+		virtual void OnMsg(proto::TxReconcileDiff&&) override;
 		virtual void OnMsg(proto::GetCommonState&&) override;
 		virtual void OnMsg(proto::GetProofState&&) override;
 		virtual void OnMsg(proto::GetProofKernel&&) override;
@@ -636,6 +988,10 @@ private:
 		virtual void OnMsg(proto::GetContractLogProof&&) override;
 		virtual void OnMsg(proto::GetShieldedOutputsAt&&) override;
 		virtual void OnMsg(proto::SetDependentContext&&) override;
+
+#define THE_MACRO(code, msg) virtual bool OnMsg2(proto::msg&&) override;
+		BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
 	};
 
 	typedef boost::intrusive::list<Peer> PeerList;
@@ -88,9 +88,19 @@ void NodeProcessor::Initialize(const char* szPath)
 
 void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 {
-	m_DB.Open(szPath);
+	m_DB.Open(szPath, sp.m_Wal);
 	m_DbTx.Start(m_DB);
 
+	m_Mmr.m_States.set_Cache(sp.m_MmrCache);
+	m_Mmr.m_Shielded.set_Cache(sp.m_MmrCache);
+	m_Mmr.m_Assets.set_Cache(sp.m_MmrCache);
+	m_ParallelContracts.m_MinCount = sp.m_ParallelContracts;
+	m_HashSplit.m_Depth = sp.m_HashSplitDepth;
+	m_HashSplit.m_MinDirty = sp.m_HashSplitMinDirty;
+	m_pBvmProfiler->m_Enabled = sp.m_BvmProfile;
+	m_InterpretStats.m_StatsPeriod_ms = sp.m_StatsPeriod_ms;
+	m_InterpretStats.m_LastLog_ms = GetTimeNnz_ms();
+
 	if (sp.m_CheckIntegrity)
 	{
 		LOG_INFO() << "DB integrity check...";
@@ -164,7 +174,14 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 	m_Mmr.m_Shielded.m_Count = m_DB.ParamIntGetDef(NodeDB::ParamID::ShieldedInputs);
 	m_Mmr.m_Shielded.m_Count += m_Extra.m_ShieldedOutputs;
 
-	InitializeMapped(szPath);
+	bool bMappedRebuilt = InitializeMapped(szPath);
+	if (sp.m_MappedRelayout || bMappedRebuilt)
+	{
+		m_Mapped.m_Utxo.Relayout();
+		m_Mapped.m_Contract.Relayout();
+	}
+
+	InitializeShieldedImage(szPath);
 	m_Extra.m_Txos = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
 
 	bool bRebuildNonStd = false;
@@ -290,13 +307,13 @@ bool NodeProcessor::ManualSelection::IsAllowed(const Merkle::Hash& hv) const
 	return false;
 }
 
-void NodeProcessor::InitializeMapped(const char* sz)
+bool NodeProcessor::InitializeMapped(const char* sz)
 {
 	if (InitMapping(sz, false))
 	{
 		LOG_INFO() << "Mapping image found";
 		if (TestDefinition())
-			return; // ok
+			return false; // ok
 
 		LOG_WARNING() << "Definition mismatch, discarding mapped image";
 		m_Mapped.Close();
@@ -309,6 +326,8 @@ void NodeProcessor::InitializeMapped(const char* sz)
 	NodeDB::WalkerContractData wlk;
 	for (m_DB.ContractDataEnum(wlk); wlk.MoveNext(); )
 		m_Mapped.m_Contract.Toggle(wlk.m_Key, wlk.m_Val, true);
+
+	return true;
 }
 
 void NodeProcessor::TestDefinitionStrict()
@@ -351,9 +370,8 @@ int My_strcmpi(const char* sz1, const char* sz2)
 	return 0;
 }
 
-void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz)
+void NodeProcessor::get_DerivedPath(std::string& sPath, const char* sz, const char* szSufixNew)
 {
-	// derive mapping path from db path
 	sPath = sz;
 
 	static const char szSufix[] = ".db";
@@ -362,7 +380,49 @@ void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz)
 	if ((sPath.size() >= nSufix) && !My_strcmpi(sPath.c_str() + sPath.size() - nSufix, szSufix))
 		sPath.resize(sPath.size() - nSufix);
 
-	sPath += "-utxo-image.bin";
+	sPath += szSufixNew;
+}
+
+void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz)
+{
+	// derive mapping path from db path
+	get_DerivedPath(sPath, sz, "-utxo-image.bin");
+}
+
+void NodeProcessor::get_ShieldedImagePath(std::string& sPath, const char* sz)
+{
+	get_DerivedPath(sPath, sz, "-shielded-image.bin");
+}
+
+void NodeProcessor::InitializeShieldedImage(const char* sz)
+{
+	std::string sPath;
+	get_ShieldedImagePath(sPath, sz);
+
+	ShieldedImage::Stamp us;
+	Blob blob(us);
+
+	if (!m_DB.ParamGet(NodeDB::ParamID::ShieldedImageStamp, nullptr, &blob))
+	{
+		us = 1U;
+		us.Negate();
+	}
+
+	if (m_ShieldedImage.Open(sPath.c_str(), us, m_Extra.m_ShieldedOutputs))
+		return;
+
+	LOG_INFO() << "Rebuilding shielded image...";
+
+	std::vector<ECC::Point::Storage> vec;
+	vec.resize(static_cast<size_t>(std::min<TxoID>(m_Extra.m_ShieldedOutputs, 0x10000)));
+
+	for (TxoID id0 = 0; id0 < m_Extra.m_ShieldedOutputs; )
+	{
+		uint32_t n = static_cast<uint32_t>(std::min<TxoID>(vec.size(), m_Extra.m_ShieldedOutputs - id0));
+		m_DB.ShieldedRead(id0, &vec.front(), n);
+		m_ShieldedImage.Append(&vec.front(), n);
+		id0 += n;
+	}
 }
 
 bool NodeProcessor::InitMapping(const char* sz, bool bForceReset)
@@ -413,11 +473,20 @@ NodeProcessor::Mmr::Mmr(NodeDB& db)
 
 NodeProcessor::NodeProcessor()
 	:m_Mmr(m_DB)
+	,m_pBvmProfiler(std::make_unique<bvm2::Profiler>())
 {
 }
 
 NodeProcessor::~NodeProcessor()
 {
+	if (m_pBvmProfiler->m_Enabled)
+	{
+		std::ostringstream os;
+		m_pBvmProfiler->Dump(os);
+		if (os.tellp())
+			LOG_INFO() << "Contracts profile:\n" << os.str();
+	}
+
 	if (m_DbTx.IsInProgress())
 	{
 		try {
@@ -430,27 +499,35 @@ NodeProcessor::~NodeProcessor()
 
 void NodeProcessor::CommitMappingAndDB()
 {
-	Mapped::Stamp us;
-
-	bool bFlushMapping = (m_Mapped.IsOpen() && m_Mapped.get_Hdr().m_Dirty);
-
-	if (bFlushMapping)
+	auto fnNextStamp = [this](Mapped::Stamp& us, NodeDB::ParamID::Enum eParam)
 	{
 		Blob blob(us);
 
-		if (m_DB.ParamGet(NodeDB::ParamID::MappingStamp, nullptr, &blob)) {
+		if (m_DB.ParamGet(eParam, nullptr, &blob)) {
 			ECC::Hash::Processor() << us >> us;
 		} else {
 			ECC::GenRandom(us);
 		}
 
-		m_DB.ParamSet(NodeDB::ParamID::MappingStamp, nullptr, &blob);
-	}
+		m_DB.ParamSet(eParam, nullptr, &blob);
+	};
+
+	Mapped::Stamp us, usShielded;
+
+	bool bFlushMapping = (m_Mapped.IsOpen() && m_Mapped.get_Hdr().m_Dirty);
+	if (bFlushMapping)
+		fnNextStamp(us, NodeDB::ParamID::MappingStamp);
+
+	bool bFlushShielded = (m_ShieldedImage.IsOpen() && m_ShieldedImage.get_Hdr().m_Dirty);
+	if (bFlushShielded)
+		fnNextStamp(usShielded, NodeDB::ParamID::ShieldedImageStamp);
 
 	m_DbTx.Commit();
 
 	if (bFlushMapping)
 		m_Mapped.FlushStrict(us);
+	if (bFlushShielded)
+		m_ShieldedImage.FlushStrict(usShielded);
 }
 
 void NodeProcessor::Vacuum()
@@ -1010,12 +1087,13 @@ void NodeProcessor::MultiSigmaContext::Calculate(ECC::Point::Native& res, NodePr
 struct NodeProcessor::MultiShieldedContext
 	:public NodeProcessor::MultiSigmaContext
 {
-	ValidatedCache m_Vc;
+	std::map<ValidatedCache::Key, ValidatedCache::ShLo> m_Vc; // verified in this context, not committed yet
 
 	void MoveToGlobalCache(ValidatedCache& vc)
 	{
-		m_Vc.MoveInto(vc);
-		vc.ShrinkTo(10 * 1024);
+		for (const auto& x : m_Vc)
+			vc.Insert(x.first, x.second);
+		m_Vc.clear();
 	}
 
 	bool IsValid(const TxVectors::Eternal&, Height, ECC::InnerProduct::BatchContext&, uint32_t iVerifier, uint32_t nTotal, ValidatedCache&);
@@ -1023,7 +1101,38 @@ struct NodeProcessor::MultiShieldedContext
 
 private:
 
-	Sigma::CmListVec m_Lst;
+	// served directly from the shielded image, no copy
+	struct CmListImage
+		:public Sigma::CmList
+	{
+		const ECC::Point::Compact* m_p = nullptr;
+		uint32_t m_Count = 0;
+
+		virtual bool get_AtNative(ECC::Point::Native& res, uint32_t iIdx) override
+		{
+			if (iIdx >= m_Count)
+				return false;
+
+			const ECC::Point::Compact& pt = m_p[iIdx];
+			if (memis0(&pt, sizeof(pt)))
+				res = Zero;
+			else
+				pt.Assign(res, true);
+
+			return true;
+		}
+
+		virtual bool get_At(ECC::Point::Storage& res, uint32_t iIdx) override
+		{
+			ECC::Point::Native pt;
+			if (!get_AtNative(pt, iIdx))
+				return false;
+
+			pt.Export(res);
+			return true;
+		}
+
+	} m_Lst;
 
 	bool IsValid(const TxKernelShieldedInput&, Height hScheme, std::vector<ECC::Scalar::Native>& vBuf, ECC::InnerProduct::BatchContext&);
 
@@ -1034,8 +1143,14 @@ private:
 
 	virtual void PrepareList(NodeProcessor& np, const Node& n) override
 	{
-		m_Lst.m_vec.resize(s_Chunk); // will allocate if empty
-		np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_Lst.m_vec.front() + n.m_Min, n.m_Max - n.m_Min);
+		TxoID nTotal = np.m_ShieldedImage.get_Count();
+		if (n.m_ID.m_Value < nTotal)
+		{
+			m_Lst.m_p = np.m_ShieldedImage.get_At(n.m_ID.m_Value);
+			m_Lst.m_Count = static_cast<uint32_t>(std::min<TxoID>(s_Chunk, nTotal - n.m_ID.m_Value));
+		}
+		else
+			m_Lst.m_Count = 0;
 	}
 
 	struct Walker
@@ -1113,16 +1228,11 @@ bool NodeProcessor::MultiShieldedContext::IsValid(const TxVectors::Eternal& txve
 					hp >> hv;
 				}
 
-				bool bFound;
+				bool bFound = m_pVc->Find(hv);
+				if (!bFound)
 				{
 					std::unique_lock<std::mutex> scope(m_pThis->m_Mutex);
-
-					bFound =
-						m_pThis->m_Vc.Find(hv) ||
-						m_pVc->Find(hv);
-
-					if (!bFound)
-						m_pThis->m_Vc.Insert(hv, v.m_WindowEnd);
+					bFound = !m_pThis->m_Vc.emplace(hv, v.m_WindowEnd).second;
 				}
 
 				if (!bFound && !m_pThis->IsValid(v, m_Height, m_vKs, *m_pBc))
@@ -1331,6 +1441,89 @@ struct NodeProcessor::MultiblockContext
 		uint32_t m_iVerifier;
 	};
 
+	// Speculative read-ahead. The following blocks are loaded by the caller thread (DB access isn't thread-safe),
+	// and then deserialized (incl. kernel IDs) and hashed by the verification threads, while the current block is interpreted.
+	// The tasks share the FIFO with the bulk verification, hence if not started by the time the block is needed - the caller takes it over.
+	struct Ahead
+	{
+		typedef std::shared_ptr<Ahead> Ptr;
+
+		uint64_t m_Row;
+		ByteBuffer m_bbP;
+		ByteBuffer m_bbE;
+		MyTask::SharedBlock::Ptr m_pShared;
+		Merkle::Hash m_hvKernels;
+		bool m_Ok;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Cond;
+		bool m_Done = false;
+		std::atomic<bool> m_Taken = false; // by a worker or the caller, whichever is first
+
+		Ahead(MultiblockContext& mbc)
+			:m_pShared(std::make_shared<MyTask::SharedBlock>(mbc))
+		{
+		}
+
+		void Exec();
+		bool TryExec();
+		void Wait();
+
+		struct Task
+			:public Executor::TaskAsync
+		{
+			Ahead::Ptr m_pAhead;
+			virtual void Exec(Executor::Context&) override {
+				m_pAhead->TryExec();
+			}
+		};
+	};
+
+	static const uint32_t s_AheadMax = 2; // num of blocks prepared beyond the current one
+	std::list<Ahead::Ptr> m_lstAhead; // in order of interpretation, starting from the current block
+
+	Ahead::Ptr CreateAhead(uint64_t row)
+	{
+		Ahead::Ptr pAhead = std::make_shared<Ahead>(*this);
+		pAhead->m_Row = row;
+		m_This.m_DB.GetStateBlock(row, &pAhead->m_bbP, &pAhead->m_bbE, nullptr);
+		return pAhead;
+	}
+
+	void PushAhead(const uint64_t* pRows, size_t nRows)
+	{
+		// pRows are the blocks to be interpreted (the current one and the following), in reverse order
+		for (size_t i = m_lstAhead.size(); (i < nRows) && (i <= s_AheadMax); i++)
+		{
+			auto pTask = std::make_unique<Ahead::Task>();
+			pTask->m_pAhead = CreateAhead(pRows[nRows - i - 1]);
+			m_lstAhead.push_back(pTask->m_pAhead);
+
+			m_This.get_Executor().Push(std::move(pTask));
+		}
+	}
+
+	Ahead::Ptr PopAhead(uint64_t row)
+	{
+		if (!m_lstAhead.empty())
+		{
+			Ahead::Ptr pAhead = std::move(m_lstAhead.front());
+			m_lstAhead.pop_front();
+
+			if (pAhead->m_Row == row)
+			{
+				pAhead->Wait();
+				return pAhead;
+			}
+
+			m_lstAhead.clear(); // not expected
+		}
+
+		Ahead::Ptr pAhead = CreateAhead(row);
+		pAhead->Exec();
+		return pAhead;
+	}
+
 	bool Flush()
 	{
 		FlushInternal();
@@ -1660,12 +1853,17 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 
 	NodeDB::StateID sidFwd = m_Cursor.m_Sid;
 
+	uint64_t t0_us = GetTime_us();
+	Height h0 = m_Cursor.m_Sid.m_Height;
+
 	size_t iPos = vPath.size();
 	while (iPos)
 	{
 		sidFwd.m_Height = m_Cursor.m_Sid.m_Height + 1;
 		sidFwd.m_Row = vPath[--iPos];
 
+		mbc.PushAhead(&vPath.front(), iPos + 1);
+
 		Block::SystemState::Full s;
 		m_DB.get_State(sidFwd.m_Row, s); // need it for logging anyway
 
@@ -1707,7 +1905,10 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	}
 
 	if (mbc.Flush())
+	{
+		OnBlocksInterpreted(m_Cursor.m_Sid.m_Height - h0, t0_us);
 		return; // at position
+	}
 
 	if (!bContextFail)
 		LOG_WARNING() << "Context-free verification failed";
@@ -2093,7 +2294,7 @@ bool NodeProcessor::Evaluator::get_History(Merkle::Hash& hv)
 
 bool NodeProcessor::Evaluator::get_Utxos(Merkle::Hash& hv)
 {
-	m_Proc.m_Mapped.m_Utxo.get_Hash(hv);
+	m_Proc.m_Mapped.m_Utxo.get_Hash(hv, m_Proc.get_Executor(), m_Proc.m_HashSplit.m_Depth, m_Proc.m_HashSplit.m_MinDirty);
 	return true;
 }
 
@@ -2134,7 +2335,7 @@ bool NodeProcessor::Evaluator::get_Assets(Merkle::Hash& hv)
 
 bool NodeProcessor::Evaluator::get_Contracts(Merkle::Hash& hv)
 {
-	m_Proc.m_Mapped.m_Contract.get_Hash(hv);
+	m_Proc.m_Mapped.m_Contract.get_Hash(hv, m_Proc.get_Executor(), m_Proc.m_HashSplit.m_Depth, m_Proc.m_HashSplit.m_MinDirty);
 	return true;
 }
 
@@ -2339,6 +2540,36 @@ bool NodeProcessor::get_ProofContractLog(Merkle::Proof& proof, const HeightPos&
 	return true;
 }
 
+struct NodeProcessor::ModuleCache::Impl
+{
+	typedef bvm2::Processor::Module Module;
+
+	struct Entry
+		:public intrusive::set_base_hook<bvm2::ContractID>
+		,public boost::intrusive::list_base_hook<>
+	{
+		Module::Ptr m_pMod;
+	};
+
+	intrusive::multiset<Entry> m_Set;
+	boost::intrusive::list<Entry> m_Lru; // front = most recently used
+
+	size_t m_Size = 0;
+	uint64_t m_Hits = 0;
+	uint64_t m_Misses = 0;
+	uint64_t m_Invalidations = 0;
+
+	mutable std::mutex m_Mutex;
+
+	~Impl() { DeleteAll(); }
+
+	Module::Ptr Find(const bvm2::ContractID&);
+	void Insert(const bvm2::ContractID&, const Module::Ptr&, size_t nSizeMax);
+	bool Erase(const bvm2::ContractID&);
+	void Delete(Entry&);
+	void DeleteAll();
+};
+
 struct NodeProcessor::BlockInterpretCtx
 {
 	Height m_Height;
@@ -2352,6 +2583,7 @@ struct NodeProcessor::BlockInterpretCtx
 	bool m_TxValidation = false; // tx or block
 	bool m_DependentCtxSet = false;
 	bool m_SkipInOuts = false;
+	bool m_CodeModified = false; // contract code was modified w/o writing to DB (temporary context, or data section written in-place), the module cache doesn't reflect it
 	uint8_t m_TxStatus = proto::TxStatus::Unspecified;
 	std::ostream* m_pTxErrorInfo = nullptr;
 
@@ -2392,6 +2624,61 @@ struct NodeProcessor::BlockInterpretCtx
 	typedef std::multiset<Blob> BlobPtrSet; // like BlobMap, but buffers are not allocated/copied
 	BlobPtrSet m_KrnIDs; // mirrors kernel ID DB table in temporary mode
 
+	struct Parallel
+	{
+		// Optimistic concurrent pre-execution of the block contract invocations, against the state at the block start.
+		// The recorded effects are consumed in block order, if nothing the invocation observed was modified meanwhile.
+		struct Range
+		{
+			// LoadVarEx result: the nearest existing var from m_Key0 (inclusive) in the given direction
+			ByteBuffer m_Key0;
+			ByteBuffer m_Key1;
+			bool m_Bigger;
+			bool m_Found;
+		};
+
+		struct Effect
+		{
+			ByteBuffer m_Key;
+			ByteBuffer m_Val;
+			bool m_Log; // otherwise var write
+		};
+
+		struct Entry
+		{
+			const TxKernelContractInvoke* m_pKrn;
+			bool m_Ok = false;
+			uint32_t m_LogsBase = 0; // log position assumed at the invocation start
+			uint32_t m_Logs = 0;
+			uint32_t m_Charge = 0;
+
+			std::vector<ByteBuffer> m_vReads; // all the vars accessed
+			std::vector<Range> m_vRanges;
+			std::vector<Effect> m_vEffects;
+			bvm2::Profiler::Map m_Prof; // accounted only if committed
+		};
+
+		std::vector<Entry> m_vEntries;
+		size_t m_iNext = 0;
+		size_t m_Committed = 0;
+
+		BlobMap::Set m_Written; // vars modified in this block so far
+		std::mutex m_MutexDB; // serializes the workers DB access
+
+		struct Worker;
+
+		bool Execute(NodeProcessor&, const BlockInterpretCtx&, const std::vector<TxKernel::Ptr>&);
+		const Entry* Take(const TxKernelContractInvoke&, const BlockInterpretCtx&);
+		void OnWritten(const Blob& key);
+
+	private:
+		void Run(NodeProcessor&, const BlockInterpretCtx&, const std::vector<uint32_t>&);
+		void Run(NodeProcessor&, const BlockInterpretCtx&, Entry&);
+		bool IsValid(const Entry&, const BlockInterpretCtx&);
+	};
+
+	Parallel* m_pParallel = nullptr;
+
 	struct BvmProcessor
 		:public bvm2::ProcessorContract
 	{
@@ -2415,6 +2702,8 @@ struct NodeProcessor::BlockInterpretCtx
 
 		BvmProcessor(BlockInterpretCtx& bic, NodeProcessor& db);
 
+		static bvm2::Profiler* get_Profiler(const BlockInterpretCtx&, NodeProcessor&); // only the blocks being applied are profiled
+
 		virtual void LoadVar(const Blob& key, Blob& res) override;
 		virtual void LoadVarEx(Blob& key, Blob& res, bool bExact, bool bBigger) override;
 		virtual uint32_t SaveVar(const Blob& key, const Blob&) override;
@@ -2431,7 +2720,9 @@ struct NodeProcessor::BlockInterpretCtx
 		bool EnsureNoVars(const bvm2::ContractID&);
 		static bool IsOwnedVar(const bvm2::ContractID&, const Blob& key);
 
-		bool Invoke(const bvm2::ContractID&, uint32_t iMethod, const TxKernelContractControl&);
+		bool Invoke(const bvm2::ContractID&, uint32_t iMethod, const TxKernelContractControl&, const Parallel::Entry* pPre = nullptr);
+		void Execute(const bvm2::ContractID&, uint32_t iMethod, const TxKernelContractControl&);
+		void Replay(const Parallel::Entry&);
 
 		void UndoVars();
 
@@ -2445,6 +2736,10 @@ struct NodeProcessor::BlockInterpretCtx
 
 		virtual void CallFar(const bvm2::ContractID&, uint32_t iMethod, Wasm::Word pArgs, uint8_t bInheritContext) override;
 		virtual void OnRet(Wasm::Word nRetAddr) override;
+		virtual Module::Ptr LoadModule(const bvm2::ContractID&) override;
+		virtual void OnDataWrite() override;
+
+		void OnContractDataChanged(const Blob& key);
 	};
 
 	uint32_t m_ChargePerBlock = bvm2::Limits::BlockCharge;
@@ -2691,6 +2986,104 @@ struct NodeProcessor::MyRecognizer
 };
 
 
+void NodeProcessor::MultiblockContext::Ahead::Exec()
+{
+	Block::Body& block = m_pShared->m_Body;
+
+	try {
+		Deserializer der;
+		der.reset(m_bbP);
+		der & Cast::Down<Block::BodyBase>(block);
+		der & Cast::Down<TxVectors::Perishable>(block);
+
+		der.reset(m_bbE);
+		der & Cast::Down<TxVectors::Eternal>(block);
+
+		KrnFlyMmr fmmr(block);
+		fmmr.get_Hash(m_hvKernels);
+
+		m_Ok = true;
+	}
+	catch (const std::exception&) {
+		m_Ok = false;
+	}
+
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	m_Done = true;
+	m_Cond.notify_one();
+}
+
+bool NodeProcessor::MultiblockContext::Ahead::TryExec()
+{
+	if (m_Taken.exchange(true))
+		return false;
+
+	Exec();
+	return true;
+}
+
+void NodeProcessor::MultiblockContext::Ahead::Wait()
+{
+	if (TryExec())
+		return; // the worker didn't get to it yet
+
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	while (!m_Done)
+		m_Cond.wait(scope);
+}
+
+void NodeProcessor::OnBlocksInterpreted(Height dh, uint64_t t0_us)
+{
+	if (!dh)
+		return;
+
+	uint64_t dt_us = GetTime_us() - t0_us;
+	m_InterpretStats.m_Blocks += dh;
+	m_InterpretStats.m_Time_us += dt_us;
+
+	if (dh > 1)
+		LOG_DEBUG() << "Interpreted " << dh << " blocks, " << (dh * 1000000. / std::max<uint64_t>(dt_us, 1)) << " blocks/sec";
+
+	MaybeLogStats();
+}
+
+void NodeProcessor::MaybeLogStats()
+{
+	uint32_t nPeriod_ms = m_InterpretStats.m_StatsPeriod_ms;
+	if (!nPeriod_ms || (GetTime_ms() - m_InterpretStats.m_LastLog_ms < nPeriod_ms))
+		return;
+
+	m_InterpretStats.m_LastLog_ms = GetTimeNnz_ms();
+
+	// all the counters are cumulative
+	const NodeDB::KeyFilter::Stats& sk = m_DB.get_KrnFilterStats();
+	const NodeDB::KeyFilter::Stats& su = m_DB.get_UniqueFilterStats();
+	const NodeDB::StreamMmr::Stats& ms = m_Mmr.m_Shielded.get_Stats();
+	const NodeDB::StreamMmr::Stats& ma = m_Mmr.m_Assets.get_Stats();
+
+	ModuleCache::Stats mcs;
+	m_ModuleCache.get_Stats(mcs);
+
+	ValidatedCache::Stats vcs;
+	m_ValCache.get_Stats(vcs);
+
+	const ParallelContracts::Stats& pcs = m_ParallelContracts.m_Stats;
+
+	LOG_INFO() << "Interpreted " << m_InterpretStats.m_Blocks << " blocks, " << m_InterpretStats.get_BlocksPerSec() << " blocks/sec"
+		<< "\n\tKey filters: kernels " << sk.m_Negative << " neg / " << sk.m_Positive << " pos, fp rate " << sk.get_FpRate()
+		<< "; unique " << su.m_Negative << " neg / " << su.m_Positive << " pos, fp rate " << su.get_FpRate()
+		<< "\n\tMmr caches: shielded " << ms.m_Hits << " hit / " << ms.m_HitsPinned << " pinned / " << ms.m_Misses << " miss, hit rate " << ms.get_HitRate()
+		<< "; assets " << ma.m_Hits << " hit / " << ma.m_HitsPinned << " pinned / " << ma.m_Misses << " miss, hit rate " << ma.get_HitRate()
+		<< "\n\tModule cache: " << mcs.m_Count << " modules, " << mcs.m_Size << " bytes, " << mcs.m_Hits << " hit / " << mcs.m_Misses << " miss / " << mcs.m_Invalidations << " invalidated"
+		<< "\n\tValidated cache: " << vcs.m_Hits << " hit / " << vcs.m_Misses << " miss / " << vcs.m_Evictions << " evicted"
+		<< "\n\tParallel contracts: " << pcs.m_Blocks << " blocks, " << pcs.m_Executed << " executed (" << pcs.m_Repeated << " repeated), " << pcs.m_Committed << " committed";
+}
+
+double NodeProcessor::InterpretStats::get_BlocksPerSec() const
+{
+	return m_Time_us ? (m_Blocks * 1000000. / m_Time_us) : 0.;
+}
+
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemState::Full& s, MultiblockContext& mbc)
 {
 	if (s.m_Height == m_ManualSelection.m_Sid.m_Height)
@@ -2702,26 +3095,19 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 			return false;
 	}
 
-	ByteBuffer bbP, bbE;
-	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE, nullptr);
-
-	MultiblockContext::MyTask::SharedBlock::Ptr pShared = std::make_shared<MultiblockContext::MyTask::SharedBlock>(mbc);
-	Block::Body& block = pShared->m_Body;
-
-	try {
-		Deserializer der;
-		der.reset(bbP);
-		der & Cast::Down<Block::BodyBase>(block);
-		der & Cast::Down<TxVectors::Perishable>(block);
-
-		der.reset(bbE);
-		der & Cast::Down<TxVectors::Eternal>(block);
-	}
-	catch (const std::exception&) {
+	MultiblockContext::Ahead::Ptr pAhead = mbc.PopAhead(sid.m_Row);
+	if (!pAhead->m_Ok)
+	{
 		LOG_WARNING() << LogSid(m_DB, sid) << " Block deserialization failed";
 		return false;
 	}
 
+	ByteBuffer& bbP = pAhead->m_bbP;
+	ByteBuffer& bbE = pAhead->m_bbE;
+
+	MultiblockContext::MyTask::SharedBlock::Ptr pShared = pAhead->m_pShared;
+	Block::Body& block = pShared->m_Body;
+
 	bool bFirstTime = (m_DB.get_StateTxos(sid.m_Row) == MaxHeight);
 	if (bFirstTime)
 	{
@@ -2770,7 +3156,12 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 	if (m_DB.ParamIntGetDef(NodeDB::ParamID::RichContractInfo))
 		bic.m_pvC = &vC;
 
+	BlockInterpretCtx::Parallel par;
+	if (!bic.m_pvC && par.Execute(*this, bic, block.m_vKernels))
+		bic.m_pParallel = &par;
+
 	bool bOk = HandleValidatedBlock(block, bic);
+	m_ParallelContracts.m_Stats.m_Committed += par.m_Committed;
 	if (!bOk)
 	{
 		assert(bFirstTime);
@@ -2783,7 +3174,7 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 	}
 
 	EvaluatorEx ev(*this);
-	ev.set_Kernels(block);
+	ev.m_hvKernels = pAhead->m_hvKernels; // same as ev.set_Kernels(block), already calculated
 	ev.set_Logs(bic.m_vLogs);
 
 	Merkle::Hash hvDef;
@@ -3309,8 +3700,10 @@ bool NodeProcessor::HandleKernelType(const TxKernelContractInvoke& krn, BlockInt
 			return false; // c'tor call attempt
 		}
 
+		const BlockInterpretCtx::Parallel::Entry* pPre = bic.m_pParallel ? bic.m_pParallel->Take(krn, bic) : nullptr;
+
 		BlockInterpretCtx::BvmProcessor proc(bic, *this);
-		if (!proc.Invoke(krn.m_Cid, krn.m_iMethod, krn))
+		if (!proc.Invoke(krn.m_Cid, krn.m_iMethod, krn, pPre))
 			return false;
 
 		if (1 == krn.m_iMethod)
@@ -3815,6 +4208,9 @@ bool NodeProcessor::HandleKernelType(const TxKernelShieldedOutput& krn, BlockInt
 			m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs + 1, m_Extra.m_ShieldedOutputs);
 			m_DB.ShieldedWrite(m_Extra.m_ShieldedOutputs, &pt_s, 1);
 
+			assert(m_ShieldedImage.get_Count() == m_Extra.m_ShieldedOutputs);
+			m_ShieldedImage.Append(&pt_s, 1);
+
 			// Append state hash
 			ECC::Hash::Value hvState;
 			if (m_Extra.m_ShieldedOutputs)
@@ -3854,6 +4250,7 @@ bool NodeProcessor::HandleKernelType(const TxKernelShieldedOutput& krn, BlockInt
 		{
 			m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs - 1, m_Extra.m_ShieldedOutputs);
 			m_DB.ShieldedStateResize(m_Extra.m_ShieldedOutputs - 1, m_Extra.m_ShieldedOutputs);
+			m_ShieldedImage.Truncate(m_Extra.m_ShieldedOutputs - 1);
 		}
 
 		if (!bic.m_SkipDefinition)
@@ -4516,6 +4913,8 @@ NodeProcessor::BlockInterpretCtx::BvmProcessor::BvmProcessor(BlockInterpretCtx&
 	:m_Bic(bic)
 	,m_Proc(proc)
 {
+	m_pProfiler = get_Profiler(bic, proc);
+
 	if (bic.m_Fwd)
 	{
 		BlockInterpretCtx::Ser ser(bic);
@@ -4525,46 +4924,81 @@ NodeProcessor::BlockInterpretCtx::BvmProcessor::BvmProcessor(BlockInterpretCtx&
 	}
 }
 
-bool NodeProcessor::BlockInterpretCtx::BvmProcessor::Invoke(const bvm2::ContractID& cid, uint32_t iMethod, const TxKernelContractControl& krn)
+bvm2::Profiler* NodeProcessor::BlockInterpretCtx::BvmProcessor::get_Profiler(const BlockInterpretCtx& bic, NodeProcessor& proc)
 {
-	bool bRes = false;
-	try
-	{
-		m_Charge = m_Bic.m_ChargePerBlock;
+	// skip the tx validation, block template generation, and etc.
+	if (!bic.m_Fwd || bic.m_Temporary || bic.m_TxValidation || !proc.m_pBvmProfiler->m_Enabled)
+		return nullptr;
 
-		if (m_Bic.m_pTxErrorInfo)
-			m_FarCalls.m_SaveLocal = true;
+	return proc.m_pBvmProfiler.get();
+}
 
-		InitStackPlus(m_Stack.AlignUp(static_cast<uint32_t>(krn.m_Args.size())));
-		m_Stack.PushAlias(krn.m_Args);
+void NodeProcessor::BlockInterpretCtx::BvmProcessor::Execute(const bvm2::ContractID& cid, uint32_t iMethod, const TxKernelContractControl& krn)
+{
+	if (m_Bic.m_pTxErrorInfo)
+		m_FarCalls.m_SaveLocal = true;
 
-		m_Instruction.m_Mode = 
-			IsPastHF4() ?
-			Wasm::Reader::Mode::Standard :
-			m_Bic.m_TxValidation ?
-				Wasm::Reader::Mode::Restrict :
-				Wasm::Reader::Mode::Emulate_x86;
+	InitStackPlus(m_Stack.AlignUp(static_cast<uint32_t>(krn.m_Args.size())));
+	m_Stack.PushAlias(krn.m_Args);
 
-		CallFar(cid, iMethod, m_Stack.get_AlasSp(), 0);
+	m_Instruction.m_Mode = 
+		IsPastHF4() ?
+		Wasm::Reader::Mode::Standard :
+		m_Bic.m_TxValidation ?
+			Wasm::Reader::Mode::Restrict :
+			Wasm::Reader::Mode::Emulate_x86;
 
-		ECC::Hash::Processor hp;
+	CallFar(cid, iMethod, m_Stack.get_AlasSp(), 0);
 
-		if (!m_Bic.m_AlreadyValidated)
-		{
-			const auto& hvCtx = m_Bic.m_DependentCtxSet ? m_Bic.m_hvDependentCtx : m_Proc.m_Cursor.m_Full.m_Prev;
-			krn.Prepare(hp, &hvCtx);
+	ECC::Hash::Processor hp;
 
-			m_pSigValidate = &hp;
-		}
+	if (!m_Bic.m_AlreadyValidated)
+	{
+		const auto& hvCtx = m_Bic.m_DependentCtxSet ? m_Bic.m_hvDependentCtx : m_Proc.m_Cursor.m_Full.m_Prev;
+		krn.Prepare(hp, &hvCtx);
 
-		while (!IsDone())
-		{
-			DischargeUnits(bvm2::Limits::Cost::Cycle);
-			RunOnce();
-		}
+		m_pSigValidate = &hp;
+	}
 
-		if (!m_Bic.m_AlreadyValidated)
-			CheckSigs(krn.m_Commitment, krn.m_Signature);
+	while (!IsDone())
+		RunBatch();
+
+	if (!m_Bic.m_AlreadyValidated)
+		CheckSigs(krn.m_Commitment, krn.m_Signature);
+}
+
+void NodeProcessor::BlockInterpretCtx::BvmProcessor::Replay(const Parallel::Entry& e)
+{
+	// same changes in the same order, as the execution would make
+	for (const auto& x : e.m_vEffects)
+	{
+		if (x.m_Log)
+			OnLog(x.m_Key, x.m_Val);
+		else
+			SaveVar(x.m_Key, x.m_Val);
+	}
+
+	assert(m_Charge >= e.m_Charge);
+	m_Charge -= e.m_Charge;
+
+	if (m_pProfiler)
+	{
+		for (const auto& x : e.m_Prof)
+			m_ProfilerData[x.first] += x.second;
+	}
+}
+
+bool NodeProcessor::BlockInterpretCtx::BvmProcessor::Invoke(const bvm2::ContractID& cid, uint32_t iMethod, const TxKernelContractControl& krn, const Parallel::Entry* pPre)
+{
+	bool bRes = false;
+	try
+	{
+		m_Charge = m_Bic.m_ChargePerBlock;
+
+		if (pPre)
+			Replay(*pPre);
+		else
+			Execute(cid, iMethod, krn);
 
 		bRes = true;
 
@@ -4914,6 +5348,9 @@ uint32_t NodeProcessor::BlockInterpretCtx::BvmProcessor::SaveVar(const Blob& key
 			ser & e.m_Data;
 
 		data.Export(e.m_Data);
+
+		if (m_Bic.m_pParallel)
+			m_Bic.m_pParallel->OnWritten(key);
 	}
 
 	return nOldSize;
@@ -4924,6 +5361,7 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataInsert(const Bl
 	ContractDataToggleTree(key, data, true);
 	if (!m_Bic.m_Temporary)
 		m_Proc.m_DB.ContractDataInsert(key, data);
+	OnContractDataChanged(key);
 }
 
 void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataUpdate(const Blob& key, const Blob& val, const Blob& valOld)
@@ -4932,6 +5370,7 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataUpdate(const Bl
 	ContractDataToggleTree(key, valOld, false);
 	if (!m_Bic.m_Temporary)
 		m_Proc.m_DB.ContractDataUpdate(key, val);
+	OnContractDataChanged(key);
 }
 
 void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataDel(const Blob& key, const Blob& valOld)
@@ -4939,23 +5378,58 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::ContractDataDel(const Blob&
 	ContractDataToggleTree(key, valOld, false);
 	if (!m_Bic.m_Temporary)
 		m_Proc.m_DB.ContractDataDel(key);
+	OnContractDataChanged(key);
 }
 
-bool NodeProcessor::Mapped::Contract::IsStored(const Blob& key)
+void NodeProcessor::BlockInterpretCtx::BvmProcessor::OnContractDataChanged(const Blob& key)
 {
-	if (key.n > bvm2::ContractID::nBytes)
-	{
-		uint8_t nTag = reinterpret_cast<const uint8_t*>(key.p)[bvm2::ContractID::nBytes];
-		if (Shaders::KeyTag::InternalStealth == nTag)
-			return false;
-	}
+	if (key.n != bvm2::ContractID::nBytes)
+		return; // not a contract code
 
-	return true;
+	if (m_Bic.m_Temporary)
+		m_Bic.m_CodeModified = true;
+	else
+		m_Proc.m_ModuleCache.Invalidate(key); // deploy, upgrade, destroy, or their rollback
 }
 
-void NodeProcessor::Mapped::Contract::Toggle(const Blob& key, const Blob& data, bool bAdd)
+void NodeProcessor::BlockInterpretCtx::BvmProcessor::OnDataWrite()
 {
-	if (!IsStored(key))
+	ProcessorContract::OnDataWrite();
+	m_Bic.m_CodeModified = true; // the contract variable may be modified in-place
+}
+
+bvm2::Processor::Module::Ptr NodeProcessor::BlockInterpretCtx::BvmProcessor::LoadModule(const bvm2::ContractID& cid)
+{
+	if (m_Bic.m_CodeModified)
+		return ProcessorContract::LoadModule(cid);
+
+	auto& mc = *m_Proc.m_ModuleCache.m_pImpl;
+
+	auto pMod = mc.Find(cid);
+	if (!pMod)
+	{
+		pMod = ProcessorContract::LoadModule(cid);
+		mc.Insert(cid, pMod, m_Proc.m_ModuleCache.m_SizeMax);
+	}
+
+	return pMod;
+}
+
+bool NodeProcessor::Mapped::Contract::IsStored(const Blob& key)
+{
+	if (key.n > bvm2::ContractID::nBytes)
+	{
+		uint8_t nTag = reinterpret_cast<const uint8_t*>(key.p)[bvm2::ContractID::nBytes];
+		if (Shaders::KeyTag::InternalStealth == nTag)
+			return false;
+	}
+
+	return true;
+}
+
+void NodeProcessor::Mapped::Contract::Toggle(const Blob& key, const Blob& data, bool bAdd)
+{
+	if (!IsStored(key))
 		return;
 
 	Merkle::Hash hv;
@@ -5188,6 +5662,9 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::UndoVars()
 				der & key;
 				auto& e = m_Bic.get_ContractVar(key, m_Proc.m_DB);
 
+				if (m_Bic.m_pParallel)
+					m_Bic.m_pParallel->OnWritten(key);
+
 				if (RecoveryTag::Delete == nTag)
 				{
 					ContractDataDel(key, e.m_Data);
@@ -5328,6 +5805,253 @@ void NodeProcessor::BlockInterpretCtx::BvmProcessor::OnRet(Wasm::Word nRetAddr)
 	}
 }
 
+struct NodeProcessor::BlockInterpretCtx::Parallel::Worker
+	:public BvmProcessor
+{
+	Parallel& m_Par;
+	Entry& m_Entry;
+
+	Worker(BlockInterpretCtx& bic, NodeProcessor& np, Parallel& par, Entry& e)
+		:BvmProcessor(bic, np)
+		,m_Par(par)
+		,m_Entry(e)
+	{
+	}
+
+	void FetchVar(const Blob& key)
+	{
+		std::unique_lock<std::mutex> scope(m_Par.m_MutexDB);
+		m_Bic.get_ContractVar(key, m_Proc.m_DB);
+	}
+
+	virtual void LoadVar(const Blob& key, Blob& res) override
+	{
+		FetchVar(key);
+		BvmProcessor::LoadVar(key, res);
+	}
+
+	virtual Module::Ptr LoadModule(const bvm2::ContractID& cid) override
+	{
+		FetchVar(cid); // the code is read even if the module is cached, it may be modified by the preceding kernels
+		return BvmProcessor::LoadModule(cid);
+	}
+
+	virtual void LoadVarEx(Blob& key, Blob& res, bool bExact, bool bBigger) override
+	{
+		auto& r = m_Entry.m_vRanges.emplace_back();
+		key.Export(r.m_Key0);
+		r.m_Bigger = bBigger;
+
+		{
+			std::unique_lock<std::mutex> scope(m_Par.m_MutexDB);
+			BvmProcessor::LoadVarEx(key, res, bExact, bBigger);
+		}
+
+		r.m_Found = (key.n > 0);
+		key.Export(r.m_Key1);
+	}
+
+	virtual uint32_t SaveVar(const Blob& key, const Blob& data) override
+	{
+		FetchVar(key);
+
+		if (Blob(m_Bic.get_ContractVar(key, m_Proc.m_DB).m_Data) != data)
+		{
+			auto& x = m_Entry.m_vEffects.emplace_back();
+			key.Export(x.m_Key);
+			data.Export(x.m_Val);
+			x.m_Log = false;
+		}
+
+		return BvmProcessor::SaveVar(key, data);
+	}
+
+	virtual uint32_t OnLog(const Blob& key, const Blob& val) override
+	{
+		auto& x = m_Entry.m_vEffects.emplace_back();
+		key.Export(x.m_Key);
+		val.Export(x.m_Val);
+		x.m_Log = true;
+		m_Entry.m_Logs++;
+
+		return BvmProcessor::OnLog(key, val);
+	}
+
+	virtual bool get_HdrAt(Block::SystemState::Full& s) override
+	{
+		std::unique_lock<std::mutex> scope(m_Par.m_MutexDB);
+		return BvmProcessor::get_HdrAt(s);
+	}
+
+	// Assets are not mirrored, such invocations are executed serially
+	virtual Asset::ID AssetCreate(const Asset::Metadata&, const PeerID&) override
+	{
+		Wasm::Fail();
+		return 0;
+	}
+
+	virtual bool AssetEmit(Asset::ID, const PeerID&, AmountSigned) override
+	{
+		Wasm::Fail();
+		return false;
+	}
+
+	virtual bool AssetDestroy(Asset::ID, const PeerID&) override
+	{
+		Wasm::Fail();
+		return false;
+	}
+};
+
+bool NodeProcessor::BlockInterpretCtx::Parallel::Execute(NodeProcessor& np, const BlockInterpretCtx& bic, const std::vector<TxKernel::Ptr>& vKrn)
+{
+	uint32_t nMin = np.m_ParallelContracts.m_MinCount;
+	if (!nMin || (np.get_Executor().get_Threads() < 2))
+		return false;
+
+	for (const auto& pKrn : vKrn)
+	{
+		if ((TxKernel::Subtype::ContractInvoke != pKrn->get_Subtype()) || !pKrn->m_vNested.empty())
+			continue;
+
+		const auto& krn = Cast::Up<TxKernelContractInvoke>(*pKrn);
+		if (krn.m_iMethod < 2)
+			continue; // c'tor and d'tor are always serial
+
+		m_vEntries.emplace_back().m_pKrn = &krn;
+	}
+
+	if (m_vEntries.size() < std::max(nMin, 2U))
+	{
+		m_vEntries.clear();
+		return false;
+	}
+
+	std::vector<uint32_t> vIdx(m_vEntries.size());
+	for (uint32_t i = 0; i < vIdx.size(); i++)
+		vIdx[i] = i;
+
+	Run(np, bic, vIdx);
+
+	// Log positions are visible to the contract. Once the counts are known, re-run those that assumed a wrong one
+	vIdx.clear();
+	uint32_t nLogs = bic.m_ContractLogs;
+
+	for (uint32_t i = 0; i < m_vEntries.size(); i++)
+	{
+		auto& e = m_vEntries[i];
+		if (!e.m_Ok)
+			continue;
+
+		if (e.m_Logs && (e.m_LogsBase != nLogs))
+		{
+			e.m_LogsBase = nLogs;
+			vIdx.push_back(i);
+		}
+
+		nLogs += e.m_Logs;
+	}
+
+	if (!vIdx.empty())
+		Run(np, bic, vIdx);
+
+	auto& st = np.m_ParallelContracts.m_Stats;
+	st.m_Blocks++;
+	st.m_Executed += m_vEntries.size();
+	st.m_Repeated += vIdx.size();
+
+	return true;
+}
+
+void NodeProcessor::BlockInterpretCtx::Parallel::Run(NodeProcessor& np, const BlockInterpretCtx& bic, const std::vector<uint32_t>& vIdx)
+{
+	// Not ExecAll: the verification tasks of the blocks ahead may be queued, don't wait for them
+	np.get_Executor().ExecItems(static_cast<uint32_t>(vIdx.size()), [this, &np, &bic, &vIdx](uint32_t i)
+	{
+		// contract signatures must be verified right away, not deferred to the thread batch
+		ECC::InnerProduct::BatchContext* pBc = nullptr;
+		TemporarySwap<ECC::InnerProduct::BatchContext*> swp(pBc, ECC::InnerProduct::BatchContext::s_pInstance);
+
+		Run(np, bic, m_vEntries[vIdx[i]]);
+	});
+}
+
+void NodeProcessor::BlockInterpretCtx::Parallel::Run(NodeProcessor& np, const BlockInterpretCtx& bic, Entry& e)
+{
+	e.m_vReads.clear();
+	e.m_vRanges.clear();
+	e.m_vEffects.clear();
+	e.m_Prof.clear();
+	e.m_Logs = 0;
+
+	BlockInterpretCtx bic2(bic.m_Height, true);
+	bic2.m_Temporary = true; // changes are only recorded
+	bic2.m_SkipDefinition = true;
+	bic2.m_AlreadyValidated = bic.m_AlreadyValidated;
+	bic2.m_TxValidation = bic.m_TxValidation;
+	bic2.m_ChargePerBlock = bic.m_ChargePerBlock;
+	bic2.m_ContractLogs = e.m_LogsBase;
+
+	Worker wrk(bic2, np, *this, e);
+	wrk.m_pProfiler = BvmProcessor::get_Profiler(bic, np); // bic2 is temporary, the stats are accounted wrt the original context
+	e.m_Ok = wrk.Invoke(e.m_pKrn->m_Cid, e.m_pKrn->m_iMethod, *e.m_pKrn);
+	e.m_Charge = bic.m_ChargePerBlock - bic2.m_ChargePerBlock;
+	e.m_Prof.swap(wrk.m_ProfilerData);
+	wrk.m_pProfiler = nullptr; // don't account the leftovers
+
+	// all the accessed vars (incl. written) are cached in the context
+	for (const auto& x : bic2.m_ContractVars)
+		x.ToBlob().Export(e.m_vReads.emplace_back());
+}
+
+const NodeProcessor::BlockInterpretCtx::Parallel::Entry* NodeProcessor::BlockInterpretCtx::Parallel::Take(const TxKernelContractInvoke& krn, const BlockInterpretCtx& bic)
+{
+	if ((m_iNext >= m_vEntries.size()) || (m_vEntries[m_iNext].m_pKrn != &krn))
+		return nullptr;
+
+	const Entry& e = m_vEntries[m_iNext++];
+	if (!IsValid(e, bic))
+		return nullptr;
+
+	m_Committed++;
+	return &e;
+}
+
+bool NodeProcessor::BlockInterpretCtx::Parallel::IsValid(const Entry& e, const BlockInterpretCtx& bic)
+{
+	if (!e.m_Ok || (e.m_Charge > bic.m_ChargePerBlock))
+		return false;
+
+	if (e.m_Logs && (e.m_LogsBase != bic.m_ContractLogs))
+		return false;
+
+	for (const auto& key : e.m_vReads)
+		if (m_Written.Find(key))
+			return false;
+
+	for (const auto& r : e.m_vRanges)
+	{
+		auto* pW = m_Written.FindVarEx(r.m_Key0, true, r.m_Bigger);
+		if (!pW)
+			continue;
+
+		if (!r.m_Found)
+			return false;
+
+		int n = pW->ToBlob().cmp(r.m_Key1);
+		if (r.m_Bigger ? (n <= 0) : (n >= 0))
+			return false; // a var modified within the observed range
+	}
+
+	return true;
+}
+
+void NodeProcessor::BlockInterpretCtx::Parallel::OnWritten(const Blob& key)
+{
+	if (!m_Written.Find(key))
+		m_Written.Create(key);
+}
+
 void NodeProcessor::ToInputWithMaturity(Input& inp, Output& outp, bool bNake)
 {
 	// awkward and relatively used, but this is not used frequently.
@@ -6096,14 +6820,20 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 		++nTxNum;
 	}
 
-	for (TxPool::Fluff::ProfitSet::iterator it = bc.m_TxPool.m_setProfit.begin(); bc.m_TxPool.m_setProfit.end() != it; )
-	{
-		TxPool::Fluff::Element& x = (it++)->get_ParentObj();
+	BlockTemplate& bt = m_Template;
+	bt.m_Incremental = bt.IsValidFor(bc, m_Cursor.m_ID);
 
+	std::vector<TxPool::Fluff::Element*> vSel;
+	bool bSkipped = false;
 
+	auto fnTryTx = [&](TxPool::Fluff::Element& x)
+	{
 		Amount feesNext = bc.m_Fees + x.m_Profit.m_Stats.m_Fee;
 		if (feesNext < bc.m_Fees)
-			continue; // huge fees are unsupported
+		{
+			bSkipped = true;
+			return; // huge fees are unsupported
+		}
 
 		size_t nSizeNext = ssc.m_Counter.m_Value + x.m_Profit.m_Stats.m_Size;
 		if (!bc.m_Fees && feesNext)
@@ -6119,7 +6849,9 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 				LOG_INFO() << "Tx is too big.";
 				bc.m_TxPool.Delete(x);
 			}
-			continue;
+			else
+				bSkipped = true;
+			return;
 		}
 
 		Transaction& tx = *x.m_pValue;
@@ -6136,11 +6868,16 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 				ssc.m_Counter.m_Value = nSizeNext;
 				offset += ECC::Scalar::Native(tx.m_Offset);
 				++nTxNum;
+
+				vSel.push_back(&x);
 			}
 			else
 			{
 				if (bic.m_LimitExceeded)
+				{
 					bic.m_LimitExceeded = false; // don't delete it, leave it for the next block
+					bSkipped = true;
+				}
 				else
 					bDelete = true;
 			}
@@ -6151,6 +6888,43 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 			x.m_Hist.m_Height = m_Cursor.m_ID.m_Height;
 			bc.m_TxPool.SetState(x, TxPool::Fluff::State::Outdated); // isn't available in this context
 		}
+	};
+
+	if (bt.m_Incremental)
+	{
+		// no txs were removed since then, all the selected are still in the pool. Merge them with the new ones, in the same order as the profit set
+		std::vector<TxPool::Fluff::Element*> v = bt.m_vSel;
+
+		TxPool::Fluff::SeqList& lst = bc.m_TxPool.m_lstProfitSeq; // alias
+		for (TxPool::Fluff::SeqList::reverse_iterator it = lst.rbegin(); (lst.rend() != it) && (it->m_Value > bt.m_ProfitIns); ++it)
+			v.push_back(&it->get_ParentObj());
+
+		auto itNew = v.begin() + bt.m_vSel.size();
+		std::reverse(itNew, v.end()); // in order of insertion, the profit set is also ordered so for the equal elements
+
+		auto fnLess = [](const TxPool::Fluff::Element* p1, const TxPool::Fluff::Element* p2) { return p1->m_Profit < p2->m_Profit; };
+		std::stable_sort(itNew, v.end(), fnLess);
+		std::inplace_merge(v.begin(), itNew, v.end(), fnLess);
+
+		for (size_t i = 0; i < v.size(); i++)
+			fnTryTx(*v[i]);
+	}
+	else
+	{
+		for (TxPool::Fluff::ProfitSet::iterator it = bc.m_TxPool.m_setProfit.begin(); bc.m_TxPool.m_setProfit.end() != it; )
+			fnTryTx((it++)->get_ParentObj());
+	}
+
+	if (bc.m_pParent)
+		bt.Reset();
+	else
+	{
+		bt.m_vSel.swap(vSel);
+		bt.m_Skipped = bSkipped;
+		bt.m_Tip = m_Cursor.m_ID;
+		bt.m_pTxPool = &bc.m_TxPool;
+		bt.m_ProfitIns = bc.m_TxPool.m_ProfitIns;
+		bt.m_ProfitDel = bc.m_TxPool.m_ProfitDel;
 	}
 
 	LOG_INFO() << "GenerateNewBlock: size of block = " << ssc.m_Counter.m_Value << "; amount of tx = " << nTxNum;
@@ -6223,7 +6997,41 @@ NodeProcessor::BlockContext::BlockContext(TxPool::Fluff& txp, Key::Index nSubKey
 	m_Block.ZeroInit();
 }
 
+void NodeProcessor::BlockTemplate::Reset()
+{
+	m_pTxPool = nullptr;
+	m_vSel.clear();
+}
+
+bool NodeProcessor::BlockTemplate::IsValidFor(const BlockContext& bc, const Block::SystemState::ID& tip) const
+{
+	return
+		!bc.m_pParent &&
+		(&bc.m_TxPool == m_pTxPool) &&
+		(bc.m_TxPool.m_ProfitDel == m_ProfitDel) &&
+		(!m_Skipped || (bc.m_TxPool.m_ProfitIns == m_ProfitIns)) &&
+		(tip == m_Tip);
+}
+
 bool NodeProcessor::GenerateNewBlock(BlockContext& bc)
+{
+	uint64_t t0_us = GetTime_us();
+	m_Template.m_Incremental = false;
+
+	bool bRes = GenerateNewBlockInternal(bc);
+
+	if (bRes && (BlockContext::Mode::Finalize != bc.m_Mode))
+	{
+		uint64_t dt_us = GetTime_us() - t0_us;
+		(m_Template.m_Incremental ? m_Template.m_Delta : m_Template.m_Full).Add(dt_us);
+
+		LOG_DEBUG() << "Block template refreshed (" << (m_Template.m_Incremental ? "incremental" : "full") << ") in " << dt_us << "us. Full: " << m_Template.m_Full << "; Incremental: " << m_Template.m_Delta;
+	}
+
+	return bRes;
+}
+
+bool NodeProcessor::GenerateNewBlockInternal(BlockContext& bc)
 {
 	BlockInterpretCtx bic(m_Cursor.m_Sid.m_Height + 1, true);
 	bic.m_Temporary = true;
@@ -6338,7 +7146,7 @@ uint32_t NodeProcessor::MyExecutor::Flush(uint32_t)
 
 void NodeProcessor::MyExecutor::ExecAll(TaskSync& t)
 {
-	ECC::InnerProduct::BatchContext::Scope scope(m_Ctx.m_BatchCtx);
+	ECC::InnerProduct::BatchContext::Scope scope(*m_Ctx.m_pBatchCtx);
 	t.Exec(m_Ctx);
 }
 
@@ -6572,33 +7380,183 @@ bool NodeProcessor::ITxoWalker_Unspent::OnTxo(const NodeDB::WalkerTxo& wlk, Heig
 
 void NodeProcessor::InitializeUtxos()
 {
+	// The Txos are read by this thread (DB access isn't thread-safe), in chunks. Each chunk is sharded across the verification threads,
+	// each decodes its shard into UtxoTree keys and sorts them. Then the shards are merged into the tree, in the key order (better locality).
+	// For equal keys the original order is preserved, so that the IDs are pushed in the same order.
+	struct Element
+	{
+		UtxoTree::Key m_Key;
+		TxoID m_ID;
+
+		bool operator < (const Element& x) const { return m_Key.V < x.m_Key.V; }
+	};
+
+	struct Txo
+	{
+		uint8_t m_pNaked[s_TxoNakedMax];
+		uint32_t m_nSize;
+		Height m_hCreate;
+		TxoID m_ID;
+	};
+
+	static const uint32_t s_Chunk = 0x10000;
+
+	struct MyTask
+		:public Executor::TaskSync
+	{
+		const std::vector<Txo>* m_pTxos;
+		std::vector<Element> m_vElems;
+		std::vector<uint32_t> m_vShards; // start index of each shard, per thread
+		std::vector<uint32_t> m_vShardsEnd;
+		bool m_Corrupted = false;
+
+		virtual void Exec(Executor::Context& ctx) override
+		{
+			uint32_t i0, nCount;
+			ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pTxos->size()));
+
+			m_vShards[ctx.m_iThread] = i0;
+			m_vShardsEnd[ctx.m_iThread] = i0 + nCount;
+
+			try
+			{
+				for (uint32_t i = 0; i < nCount; i++)
+				{
+					const Txo& txo = (*m_pTxos)[i0 + i];
+
+					Deserializer der;
+					der.reset(txo.m_pNaked, txo.m_nSize);
+
+					Output outp;
+					der & outp;
+
+					UtxoTree::Key::Data d;
+					d.m_Commitment = outp.m_Commitment;
+					d.m_Maturity = outp.get_MinMaturity(txo.m_hCreate);
+
+					Element& el = m_vElems[i0 + i];
+					el.m_Key = d;
+					el.m_ID = txo.m_ID;
+				}
+			}
+			catch (const std::exception&)
+			{
+				m_Corrupted = true; // no sync needed
+				return;
+			}
+
+			std::stable_sort(m_vElems.begin() + i0, m_vElems.begin() + i0 + nCount);
+		}
+	};
+
 	struct Walker
-		:public ITxoWalker_UnspentNaked
+		:public ITxoWalker
 	{
 		TxoID m_TxosTotal = 0;
 		NodeProcessor& m_This;
+		std::vector<Txo> m_vTxos;
+		MyTask m_Task;
+
 		Walker(NodeProcessor& x) :m_This(x) {}
 
 		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate) override
 		{
 			m_This.InitializeUtxosProgress(wlk.m_ID, m_TxosTotal);
-			return ITxoWalker_UnspentNaked::OnTxo(wlk, hCreate);
+
+			if (wlk.m_SpendHeight != MaxHeight)
+				return true;
+
+			Txo& txo = m_vTxos.emplace_back();
+
+			Blob blob = wlk.m_Value;
+			TxoToNaked(txo.m_pNaked, blob); // always copies into the buffer
+			assert(blob.n <= sizeof(txo.m_pNaked));
+
+			txo.m_nSize = blob.n;
+			txo.m_hCreate = hCreate;
+			txo.m_ID = wlk.m_ID;
+
+			if (m_vTxos.size() >= s_Chunk)
+				Flush();
+
+			return true;
 		}
 
-		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate, Output& outp) override
+		void Flush()
 		{
-			m_This.m_Extra.m_Txos = wlk.m_ID;
-			BlockInterpretCtx bic(hCreate, true);
-			if (!m_This.HandleBlockElement(outp, bic))
+			if (m_vTxos.empty())
+				return;
+
+			Executor& ex = m_This.get_Executor();
+			uint32_t nThreads = ex.get_Threads();
+
+			m_Task.m_pTxos = &m_vTxos;
+			m_Task.m_vElems.resize(m_vTxos.size());
+			m_Task.m_vShards.assign(nThreads, 0);
+			m_Task.m_vShardsEnd.assign(nThreads, 0);
+
+			ex.ExecAll(m_Task);
+
+			if (m_Task.m_Corrupted)
 				OnCorrupted();
 
-			return true;
+			// merge
+			UtxoTree& t = m_This.m_Mapped.m_Utxo;
+			std::vector<uint32_t>& vPos = m_Task.m_vShards;
+
+			while (true)
+			{
+				const Element* pMin = nullptr;
+				uint32_t iShard = 0;
+
+				for (uint32_t i = 0; i < nThreads; i++)
+				{
+					if (vPos[i] == m_Task.m_vShardsEnd[i])
+						continue;
+
+					const Element& el = m_Task.m_vElems[vPos[i]];
+					if (!pMin || (el < *pMin))
+					{
+						pMin = &el;
+						iShard = i;
+					}
+				}
+
+				if (!pMin)
+					break;
+
+				vPos[iShard]++;
+
+				m_This.m_Mapped.m_Utxo.EnsureReserve();
+
+				UtxoTree::Cursor cu;
+				bool bCreate = true;
+				UtxoTree::MyLeaf* p = t.Find(cu, pMin->m_Key, bCreate);
+
+				cu.InvalidateElement();
+				t.OnDirty();
+
+				if (bCreate)
+					p->m_ID = pMin->m_ID;
+				else
+				{
+					Input::Count nCountInc = p->get_Count() + 1;
+					if (!nCountInc)
+						OnCorrupted();
+
+					t.PushID(pMin->m_ID, *p);
+				}
+			}
+
+			m_vTxos.clear();
 		}
 	};
 
 	Walker wlk(*this);
 	wlk.m_TxosTotal = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
+	wlk.m_vTxos.reserve(s_Chunk);
 	EnumTxos(wlk);
+	wlk.Flush();
 }
 
 bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive)
@@ -6849,6 +7807,7 @@ void NodeProcessor::RebuildNonStd()
 	// Delete all asset info, contracts, shielded, and replay everything
 	m_Mapped.m_Contract.Clear();
 	m_DB.ContractDataDelAll();
+	m_ModuleCache.Clear();
 	m_DB.ContractLogDel(HeightPos(0), HeightPos(MaxHeight));
 	m_DB.ShieldedOutpDelFrom(0);
 	m_DB.ParamDelSafe(NodeDB::ParamID::ShieldedInputs);
@@ -6859,6 +7818,7 @@ void NodeProcessor::RebuildNonStd()
 	m_Mmr.m_Assets.ResizeTo(0);
 	m_Mmr.m_Shielded.ResizeTo(0);
 	m_Extra.m_ShieldedOutputs = 0;
+	m_ShieldedImage.Truncate(0); // refilled during the replay
 
 	static_assert(NodeDB::StreamType::StatesMmr == 0);
 	m_DB.StreamsDelAll(static_cast<NodeDB::StreamType::Enum>(1), NodeDB::StreamType::count);
@@ -6969,84 +7929,289 @@ int NodeProcessor::get_AssetAt(Asset::Full& ai, Height h)
 	return 1;
 }
 
-void NodeProcessor::ValidatedCache::ShrinkTo(uint32_t n)
+NodeProcessor::ValidatedCache::ValidatedCache(uint32_t nBuckets)
+	:m_Buckets(nBuckets)
+	,m_pBuckets(new Bucket[nBuckets])
+{
+	assert(nBuckets);
+	for (uint32_t iBucket = 0; iBucket < m_Buckets; iBucket++)
+	{
+		Bucket& b = m_pBuckets[iBucket];
+		b.m_iHand = 0;
+
+		for (uint32_t i = 0; i < s_Ways; i++)
+		{
+			Slot& x = b.m_pSlots[i];
+			x.m_Seq.store(0, std::memory_order_relaxed);
+			x.m_Used.store(0, std::memory_order_relaxed);
+			x.m_Ref.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	m_Hits = 0;
+	m_Misses = 0;
+	m_Evictions = 0;
+}
+
+uint32_t NodeProcessor::ValidatedCache::get_Bucket(const Key& key) const
 {
-	while (m_Mru.size() > n)
-		Delete(m_Mru.back().get_ParentObj());
+	uint64_t val;
+	memcpy(&val, key.m_pData, sizeof(val)); // the key is a hash, uniformly distributed
+	return static_cast<uint32_t>(val % m_Buckets);
 }
 
-void NodeProcessor::ValidatedCache::OnShLo(const Entry::ShLo::Type& nShLo)
+void NodeProcessor::ValidatedCache::KeyToWords(uint64_t* pKey, const Key& key)
 {
-	while (true)
+	memcpy(pKey, key.m_pData, key.nBytes);
+}
+
+bool NodeProcessor::ValidatedCache::IsMatch(const Slot& x, const uint64_t* pKey)
+{
+	// seqlock read
+	uint32_t nSeq = x.m_Seq.load(std::memory_order_acquire);
+	if (1 & nSeq)
+		return false; // being modified
+
+	bool bMatch = !!x.m_Used.load(std::memory_order_relaxed);
+	for (uint32_t i = 0; bMatch && (i < _countof(x.m_pKey)); i++)
+		bMatch = (x.m_pKey[i].load(std::memory_order_relaxed) == pKey[i]);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return bMatch && (x.m_Seq.load(std::memory_order_relaxed) == nSeq);
+}
+
+void NodeProcessor::ValidatedCache::Write(Slot& x, const uint64_t* pKey, ShLo nShLo)
+{
+	// seqlock write, the shard mutex must be locked
+	uint32_t nSeq = x.m_Seq.load(std::memory_order_relaxed);
+	x.m_Seq.store(nSeq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (uint32_t i = 0; i < _countof(x.m_pKey); i++)
+		x.m_pKey[i].store(pKey[i], std::memory_order_relaxed);
+	x.m_End.store(nShLo, std::memory_order_relaxed);
+	x.m_Ref.store(0, std::memory_order_relaxed);
+	x.m_Used.store(1, std::memory_order_relaxed);
+
+	x.m_Seq.store(nSeq + 2, std::memory_order_release);
+}
+
+void NodeProcessor::ValidatedCache::Erase(Slot& x)
+{
+	uint32_t nSeq = x.m_Seq.load(std::memory_order_relaxed);
+	x.m_Seq.store(nSeq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	x.m_Used.store(0, std::memory_order_relaxed);
+
+	x.m_Seq.store(nSeq + 2, std::memory_order_release);
+}
+
+bool NodeProcessor::ValidatedCache::Find(const Key& key)
+{
+	uint64_t pKey[_countof(Slot::m_pKey)];
+	KeyToWords(pKey, key);
+
+	Bucket& b = m_pBuckets[get_Bucket(key)];
+	for (uint32_t i = 0; i < s_Ways; i++)
 	{
-		ShLoSet::reverse_iterator it = m_ShLo.rbegin();
-		if (m_ShLo.rend() == it)
-			break;
-		Entry::ShLo& x = *it;
+		Slot& x = b.m_pSlots[i];
+		if (IsMatch(x, pKey))
+		{
+			x.m_Ref.store(1, std::memory_order_relaxed);
+			m_Hits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
 
-		if (x.m_End <= nShLo)
-			break;
+	m_Misses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void NodeProcessor::ValidatedCache::Insert(const Key& key, ShLo nShLo)
+{
+	uint64_t pKey[_countof(Slot::m_pKey)];
+	KeyToWords(pKey, key);
 
-		Delete(x.get_ParentObj());
+	uint32_t iBucket = get_Bucket(key);
+	Bucket& b = m_pBuckets[iBucket];
+
+	std::unique_lock<std::mutex> scope(m_pMutex[iBucket % s_Shards]);
+
+	Slot* pFree = nullptr;
+	for (uint32_t i = 0; i < s_Ways; i++)
+	{
+		Slot& x = b.m_pSlots[i];
+		if (x.m_Used.load(std::memory_order_relaxed))
+		{
+			if (IsMatch(x, pKey))
+				return; // already there
+		}
+		else
+		{
+			if (!pFree)
+				pFree = &x;
+		}
 	}
+
+	if (!pFree)
+	{
+		// CLOCK: skip (and clear) referenced slots
+		while (true)
+		{
+			Slot& x = b.m_pSlots[b.m_iHand];
+			if (++b.m_iHand == s_Ways)
+				b.m_iHand = 0;
+
+			if (!x.m_Ref.exchange(0, std::memory_order_relaxed))
+			{
+				pFree = &x;
+				break;
+			}
+		}
+
+		m_Evictions.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Write(*pFree, pKey, nShLo);
 }
 
-void NodeProcessor::ValidatedCache::RemoveRaw(Entry& x)
+void NodeProcessor::ValidatedCache::OnShLo(ShLo nShLo)
 {
-	m_Keys.erase(KeySet::s_iterator_to(x.m_Key));
-	m_ShLo.erase(ShLoSet::s_iterator_to(x.m_ShLo));
-	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
+	for (uint32_t iBucket = 0; iBucket < m_Buckets; iBucket++)
+	{
+		Bucket& b = m_pBuckets[iBucket];
+		std::unique_lock<std::mutex> scope(m_pMutex[iBucket % s_Shards]);
+
+		for (uint32_t i = 0; i < s_Ways; i++)
+		{
+			Slot& x = b.m_pSlots[i];
+			if (x.m_Used.load(std::memory_order_relaxed) && (x.m_End.load(std::memory_order_relaxed) > nShLo))
+				Erase(x);
+		}
+	}
+}
+
+void NodeProcessor::ValidatedCache::Clear()
+{
+	for (uint32_t iBucket = 0; iBucket < m_Buckets; iBucket++)
+	{
+		Bucket& b = m_pBuckets[iBucket];
+		std::unique_lock<std::mutex> scope(m_pMutex[iBucket % s_Shards]);
+
+		for (uint32_t i = 0; i < s_Ways; i++)
+		{
+			Slot& x = b.m_pSlots[i];
+			if (x.m_Used.load(std::memory_order_relaxed))
+				Erase(x);
+		}
+	}
 }
 
-void NodeProcessor::ValidatedCache::Delete(Entry& x)
+void NodeProcessor::ValidatedCache::get_Stats(Stats& s) const
 {
-	RemoveRaw(x);
-	delete &x;
+	s.m_Hits = m_Hits.load(std::memory_order_relaxed);
+	s.m_Misses = m_Misses.load(std::memory_order_relaxed);
+	s.m_Evictions = m_Evictions.load(std::memory_order_relaxed);
 }
 
-void NodeProcessor::ValidatedCache::MoveToFront(Entry& x)
+/////////////////////////////
+// ModuleCache
+NodeProcessor::ModuleCache::ModuleCache()
+	:m_pImpl(std::make_unique<Impl>())
 {
-	m_Mru.erase(MruList::s_iterator_to(x.m_Mru));
-	m_Mru.push_front(x.m_Mru);
 }
 
-bool NodeProcessor::ValidatedCache::Find(const Entry::Key::Type& val)
+NodeProcessor::ModuleCache::~ModuleCache()
 {
-	Entry::Key key;
-	key.m_Value = val;
+}
 
-	KeySet::iterator it = m_Keys.find(key);
-	if (m_Keys.end() == it)
-		return false;
+void NodeProcessor::ModuleCache::get_Stats(Stats& s) const
+{
+	std::unique_lock<std::mutex> scope(m_pImpl->m_Mutex);
 
-	MoveToFront(it->get_ParentObj());
-	return true;
+	s.m_Hits = m_pImpl->m_Hits;
+	s.m_Misses = m_pImpl->m_Misses;
+	s.m_Invalidations = m_pImpl->m_Invalidations;
+	s.m_Size = m_pImpl->m_Size;
+	s.m_Count = static_cast<uint32_t>(m_pImpl->m_Lru.size());
 }
 
-void NodeProcessor::ValidatedCache::Insert(const Entry::Key::Type& val, const Entry::ShLo::Type& nShLo)
+void NodeProcessor::ModuleCache::Invalidate(const Blob& cid)
 {
-	Entry* pEntry(new Entry);
-	pEntry->m_Key.m_Value = val;
-	pEntry->m_ShLo.m_End = nShLo;
+	assert(cid.n == bvm2::ContractID::nBytes);
 
-	InsertRaw(*pEntry);
+	std::unique_lock<std::mutex> scope(m_pImpl->m_Mutex);
+	if (m_pImpl->Erase(*reinterpret_cast<const bvm2::ContractID*>(cid.p)))
+		m_pImpl->m_Invalidations++;
 }
 
-void NodeProcessor::ValidatedCache::InsertRaw(Entry& x)
+void NodeProcessor::ModuleCache::Clear()
 {
-	m_Keys.insert(x.m_Key);
-	m_ShLo.insert(x.m_ShLo);
-	m_Mru.push_front(x.m_Mru);
+	std::unique_lock<std::mutex> scope(m_pImpl->m_Mutex);
+	m_pImpl->DeleteAll();
 }
 
-void NodeProcessor::ValidatedCache::MoveInto(ValidatedCache& dst)
+NodeProcessor::ModuleCache::Impl::Module::Ptr NodeProcessor::ModuleCache::Impl::Find(const bvm2::ContractID& cid)
 {
-	while (!m_Mru.empty())
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	auto it = m_Set.find(cid, Entry::Comparator());
+	if (m_Set.end() == it)
 	{
-		Entry& x = m_Mru.back().get_ParentObj();
-		RemoveRaw(x);
-		dst.InsertRaw(x);
+		m_Misses++;
+		return nullptr;
 	}
+
+	m_Hits++;
+
+	Entry& e = *it;
+	m_Lru.erase(m_Lru.iterator_to(e));
+	m_Lru.push_front(e);
+
+	return e.m_pMod;
+}
+
+void NodeProcessor::ModuleCache::Impl::Insert(const bvm2::ContractID& cid, const Module::Ptr& pMod, size_t nSizeMax)
+{
+	size_t nSize = pMod->get_Size();
+	if (nSize > nSizeMax)
+		return;
+
+	std::unique_lock<std::mutex> scope(m_Mutex);
+
+	Erase(cid); // could be inserted by another thread meanwhile
+
+	while (m_Size + nSize > nSizeMax)
+		Delete(m_Lru.back());
+
+	Entry* pE = m_Set.Create(cid);
+	pE->m_pMod = pMod;
+	m_Lru.push_front(*pE);
+	m_Size += nSize;
+}
+
+bool NodeProcessor::ModuleCache::Impl::Erase(const bvm2::ContractID& cid)
+{
+	auto it = m_Set.find(cid, Entry::Comparator());
+	if (m_Set.end() == it)
+		return false;
+
+	Delete(*it);
+	return true;
+}
+
+void NodeProcessor::ModuleCache::Impl::Delete(Entry& e)
+{
+	m_Size -= e.m_pMod->get_Size();
+	m_Lru.erase(m_Lru.iterator_to(e));
+	m_Set.Delete(e);
+}
+
+void NodeProcessor::ModuleCache::Impl::DeleteAll()
+{
+	while (!m_Lru.empty())
+		Delete(m_Lru.front());
 }
 
 /////////////////////////////
@@ -7137,6 +8302,109 @@ void NodeProcessor::Mapped::Utxo::EnsureReserve()
 	}
 }
 
+/////////////////////////////
+// ShieldedImage
+MappedFileRaw::Offset NodeProcessor::ShieldedImage::get_Offset(TxoID n)
+{
+	return sizeof(Hdr) + sizeof(ECC::Point::Compact) * n;
+}
+
+bool NodeProcessor::ShieldedImage::Open(const char* sz, const Stamp& s, TxoID nCount)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x3E, 0x91, 0x0C, 0x5A,
+		0xD2, 0x47, 0x8B, 0x16,
+		0x6F, 0xA8, 0x21, 0xE4,
+		0x95, 0x3B, 0xC7, 0x70
+	};
+	static_assert(sizeof(s_pSig) == sizeof(Hdr::m_pSig), "");
+
+	m_File.Open(sz);
+
+	if (m_File.m_nMapping >= sizeof(Hdr))
+	{
+		const Hdr& h = get_Hdr();
+		if (!memcmp(h.m_pSig, s_pSig, sizeof(s_pSig)) && !h.m_Dirty && (h.m_Stamp == s) && (h.m_Count == nCount) && (m_File.m_nMapping >= get_Offset(nCount)))
+			return true;
+	}
+
+	// reset
+	m_File.CloseMapping();
+	m_File.Resize(0);
+	m_File.Resize(sizeof(Hdr)); // will zero-init
+	m_File.OpenMapping();
+
+	Hdr& h = get_Hdr();
+	memcpy(h.m_pSig, s_pSig, sizeof(s_pSig));
+	h.m_Dirty = 1;
+
+	return false;
+}
+
+void NodeProcessor::ShieldedImage::Reserve(TxoID nCount)
+{
+	MappedFileRaw::Offset n = get_Offset(nCount);
+	if (m_File.m_nMapping >= n)
+		return;
+
+	// grow geometrically, the list is almost always appended
+	std::setmax(n, get_Offset(nCount + (nCount >> 1) + 0x400));
+
+	m_File.CloseMapping();
+	m_File.Resize(n);
+	m_File.OpenMapping();
+}
+
+const ECC::Point::Compact* NodeProcessor::ShieldedImage::get_At(TxoID n) const
+{
+	assert(n < get_Count());
+	return &m_File.get_At<ECC::Point::Compact>(get_Offset(n));
+}
+
+void NodeProcessor::ShieldedImage::Append(const ECC::Point::Storage* pS, uint32_t nCount)
+{
+	TxoID n0 = get_Count();
+	Reserve(n0 + nCount);
+
+	ECC::Point::Compact* pC = &m_File.get_At<ECC::Point::Compact>(get_Offset(n0));
+
+	for (uint32_t i = 0; i < nCount; i++)
+	{
+		if (memis0(pS + i, sizeof(*pS)))
+			ZeroObject(pC[i]);
+		else
+		{
+			// Storage is affine already, import doesn't need normalization
+			ECC::Point::Native pt;
+			pt.Import(pS[i], false);
+			ECC::Point::Native::BatchNormalizer::get_As(pC[i], pt);
+		}
+	}
+
+	Hdr& h = get_Hdr();
+	h.m_Count = n0 + nCount;
+	h.m_Dirty = 1;
+}
+
+void NodeProcessor::ShieldedImage::Truncate(TxoID nCount)
+{
+	Hdr& h = get_Hdr();
+	assert(nCount <= h.m_Count);
+
+	h.m_Count = nCount; // file isn't shrunk, the tail is reused on subsequent appends
+	h.m_Dirty = 1;
+}
+
+void NodeProcessor::ShieldedImage::FlushStrict(const Stamp& s)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Dirty = 0;
+	h.m_Stamp = s;
+}
+
 void NodeProcessor::Mapped::OnDirty()
 {
 	get_Hdr().m_Dirty = 1;
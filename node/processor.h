@@ -23,9 +23,14 @@
 #include "../utility/containers.h"
 #include "db.h"
 #include "txpool.h"
+#include <atomic>
 
 namespace beam {
 
+namespace bvm2 {
+	class Profiler;
+}
+
 class NodeProcessor
 {
 	struct DB
@@ -129,6 +134,44 @@ class NodeProcessor
 
 	Mapped m_Mapped;
 
+	// flat copy of the shielded commitments list, kept as normalized affine points (secp256k1_ge_storage).
+	// Mirrors the DB list, used by the sigma verification instead of reading the DB.
+	class ShieldedImage
+	{
+		MappedFileRaw m_File;
+
+		static MappedFileRaw::Offset get_Offset(TxoID);
+		void Reserve(TxoID nCount);
+
+	public:
+
+		typedef Mapped::Stamp Stamp;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			uint8_t m_pSig[16];
+			uint64_t m_Dirty; // boolean, just aligned
+			Stamp m_Stamp;
+			uint64_t m_Count;
+		};
+#pragma pack(pop)
+
+		bool Open(const char* sz, const Stamp&, TxoID nCount);
+		bool IsOpen() const { return m_File.get_Base() != nullptr; }
+		void Close() { m_File.Close(); }
+		void FlushStrict(const Stamp&);
+
+		Hdr& get_Hdr() const { return m_File.get_At<Hdr>(0); }
+		TxoID get_Count() const { return get_Hdr().m_Count; }
+
+		const ECC::Point::Compact* get_At(TxoID) const;
+
+		void Append(const ECC::Point::Storage*, uint32_t nCount);
+		void Truncate(TxoID nCount);
+
+	} m_ShieldedImage;
+
 	size_t m_nSizeUtxoComission;
 
 	struct MultiblockContext;
@@ -162,6 +205,7 @@ class NodeProcessor
 	void HandleElementVecBwd(const T& vec, BlockInterpretCtx&, size_t n);
 
 	bool HandleBlock(const NodeDB::StateID&, const Block::SystemState::Full&, MultiblockContext&);
+	void OnBlocksInterpreted(Height dh, uint64_t t0_us);
 	bool HandleValidatedTx(const TxVectors::Full&, BlockInterpretCtx&);
 	bool HandleValidatedBlock(const Block::Body&, BlockInterpretCtx&);
 	bool HandleBlockElement(const Input&, BlockInterpretCtx&);
@@ -206,7 +250,9 @@ class NodeProcessor
 
 	void InitCursor(bool bMovingUp);
 	bool InitMapping(const char*, bool bForceReset);
-	void InitializeMapped(const char*);
+	bool InitializeMapped(const char*); // returns true if the image was rebuilt
+	void InitializeShieldedImage(const char*);
+	static void get_DerivedPath(std::string&, const char*, const char* szSufix);
 
 	typedef std::pair<int64_t, std::pair<int64_t, Difficulty::Raw> > THW; // Time-Height-Work. Time and Height are signed
 	Difficulty get_NextDifficulty();
@@ -270,6 +316,14 @@ public:
 		bool m_Vacuum = false;
 		bool m_ResetSelfID = false;
 		bool m_EraseSelfID = false;
+		bool m_Wal = false; // needed for concurrent DB readers
+		NodeDB::StreamMmr::CacheParams m_MmrCache;
+		uint32_t m_ParallelContracts = 0; // min contract invocations in a block to pre-execute them concurrently, 0 = never
+		uint32_t m_HashSplitDepth = 0; // dirty UTXO/contract subtrees at this depth are rehashed concurrently, 0 = never
+		uint32_t m_HashSplitMinDirty = 4096; // ... if there are at least this many dirty joints
+		bool m_MappedRelayout = false; // reorder the UTXO/contract tree joints in the mapped image on every start, for lookup locality. A freshly rebuilt image is always reordered
+		bool m_BvmProfile = false;
+		uint32_t m_StatsPeriod_ms = 1000 * 60 * 5; // how often to log the interpretation and caches stats. 0 - never
 
 		struct RichInfo {
 			static const uint8_t Off = 1;
@@ -285,6 +339,7 @@ public:
 
     static bool ExtractTreasury(const Blob&, Treasury::Data&);
 	static void get_MappingPath(std::string&, const char*);
+	static void get_ShieldedImagePath(std::string&, const char*);
 
 	NodeProcessor();
 	virtual ~NodeProcessor();
@@ -546,7 +601,9 @@ public:
 		struct MyContext
 			:public Context
 		{
-			ECC::InnerProduct::BatchContextEx<4> m_BatchCtx; // seems to be ok, for larger batches difference is marginal
+			// large enough for the casual points to be multiplied by buckets. ~1MB, not for the thread stack
+			typedef ECC::InnerProduct::BatchContextEx<32> BatchCtx;
+			std::unique_ptr<BatchCtx> m_pBatchCtx = std::make_unique<BatchCtx>();
 		};
 
 		MyContext m_Ctx;
@@ -620,6 +677,27 @@ public:
 
 	bool GenerateNewBlock(BlockContext&);
 
+	struct BlockTemplate
+	{
+		// Txs selected for the last generated block. While the tip is the same and no txs left the pool, the next block is generated
+		// incrementally: the previous selection is merged with the txs that entered the pool since then (in profit order), the rest of the pool isn't visited.
+		// If some txs were skipped (i.e. the block is full) - this is done only if there are no new txs, otherwise the result may differ from the full walk.
+		Block::SystemState::ID m_Tip;
+		const TxPool::Fluff* m_pTxPool = nullptr;
+		uint64_t m_ProfitIns = 0;
+		uint64_t m_ProfitDel = 0;
+		std::vector<TxPool::Fluff::Element*> m_vSel;
+		bool m_Skipped = false; // not all the profit set was selected
+		bool m_Incremental = false; // mode of the last refresh
+
+		LatencyStats m_Full;
+		LatencyStats m_Delta;
+
+		void Reset();
+		bool IsValidFor(const BlockContext&, const Block::SystemState::ID& tip) const;
+
+	} m_Template;
+
 	bool GetBlock(const NodeDB::StateID&, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive);
 
 	struct ITxoWalker
@@ -799,70 +877,139 @@ public:
 		return m_Mmr.m_Shielded.m_Count - m_Extra.m_ShieldedOutputs;
 	}
 
+	struct InterpretStats
+	{
+		// blocks interpreted (moved forward to), and the time spent, including the verification
+		uint64_t m_Blocks = 0;
+		uint64_t m_Time_us = 0;
+
+		uint32_t m_StatsPeriod_ms = 0;
+		uint32_t m_LastLog_ms = 0;
+
+		double get_BlocksPerSec() const;
+
+	} m_InterpretStats;
+
+	void MaybeLogStats();
+
 	struct ValidatedCache
 	{
-		struct Entry
+		// Fixed-capacity open-addressing hash table, safe for concurrent use.
+		// The key selects a bucket of s_Ways slots (bounded probe sequence), the eviction within the bucket is CLOCK (2nd chance).
+		// Find() is lock-free (per-slot seqlock), modifications lock only the appropriate shard.
+		typedef ECC::Hash::Value Key;
+		typedef TxoID ShLo;
+
+		static const uint32_t s_Ways = 8;
+		static const uint32_t s_Shards = 64;
+
+		ValidatedCache(uint32_t nBuckets = 2048);
+
+		bool Find(const Key&); // sets the reference bit if found
+		void Insert(const Key&, ShLo nShLo);
+		void OnShLo(ShLo nShLo); // delete all entries beyond this
+		void Clear();
+
+		struct Stats
 		{
-			struct Key
-				:public boost::intrusive::set_base_hook<>
-			{
-				typedef ECC::Hash::Value Type;
-				Type m_Value;
-				bool operator < (const Key& x) const { return m_Value < x.m_Value; }
-				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
-			} m_Key;
-
-			struct Mru
-				:public boost::intrusive::list_base_hook<>
-			{
-				IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
-			} m_Mru;
-
-			struct ShLo
-				:public boost::intrusive::set_base_hook<>
-			{
-				typedef TxoID Type;
-				Type m_End;
-				bool operator < (const ShLo& x) const { return m_End < x.m_End; }
-				IMPLEMENT_GET_PARENT_OBJ(Entry, m_ShLo)
-			} m_ShLo;
+			uint64_t m_Hits;
+			uint64_t m_Misses;
+			uint64_t m_Evictions;
 		};
 
-		typedef boost::intrusive::multiset<Entry::Key> KeySet;
-		typedef boost::intrusive::multiset<Entry::ShLo> ShLoSet;
-		typedef boost::intrusive::list<Entry::Mru> MruList;
+		void get_Stats(Stats&) const;
 
-		KeySet m_Keys;
-		ShLoSet m_ShLo;
-		MruList m_Mru;
-
-		~ValidatedCache() {
-			ShrinkTo(0);
-		}
+	private:
 
-		void Delete(Entry&);
-		void MoveToFront(Entry&);
+		struct Slot
+		{
+			std::atomic<uint32_t> m_Seq; // odd while being modified
+			std::atomic<uint8_t> m_Used;
+			std::atomic<uint8_t> m_Ref;
+			std::atomic<uint64_t> m_pKey[Key::nBytes / sizeof(uint64_t)];
+			std::atomic<ShLo> m_End;
+		};
 
-		void ShrinkTo(uint32_t);
-		void OnShLo(const Entry::ShLo::Type& nShLo);
+		struct Bucket
+		{
+			Slot m_pSlots[s_Ways];
+			uint32_t m_iHand; // protected by the shard mutex
+		};
 
-		bool Find(const Entry::Key::Type&); // modifies MRU if found
-		void Insert(const Entry::Key::Type&, const Entry::ShLo::Type& nShLo);
+		uint32_t m_Buckets;
+		std::unique_ptr<Bucket[]> m_pBuckets;
+		std::mutex m_pMutex[s_Shards];
 
-		void MoveInto(ValidatedCache& dst);
+		std::atomic<uint64_t> m_Hits;
+		std::atomic<uint64_t> m_Misses;
+		std::atomic<uint64_t> m_Evictions;
 
-	protected:
-		void InsertRaw(Entry&);
-		void RemoveRaw(Entry&);
+		uint32_t get_Bucket(const Key&) const;
+		static void KeyToWords(uint64_t*, const Key&);
+		static bool IsMatch(const Slot&, const uint64_t* pKey);
+		static void Write(Slot&, const uint64_t* pKey, ShLo);
+		static void Erase(Slot&);
 
 	} m_ValCache;
 
+	struct ModuleCache
+	{
+		// Decoded contract modules (code + parsed layout), keyed by contract ID, LRU eviction.
+		// Reflects the current (DB) state. Contexts that modify the contract code w/o writing to DB bypass it.
+		ModuleCache();
+		~ModuleCache();
+
+		size_t m_SizeMax = 0x4000000; // 64MB total code size
+
+		struct Stats
+		{
+			uint64_t m_Hits;
+			uint64_t m_Misses;
+			uint64_t m_Invalidations;
+			size_t m_Size;
+			uint32_t m_Count;
+		};
+
+		void get_Stats(Stats&) const;
+		void Invalidate(const Blob& cid);
+		void Clear();
+
+		struct Impl;
+		std::unique_ptr<Impl> m_pImpl;
+
+	} m_ModuleCache;
+
+	struct ParallelContracts
+	{
+		// Optimistic concurrent execution of the block contract invocations, on the executor threads, against the state at the block start.
+		// Each invocation records the vars it accessed, and its effects (var writes, logs).
+		// The effects are then applied in block order. Invocations that accessed vars modified meanwhile are re-executed serially.
+		uint32_t m_MinCount = 2;
+
+		struct Stats
+		{
+			uint64_t m_Blocks = 0;
+			uint64_t m_Executed = 0;
+			uint64_t m_Repeated = 0; // re-executed with the corrected log position
+			uint64_t m_Committed = 0; // the rest were re-executed serially
+		} m_Stats;
+
+	} m_ParallelContracts;
+
+	struct HashSplit {
+		uint32_t m_Depth = 0;
+		uint32_t m_MinDirty = 0;
+	} m_HashSplit;
+
+	std::unique_ptr<bvm2::Profiler> m_pBvmProfiler; // contract execution stats of the applied blocks
+
 	struct IWorker {
 		virtual void Do() = 0;
 	};
 	bool ExecInDependentContext(IWorker&, const Merkle::Hash*, const TxPool::Dependent&);
 
 private:
+	bool GenerateNewBlockInternal(BlockContext&);
 	size_t GenerateNewBlockInternal(BlockContext&, BlockInterpretCtx&);
 	void GenerateNewHdr(BlockContext&, BlockInterpretCtx&);
 	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bAlreadyChecked);
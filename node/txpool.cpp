@@ -119,6 +119,8 @@ void TxPool::Fluff::SetState(Element& x, Features f0, Features f)
 			m_SendQueue.push_back(*x.m_pSend);
 
 			m_setProfit.insert(x.m_Profit);
+			x.m_Seq.m_Value = ++m_ProfitIns;
+			m_lstProfitSeq.push_back(x.m_Seq);
 		}
 		else
 		{
@@ -129,6 +131,8 @@ void TxPool::Fluff::SetState(Element& x, Features f0, Features f)
 			x.m_pSend = nullptr;
 
 			m_setProfit.erase(ProfitSet::s_iterator_to(x.m_Profit));
+			m_lstProfitSeq.erase(SeqList::s_iterator_to(x.m_Seq));
+			m_ProfitDel++;
 		}
 	}
 
@@ -442,4 +446,191 @@ void TxPool::Dependent::Clear()
 	}
 }
 
+/////////////////////////////
+// Sketch
+uint64_t TxPool::Sketch::get_ShortID(const Transaction::KeyType& key, uint64_t nSalt)
+{
+	ECC::Hash::Value hv;
+	ECC::Hash::Processor()
+		<< "tx.sid"
+		<< nSalt
+		<< key
+		>> hv;
+
+	uint64_t id;
+	memcpy(&id, hv.m_pData, sizeof(id));
+	return id;
+}
+
+uint32_t TxPool::Sketch::get_Cells(uint32_t nDiff)
+{
+	// ~1.5 cells per element is enough for large differences, small ones need extra
+	uint32_t n = nDiff + (nDiff >> 1) + s_Hashes * 4;
+	return n - (n % s_Hashes);
+}
+
+uint64_t TxPool::Sketch::get_Hash(uint64_t id, uint32_t iHash)
+{
+	// splitmix64 finalizer
+	uint64_t x = id + (iHash + 1) * 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+uint32_t TxPool::Sketch::get_HashCheck(uint64_t id)
+{
+	return static_cast<uint32_t>(get_Hash(id, s_Hashes) >> 32);
+}
+
+bool TxPool::Sketch::IsPure(const Cell& c)
+{
+	return
+		((1 == c.m_Count) || (-1 == c.m_Count)) &&
+		(get_HashCheck(c.m_IDSum) == c.m_HashSum);
+}
+
+void TxPool::Sketch::Reset(uint32_t nCells)
+{
+	assert(!(nCells % s_Hashes));
+	m_vCells.resize(nCells);
+	if (nCells)
+		memset0(&m_vCells.front(), sizeof(Cell) * nCells);
+}
+
+void TxPool::Sketch::Toggle(uint64_t id, int32_t nDelta)
+{
+	uint32_t nSub = static_cast<uint32_t>(m_vCells.size()) / s_Hashes;
+	uint32_t nCheck = get_HashCheck(id);
+
+	for (uint32_t i = 0; i < s_Hashes; i++)
+	{
+		Cell& c = m_vCells[i * nSub + get_Hash(id, i) % nSub];
+		c.m_Count += nDelta;
+		c.m_IDSum ^= id;
+		c.m_HashSum ^= nCheck;
+	}
+}
+
+void TxPool::Sketch::Add(uint64_t id)
+{
+	Toggle(id, 1);
+}
+
+void TxPool::Sketch::Subtract(const Sketch& x)
+{
+	assert(m_vCells.size() == x.m_vCells.size());
+
+	for (size_t i = 0; i < m_vCells.size(); i++)
+	{
+		Cell& c = m_vCells[i];
+		const Cell& c2 = x.m_vCells[i];
+
+		c.m_Count -= c2.m_Count;
+		c.m_IDSum ^= c2.m_IDSum;
+		c.m_HashSum ^= c2.m_HashSum;
+	}
+}
+
+bool TxPool::Sketch::Decode(std::vector<uint64_t>& vMine, std::vector<uint64_t>& vOther)
+{
+	// peel the pure cells, until nothing left
+	std::vector<uint32_t> vQueue;
+	vQueue.reserve(m_vCells.size());
+	for (uint32_t i = 0; i < m_vCells.size(); i++)
+		if (IsPure(m_vCells[i]))
+			vQueue.push_back(i);
+
+	uint32_t nSub = static_cast<uint32_t>(m_vCells.size()) / s_Hashes;
+
+	while (!vQueue.empty())
+	{
+		const Cell& c = m_vCells[vQueue.back()];
+		vQueue.pop_back();
+
+		if (!IsPure(c))
+			continue; // already peeled
+
+		if (vMine.size() + vOther.size() >= m_vCells.size())
+			return false; // can't be a valid sketch
+
+		uint64_t id = c.m_IDSum;
+		int32_t nCount = c.m_Count;
+		((nCount > 0) ? vMine : vOther).push_back(id);
+
+		Toggle(id, -nCount);
+
+		for (uint32_t i = 0; i < s_Hashes; i++)
+		{
+			uint32_t iCell = i * nSub + get_Hash(id, i) % nSub;
+			if (IsPure(m_vCells[iCell]))
+				vQueue.push_back(iCell);
+		}
+	}
+
+	for (size_t i = 0; i < m_vCells.size(); i++)
+	{
+		const Cell& c = m_vCells[i];
+		if (c.m_Count || c.m_IDSum || c.m_HashSum)
+			return false;
+	}
+
+	return true;
+}
+
+namespace
+{
+	struct SketchCellPacked
+	{
+		uintBigFor<uint32_t>::Type m_Count;
+		uintBigFor<uint32_t>::Type m_HashSum;
+		uintBigFor<uint64_t>::Type m_IDSum;
+	};
+
+	static_assert(sizeof(SketchCellPacked) == TxPool::Sketch::s_CellSize);
+}
+
+void TxPool::Sketch::Export(ByteBuffer& buf) const
+{
+	buf.resize(m_vCells.size() * s_CellSize);
+	if (buf.empty())
+		return;
+
+	auto* pDst = reinterpret_cast<SketchCellPacked*>(&buf.front());
+
+	for (size_t i = 0; i < m_vCells.size(); i++)
+	{
+		const Cell& c = m_vCells[i];
+		pDst[i].m_Count = static_cast<uint32_t>(c.m_Count);
+		pDst[i].m_HashSum = c.m_HashSum;
+		pDst[i].m_IDSum = c.m_IDSum;
+	}
+}
+
+bool TxPool::Sketch::Import(const ByteBuffer& buf)
+{
+	if (buf.empty() || (buf.size() % s_CellSize))
+		return false;
+
+	size_t nCells = buf.size() / s_CellSize;
+	if ((nCells > s_MaxCells) || (nCells % s_Hashes))
+		return false;
+
+	m_vCells.resize(nCells);
+	const auto* pSrc = reinterpret_cast<const SketchCellPacked*>(&buf.front());
+
+	for (size_t i = 0; i < nCells; i++)
+	{
+		Cell& c = m_vCells[i];
+
+		uint32_t nCount;
+		pSrc[i].m_Count.Export(nCount);
+		c.m_Count = static_cast<int32_t>(nCount);
+		pSrc[i].m_HashSum.Export(c.m_HashSum);
+		pSrc[i].m_IDSum.Export(c.m_IDSum);
+	}
+
+	return true;
+}
+
 } // namespace beam
@@ -81,12 +81,20 @@ struct TxPool
 				uint32_t m_Refs = 0;
 			};
 			Send* m_pSend = nullptr;
+
+			struct Seq
+				:public boost::intrusive::list_base_hook<>
+			{
+				uint64_t m_Value = 0; // sequence num of entering the profit set
+				IMPLEMENT_GET_PARENT_OBJ(Element, m_Seq)
+			} m_Seq;
 		};
 
 		typedef boost::intrusive::multiset<Element::Tx> TxSet;
 		typedef boost::intrusive::multiset<Element::Profit> ProfitSet;
 		typedef boost::intrusive::list<Element::Hist> HistList;
 		typedef boost::intrusive::list<Element::Send> SendQueue;
+		typedef boost::intrusive::list<Element::Seq> SeqList;
 
 		TxSet m_setTxs;
 		ProfitSet m_setProfit;
@@ -94,6 +102,11 @@ struct TxPool
 		HistList m_lstOutdated;
 		HistList m_lstWaitFluff;
 
+		// profit set changes, used to refresh the block template incrementally
+		SeqList m_lstProfitSeq; // same elements as in m_setProfit, in order of insertion
+		uint64_t m_ProfitIns = 0;
+		uint64_t m_ProfitDel = 0;
+
 		Element* AddValidTx(Transaction::Ptr&&, const Stats&, const Transaction::KeyType&, State, Height hLst = 0);
 		void SetState(Element&, State);
 		void Delete(Element&);
@@ -223,6 +236,41 @@ struct TxPool
 		bool ShouldUpdateBest(const Element&);
 	};
 
+	// Invertible bloom lookup table of the 64-bit short tx IDs, for the reconciliation of the tx announcements with the peers.
+	// The sketches of the same size are subtracted, then the difference (in both directions) is decoded, unless it's too big.
+	struct Sketch
+	{
+		static const uint32_t s_Hashes = 5; // each ID is added to 1 cell of each sub-table. Less than 4 fails too often on small sets
+		static const uint32_t s_CellSize = 16; // serialized
+		static const uint32_t s_MaxCells = s_Hashes * 1024;
+
+		struct Cell
+		{
+			int32_t m_Count;
+			uint32_t m_HashSum;
+			uint64_t m_IDSum;
+		};
+
+		std::vector<Cell> m_vCells;
+
+		static uint64_t get_ShortID(const Transaction::KeyType&, uint64_t nSalt);
+		static uint32_t get_Cells(uint32_t nDiff); // enough to decode the expected difference with high probability. Not capped
+
+		void Reset(uint32_t nCells); // must be a multiple of s_Hashes
+		void Add(uint64_t id);
+		void Subtract(const Sketch&);
+		bool Decode(std::vector<uint64_t>& vMine, std::vector<uint64_t>& vOther); // after Subtract. Clears the sketch
+
+		void Export(ByteBuffer&) const;
+		bool Import(const ByteBuffer&);
+
+	private:
+		void Toggle(uint64_t id, int32_t nDelta);
+		static bool IsPure(const Cell&);
+		static uint64_t get_Hash(uint64_t id, uint32_t iHash);
+		static uint32_t get_HashCheck(uint64_t id);
+	};
+
 
 };
 
@@ -564,6 +564,31 @@ namespace beam
 		db.DeleteKernel(bBodyP, 5);
 		verify_test(db.FindKernel(bBodyP) == 0);
 
+		// kernel filter: no false negatives, most of the absent keys are answered w/o the DB
+		{
+			std::vector<Merkle::Hash> vKrns(2000);
+			for (size_t i = 0; i < vKrns.size(); i++)
+			{
+				ECC::GenRandom(vKrns[i]);
+				if (i & 1)
+					db.InsertKernel(vKrns[i], 10);
+			}
+
+			NodeDB::KeyFilter::Stats s0 = db.get_KrnFilterStats();
+
+			for (size_t i = 0; i < vKrns.size(); i++)
+				verify_test(db.FindKernel(vKrns[i]) == ((i & 1) ? 10 : 0));
+
+			const NodeDB::KeyFilter::Stats& s1 = db.get_KrnFilterStats();
+			uint64_t nNeg = s1.m_Negative - s0.m_Negative;
+			uint64_t nFp = s1.m_FalsePositive - s0.m_FalsePositive;
+			verify_test(nNeg + nFp == vKrns.size() / 2);
+			verify_test(nFp * 20 < vKrns.size() / 2);
+
+			for (size_t i = 1; i < vKrns.size(); i += 2)
+				db.DeleteKernel(vKrns[i], 10);
+		}
+
 		// Shielded
 		TxoID nShielded = 16 * 1024 * 3 + 5;
 		db.ShieldedResize(nShielded, 0);
@@ -673,6 +698,59 @@ namespace beam
 		// in a 'friendly' scenario, where we only add and calculate root - cache must be 100% effective
 		verify_test(!myMmr.m_Miss);
 
+		// random-access and pinned cache, must be consistent with the DB across rollbacks
+		{
+			NodeDB::StreamMmr::CacheParams cp;
+			cp.m_Entries = 0x20;
+			cp.m_hPinned = 3;
+
+			NodeDB::StreamMmr mmr(db, NodeDB::StreamType::AssetsMmr, true);
+			mmr.set_Cache(cp);
+
+			auto fnVerify = [&mmr, &db]()
+			{
+				NodeDB::StreamMmr::CacheParams cp0;
+				cp0.m_Entries = 0;
+				cp0.m_hPinned = Merkle::Position::HMax;
+
+				NodeDB::StreamMmr mmr0(db, NodeDB::StreamType::AssetsMmr, true);
+				mmr0.set_Cache(cp0);
+				mmr0.m_Count = mmr.m_Count;
+
+				Merkle::Hash hv, hv0;
+				mmr.get_Hash(hv);
+				mmr0.get_Hash(hv0);
+				verify_test(hv == hv0);
+
+				for (uint64_t i = 0; i < mmr.m_Count; i++)
+				{
+					Merkle::Proof p, p0;
+					mmr.get_Proof(p, i);
+					mmr0.get_Proof(p0, i);
+					verify_test(p == p0);
+				}
+			};
+
+			for (uint32_t i = 0; i < 300; i++)
+				mmr.Append(Merkle::Hash(i));
+			fnVerify();
+
+			mmr.ShrinkTo(170); // small rollback
+			for (uint32_t i = 0; i < 20; i++)
+				mmr.Append(Merkle::Hash(i + 1000));
+			fnVerify();
+
+			mmr.ShrinkTo(3); // massive rollback
+			for (uint32_t i = 0; i < 100; i++)
+				mmr.Append(Merkle::Hash(i + 2000));
+			fnVerify();
+
+			const NodeDB::StreamMmr::Stats& st = mmr.get_Stats();
+			verify_test(st.m_HitsPinned && st.m_Misses);
+
+			mmr.ResizeTo(0);
+		}
+
 		tr.Commit();
 
 		// Contract data
@@ -1080,6 +1158,16 @@ namespace beam
 			NodeProcessor::BlockContext bc(np.m_TxPool, 0, *np.m_Wallet.m_pKdf, *np.m_Wallet.m_pKdf);
 			verify_test(np.GenerateNewBlock(bc));
 
+			{
+				// same tip and pool, the template should be refreshed incrementally, to the same block
+				NodeProcessor::BlockContext bc2(np.m_TxPool, 0, *np.m_Wallet.m_pKdf, *np.m_Wallet.m_pKdf);
+				verify_test(np.GenerateNewBlock(bc2));
+				verify_test(np.m_Template.m_Incremental);
+				verify_test(bc2.m_Fees == bc.m_Fees);
+				verify_test(bc2.m_Block.m_vInputs.size() == bc.m_Block.m_vInputs.size());
+				verify_test(bc2.m_Block.m_vKernels.size() == bc.m_Block.m_vKernels.size());
+			}
+
 			np.OnState(bc.m_Hdr, PeerID());
 
 			Block::SystemState::ID id;
@@ -1695,6 +1783,12 @@ namespace beam
 
 		verify_test(parser.Proceed(g_sz3));
 
+		{
+			// same, with the utxo tree built in parallel
+			Executor::Scope scope(node.get_Processor().get_Executor());
+			verify_test(parser.Proceed(g_sz3));
+		}
+
 		DeleteFile(g_sz3);
 	}
 
@@ -1737,6 +1831,16 @@ namespace beam
 		node.m_Cfg.m_Horizon.m_Sync.Lo = 14;
 		//node.m_Cfg.m_Horizon.m_Local = node.m_Cfg.m_Horizon.m_Sync;
 		node.m_Cfg.m_VerificationThreads = -1;
+		node.m_Cfg.m_TxPipeline.m_MaxInFlight = 4;
+		node.m_Cfg.m_TxPipeline.m_BatchSize = 2;
+		node.m_Cfg.m_DbReaders = 2;
+		node.m_Cfg.m_SealOffloadThreshold = 1024;
+		node.m_Cfg.m_CompressThreshold = 512;
+		node.m_Cfg.m_TxReconcile.m_Enabled = true;
+		node.m_Cfg.m_TxReconcile.m_FloodPeers = 0; // reconcile with node2
+		node.m_Cfg.m_TxReconcile.m_Period_ms = 200;
+		node.m_Cfg.m_CompactBlocks.m_Enabled = true;
+		node.m_Cfg.m_CompactBlocks.m_StatsPeriod_ms = 0; // don't reset the stats
 
 		node.m_Cfg.m_Dandelion.m_AggregationTime_ms = 0;
 		node.m_Cfg.m_Dandelion.m_OutputsMin = 3;
@@ -3065,6 +3169,8 @@ namespace beam
 		node2.m_Cfg.m_Timeout = node.m_Cfg.m_Timeout;
 
 		node2.m_Cfg.m_Dandelion = node.m_Cfg.m_Dandelion;
+		node2.m_Cfg.m_TxReconcile = node.m_Cfg.m_TxReconcile;
+		node2.m_Cfg.m_CompactBlocks = node.m_Cfg.m_CompactBlocks;
 
 		node2.m_Cfg.m_Horizon = node.m_Cfg.m_Horizon;
 		node2.m_Cfg.m_Horizon.m_Local = node2.m_Cfg.m_Horizon.m_Sync;
@@ -3076,6 +3182,12 @@ namespace beam
 		pReactor->run();
 
 		cl.TestAllDone(true);
+		verify_test(node2.get_CompactBlocksRebuilt() > 0); // the new blocks were relayed in the compact form
+		verify_test(node.get_CryptoOffloadStats().m_Messages > 0); // large replies were sealed asynchronously
+
+		NodeProcessor::ModuleCache::Stats mcs;
+		node.get_Processor().m_ModuleCache.get_Stats(mcs);
+		verify_test(mcs.m_Hits && mcs.m_Invalidations); // the contract is invoked several times, and then destroyed
 
 		struct TxoRecover
 			:public NodeProcessor::ITxoRecover
@@ -3162,6 +3274,128 @@ namespace beam
 	}
 
 
+	void TestValidatedCache()
+	{
+		NodeProcessor::ValidatedCache vc(4);
+		NodeProcessor::ValidatedCache::Stats st;
+
+		std::vector<ECC::Hash::Value> vKeys(200);
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+			ECC::Hash::Processor() << i >> vKeys[i];
+
+		vc.Insert(vKeys[0], 10);
+		vc.Insert(vKeys[1], 20);
+		verify_test(vc.Find(vKeys[0]));
+		verify_test(vc.Find(vKeys[1]));
+		verify_test(!vc.Find(vKeys[2]));
+
+		vc.OnShLo(15);
+		verify_test(vc.Find(vKeys[0]));
+		verify_test(!vc.Find(vKeys[1]));
+
+		// overflow, must evict
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+			vc.Insert(vKeys[i], i);
+
+		vc.get_Stats(st);
+		verify_test(st.m_Evictions);
+
+		uint32_t nFound = 0;
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+			if (vc.Find(vKeys[i]))
+				nFound++;
+		verify_test(nFound && (nFound <= 4 * NodeProcessor::ValidatedCache::s_Ways));
+
+		// concurrent access
+		std::vector<std::thread> vThreads(4);
+		for (uint32_t iThread = 0; iThread < vThreads.size(); iThread++)
+		{
+			vThreads[iThread] = std::thread([&vc, &vKeys, iThread]()
+			{
+				for (uint32_t i = 0; i < 10000; i++)
+				{
+					const ECC::Hash::Value& key = vKeys[(i * 7 + iThread) % vKeys.size()];
+					if (!vc.Find(key))
+						vc.Insert(key, i);
+				}
+			});
+		}
+
+		for (auto& t : vThreads)
+			t.join();
+
+		vc.Insert(vKeys[0], 0); // must be erased too
+		vc.Clear();
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+			verify_test(!vc.Find(vKeys[i]));
+	}
+
+	void TestTxSketch()
+	{
+		std::vector<Transaction::KeyType> vKeys(300);
+		for (uint32_t i = 0; i < vKeys.size(); i++)
+			ECC::Hash::Processor() << "tx" << i >> vKeys[i];
+
+		const uint64_t nSalt = 77;
+
+		for (uint32_t nDiff : { 0U, 1U, 5U, 40U })
+		{
+			// sets share 200 elements, each has nDiff own
+			TxPool::Sketch sk1, sk2;
+			uint32_t nCells = TxPool::Sketch::get_Cells(nDiff * 2);
+			sk1.Reset(nCells);
+			sk2.Reset(nCells);
+
+			for (uint32_t i = 0; i < 200; i++)
+			{
+				uint64_t id = TxPool::Sketch::get_ShortID(vKeys[i], nSalt);
+				sk1.Add(id);
+				sk2.Add(id);
+			}
+
+			for (uint32_t i = 0; i < nDiff; i++)
+			{
+				sk1.Add(TxPool::Sketch::get_ShortID(vKeys[200 + i], nSalt));
+				sk2.Add(TxPool::Sketch::get_ShortID(vKeys[250 + i], nSalt));
+			}
+
+			// via serialization
+			ByteBuffer buf;
+			sk2.Export(buf);
+			verify_test(buf.size() == nCells * TxPool::Sketch::s_CellSize);
+
+			TxPool::Sketch sk3;
+			verify_test(sk3.Import(buf));
+
+			sk1.Subtract(sk3);
+
+			std::vector<uint64_t> vMine, vOther;
+			verify_test(sk1.Decode(vMine, vOther));
+			verify_test((vMine.size() == nDiff) && (vOther.size() == nDiff));
+
+			for (uint32_t i = 0; i < nDiff; i++)
+			{
+				verify_test(std::find(vMine.begin(), vMine.end(), TxPool::Sketch::get_ShortID(vKeys[200 + i], nSalt)) != vMine.end());
+				verify_test(std::find(vOther.begin(), vOther.end(), TxPool::Sketch::get_ShortID(vKeys[250 + i], nSalt)) != vOther.end());
+			}
+		}
+
+		// too small sketch must fail to decode, not produce garbage
+		TxPool::Sketch sk;
+		sk.Reset(TxPool::Sketch::s_Hashes * 2);
+		for (uint32_t i = 0; i < 100; i++)
+			sk.Add(TxPool::Sketch::get_ShortID(vKeys[i], nSalt));
+
+		std::vector<uint64_t> vMine, vOther;
+		verify_test(!sk.Decode(vMine, vOther));
+
+		// malformed
+		ByteBuffer buf(TxPool::Sketch::s_CellSize * 2);
+		verify_test(!sk.Import(buf));
+		buf.clear();
+		verify_test(!sk.Import(buf));
+	}
+
 	void TestChainworkProof()
 	{
 		printf("Preparing blockchain ...\n");
@@ -3793,6 +4027,372 @@ namespace beam
 		}
 	}
 
+	void TestTxPipeline()
+	{
+		// A peer node relays a valid and an invalid tx. Both are verified in the same batch, only the invalid one should be rejected
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		MiniWallet wlt;
+		ECC::SetRandom(wlt.m_pKdf);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_MiningThreads = 0;
+		node.m_Cfg.m_Treasury = g_Treasury;
+		node.m_Cfg.m_VerificationThreads = -1;
+		node.m_Cfg.m_TxPipeline.m_MaxInFlight = 2;
+		node.m_Cfg.m_TxPipeline.m_BatchSize = 2;
+		node.m_Cfg.m_TxPipeline.m_StatsPeriod_ms = 0; // don't reset the stats
+		node.m_Keys.SetSingleKey(wlt.m_pKdf);
+		node.Initialize();
+		node.m_PostStartSynced = true;
+
+		const Height h = 20;
+		RaiseHeightTo(node, h);
+
+		for (Height h1 = 1; h1 <= 2; h1++)
+			wlt.AddMyUtxo(CoinID(Rules::get_Emission(h1), h1, Key::Type::Coinbase));
+
+		Transaction::Ptr pTxValid, pTxBad;
+		verify_test(wlt.MakeTx(pTxValid, h, 0));
+		verify_test(wlt.MakeTx(pTxBad, h, 0));
+
+		{
+			// break the kernel signature
+			TxKernelStd& krn = Cast::Up<TxKernelStd>(*pTxBad->m_vKernels.front());
+			ECC::Scalar::Native k = krn.m_Signature.m_k;
+			k += k;
+			krn.m_Signature.m_k = k;
+		}
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			std::vector<Transaction::Ptr> m_vTxs;
+
+			virtual void OnConnectedSecure() override
+			{
+				// txs from the other nodes are deferred, and go through the pipeline
+				ECC::Scalar::Native sk;
+				sk.GenRandomNnz();
+				ProveID(sk, proto::IDType::Node);
+
+				for (const auto& pTx : m_vTxs)
+				{
+					proto::NewTransaction msg;
+					msg.m_Transaction = pTx;
+					msg.m_Fluff = true;
+					Send(msg);
+				}
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {} // may be dropped for the invalid tx
+
+		} cl;
+
+		cl.m_vTxs.push_back(pTxValid);
+		cl.m_vTxs.push_back(pTxBad);
+
+		Transaction::KeyType keyValid, keyBad;
+		pTxValid->get_Key(keyValid);
+		pTxBad->get_Key(keyBad);
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+		cl.Connect(addr);
+
+		auto fnInPool = [&node](const Transaction::KeyType& key) {
+			return node.m_TxPool.m_setTxs.end() != node.m_TxPool.m_setTxs.find(key, TxPool::Fluff::Element::Tx::Comparator());
+		};
+
+		uint32_t nCycles = 0;
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(100, true, [&]() {
+			if (fnInPool(keyValid) && node.get_TxPipelineRejected())
+				io::Reactor::get_Current().stop();
+			else if (++nCycles > 300)
+			{
+				fail_test("tx pipeline timeout");
+				io::Reactor::get_Current().stop();
+			}
+		});
+
+		pReactor->run();
+
+		verify_test(node.get_TxPipelineBatches() > 0);
+		verify_test(node.get_TxPipelineRejected() == 1);
+		verify_test(fnInPool(keyValid));
+		verify_test(!fnInPool(keyBad));
+	}
+
+	void TestParallelContracts()
+	{
+		// A chain with many contract calls per block is generated with the serial interpretation, then interpreted with the concurrent pre-execution.
+		// Each block definition is verified, i.e. both must arrive at the same state.
+		MyNodeProcessor1 np;
+		NodeProcessor::StartParams sp;
+		sp.m_ParallelContracts = 0;
+		np.Initialize(g_sz, sp);
+		np.OnTreasury(g_Treasury);
+
+		struct MyNodeProcessor2
+			:public NodeProcessor
+		{
+			ExecutorMT_R m_Exec;
+			Executor& get_Executor() override { return m_Exec; }
+		};
+
+		MyNodeProcessor2 np2;
+		np2.m_Exec.set_Threads(4);
+		sp.m_ParallelContracts = 2;
+		sp.m_BvmProfile = true;
+		np2.Initialize(g_sz2, sp);
+		np2.OnTreasury(g_Treasury);
+
+		ByteBuffer bufContract;
+		bvm2::Compile(bufContract, "vault/contract.wasm", bvm2::Processor::Kind::Contract);
+
+		// several instances (c'tor args differ). Calls to the same instance conflict (the locked funds), calls to different ones don't.
+		const uint32_t nInstances = 4;
+		bvm2::ContractID pCid[nInstances];
+
+#pragma pack (push, 1)
+		struct Deposit // Vault::Deposit
+		{
+			ECC::Point m_Account;
+			Asset::ID m_Aid;
+			Amount m_Amount;
+		};
+#pragma pack (pop)
+
+		auto fnAddTx = [&np](Height h, const bvm2::ContractInvokeEntry& cie, Amount valSpend)
+		{
+			Transaction::Ptr pTx;
+			Amount val = np.m_Wallet.MakeTxInput(pTx, h - 1);
+			if (!val)
+				return false;
+
+			HeightRange hr(h, MaxHeight);
+
+			Amount fee = cie.get_FeeMin(h);
+			if (val <= valSpend + fee)
+				return false;
+
+			cie.Generate(*pTx, *np.m_Wallet.m_pKdf, hr, fee);
+			np.m_Wallet.MakeTxOutput(*pTx, h - 1, 1, val - valSpend - fee);
+
+			uint32_t nBvmCharge = 0;
+			verify_test(proto::TxStatus::Ok == np.ValidateTxContextEx(*pTx, hr, false, nBvmCharge, nullptr, nullptr, nullptr));
+
+			Transaction::Context::Params pars;
+			Transaction::Context ctx(pars);
+			ctx.m_Height = h;
+			verify_test(pTx->IsValid(ctx));
+
+			Transaction::KeyType key;
+			pTx->get_Key(key);
+
+			TxPool::Stats stats;
+			stats.From(*pTx, ctx, 0, 0);
+
+			np.m_TxPool.AddValidTx(std::move(pTx), stats, key, TxPool::Fluff::State::Fluffed);
+			return true;
+		};
+
+		auto fnMine = [&np, &np2](Height h)
+		{
+			NodeProcessor::BlockContext bc(np.m_TxPool, 0, *np.m_Wallet.m_pKdf, *np.m_Wallet.m_pKdf);
+			verify_test(np.GenerateNewBlock(bc));
+
+			np.OnState(bc.m_Hdr, PeerID());
+
+			Block::SystemState::ID id;
+			bc.m_Hdr.get_ID(id);
+
+			np.OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
+			np.TryGoUp();
+			verify_test(np.m_Cursor.m_ID == id);
+
+			np.m_Wallet.AddMyUtxo(CoinID(bc.m_Fees, h, Key::Type::Comission));
+			np.m_Wallet.AddMyUtxo(CoinID(Rules::get_Emission(h), h, Key::Type::Coinbase));
+
+			np2.OnState(bc.m_Hdr, PeerID());
+			np2.OnBlock(id, bc.m_BodyP, bc.m_BodyE, PeerID());
+			np2.TryGoUp();
+			verify_test(np2.m_Cursor.m_ID == id);
+
+			return bc.m_Block.m_vKernels.size();
+		};
+
+		uint32_t nCalls = 0;
+		Height h = Rules::HeightGenesis;
+
+		for (; h < 40; h++)
+		{
+			while (h >= Rules::get().pForks[3].m_Height)
+			{
+				bvm2::ContractInvokeEntry cie;
+				Amount valDeposit = 0;
+
+				if (nCalls < nInstances)
+				{
+					cie.m_Data = bufContract;
+					Blob(&nCalls, sizeof(nCalls)).Export(cie.m_Args);
+					bvm2::get_Cid(pCid[nCalls], cie.m_Data, cie.m_Args);
+				}
+				else
+				{
+					Deposit arg;
+					arg.m_Account.m_X = nCalls;
+					arg.m_Account.m_Y = 0;
+					arg.m_Aid = 0;
+					arg.m_Amount = valDeposit = 1000 + nCalls;
+
+					cie.m_Cid = pCid[nCalls % nInstances];
+					cie.m_iMethod = 2;
+					Blob(&arg, sizeof(arg)).Export(cie.m_Args);
+					cie.m_Spend.AddSpend(0, valDeposit);
+				}
+
+				if (!fnAddTx(h, cie, valDeposit))
+					break;
+
+				if (++nCalls == nInstances)
+					break; // deployments get a block of their own
+			}
+
+			fnMine(h);
+		}
+
+		const auto& st = np2.m_ParallelContracts.m_Stats;
+		verify_test(st.m_Committed); // independent calls
+		verify_test(st.m_Committed < st.m_Executed); // conflicts
+		verify_test(st.m_Repeated); // log positions
+		verify_test(!np.m_ParallelContracts.m_Stats.m_Blocks);
+
+		// each invocation is profiled once, whether committed or re-executed
+		bvm2::Profiler::Map mp;
+		np2.m_pBvmProfiler->get_Data(mp);
+
+		uint64_t nDeposits = 0;
+		for (const auto& x : mp)
+		{
+			const auto& s = x.second;
+			if (2 == x.first.m_iMethod)
+			{
+				nDeposits += s.m_Calls;
+				verify_test(s.m_Instructions && s.m_Charge && s.m_Reads && s.m_Writes);
+				verify_test(1 == s.m_DepthMax);
+			}
+		}
+		verify_test(nDeposits == nCalls - nInstances);
+
+		mp.clear();
+		np.m_pBvmProfiler->get_Data(mp);
+		verify_test(mp.empty());
+
+		// contract upgrade (via upgradable2). The calls in the block of the upgrade conflict, all must see the new version
+		ByteBuffer bufUpgr, bufV0, bufV1;
+		bvm2::Compile(bufUpgr, "upgradable2/contract.wasm", bvm2::Processor::Kind::Contract);
+		bvm2::Compile(bufV0, "upgradable2/Test/test_v0.wasm", bvm2::Processor::Kind::Contract);
+		bvm2::Compile(bufV1, "upgradable2/Test/test_v1.wasm", bvm2::Processor::Kind::Contract);
+
+#pragma pack (push, 1)
+		struct UpgrCreate // Upgradable2::Create
+		{
+			bvm2::ContractID m_Active;
+			Height m_hMinUpgadeDelay;
+			uint32_t m_MinApprovers;
+			ECC::Point m_pAdmin[32];
+		};
+
+		struct UpgrSchedule // Upgradable2::Control::ScheduleUpgrade
+		{
+			uint8_t m_Type;
+			uint32_t m_ApproveMask;
+			bvm2::ContractID m_Cid;
+			Height m_hTarget;
+		};
+#pragma pack (pop)
+
+		bvm2::ContractID cidV0, cidV1, cidUpgr;
+
+		for (uint32_t i = 0; i < 2; i++)
+		{
+			bvm2::ContractInvokeEntry cie;
+			cie.m_Data = i ? bufV1 : bufV0;
+			bvm2::get_Cid(i ? cidV1 : cidV0, cie.m_Data, cie.m_Args);
+			verify_test(fnAddTx(h, cie, 0));
+		}
+		fnMine(h++);
+
+		ECC::Hash::Value hvAdmin;
+		ECC::Hash::Processor() << "upgr.admin" >> hvAdmin;
+
+		{
+			ECC::Scalar::Native sk;
+			np.m_Wallet.m_pKdf->DeriveKey(sk, hvAdmin);
+
+			UpgrCreate arg;
+			ZeroObject(arg);
+			arg.m_Active = cidV0;
+			arg.m_hMinUpgadeDelay = 1;
+			arg.m_MinApprovers = 1;
+			ECC::Point::Native pt = ECC::Context::get().G * sk;
+			pt.Export(arg.m_pAdmin[0]);
+
+			bvm2::ContractInvokeEntry cie;
+			cie.m_Data = bufUpgr;
+			Blob(&arg, sizeof(arg)).Export(cie.m_Args);
+			bvm2::get_Cid(cidUpgr, cie.m_Data, cie.m_Args);
+			verify_test(fnAddTx(h, cie, 0));
+		}
+		fnMine(h++);
+
+		const Height hTarget = h + 2;
+		{
+			UpgrSchedule arg;
+			arg.m_Type = 2;
+			arg.m_ApproveMask = 1;
+			arg.m_Cid = cidV1;
+			arg.m_hTarget = hTarget;
+
+			bvm2::ContractInvokeEntry cie;
+			cie.m_Cid = cidUpgr;
+			cie.m_iMethod = 2;
+			cie.m_vSig.push_back(hvAdmin);
+			Blob(&arg, sizeof(arg)).Export(cie.m_Args);
+			verify_test(fnAddTx(h, cie, 0));
+		}
+		fnMine(h++);
+
+		uint64_t nExecuted0 = st.m_Executed;
+		uint64_t nCommitted0 = st.m_Committed;
+
+		for (; h <= hTarget; h++)
+		{
+			const uint32_t nUpgrCalls = 3;
+			for (uint32_t i = 0; i < nUpgrCalls; i++)
+			{
+				uint32_t nExpectedVer = (hTarget == h); // Upgradable2::Test::SomeMethod
+
+				bvm2::ContractInvokeEntry cie;
+				cie.m_Cid = cidUpgr;
+				cie.m_iMethod = 3;
+				Blob(&nExpectedVer, sizeof(nExpectedVer)).Export(cie.m_Args);
+				verify_test(fnAddTx(h, cie, 0));
+			}
+
+			verify_test(fnMine(h) > nUpgrCalls); // all included
+		}
+
+		verify_test(st.m_Executed > nExecuted0);
+		verify_test(st.m_Committed - nCommitted0 < st.m_Executed - nExecuted0); // the upgrade conflicts with the subsequent calls
+	}
 
 
 }
@@ -3824,6 +4424,8 @@ void TestAll()
 
 	if (!bClientProtoOnly)
 	{
+		beam::TestValidatedCache();
+		beam::TestTxSketch();
 		beam::TestHalving();
 		beam::TestChainworkProof();
 	}
@@ -3886,6 +4488,13 @@ void TestAll()
 	beam::Rules::get().Shielded.m_ProofMin = { 4, 5 }; // 1K
 	beam::Rules::get().UpdateChecksum();
 
+	printf("Parallel contracts test...\n");
+	fflush(stdout);
+
+	beam::TestParallelContracts();
+	beam::DeleteFile(beam::g_sz);
+	beam::DeleteFile(beam::g_sz2);
+
 	printf("Node <---> Client test (with proofs)...\n");
 	fflush(stdout);
 
@@ -3908,9 +4517,12 @@ void TestAll()
 		std::string sPath;
 		beam::NodeProcessor::get_MappingPath(sPath, beam::g_sz);
 		beam::DeleteFile(sPath.c_str());
+		beam::NodeProcessor::get_ShieldedImagePath(sPath, beam::g_sz);
+		beam::DeleteFile(sPath.c_str());
 
 		beam::Node node;
 		node.m_Cfg.m_sPathLocal = beam::g_sz;
+		node.m_Cfg.m_VerificationThreads = 3; // utxos are rebuilt in shards
 		node.Initialize();
 
 		auto& p = node.get_Processor();
@@ -3947,6 +4559,12 @@ void TestAll()
 	beam::TestDependentTxs();
 	beam::DeleteFile(beam::g_sz);
 	beam::DeleteFile(beam::g_sz2);
+
+	printf("Node tx pipeline test...\n");
+	fflush(stdout);
+
+	beam::TestTxPipeline();
+	beam::DeleteFile(beam::g_sz);
 }
 
 int main()
@@ -938,6 +938,7 @@ int main_Guarded(int argc, char* argv[])
     auto logger = beam::Logger::create(LOG_LEVEL_INFO, LOG_LEVEL_INFO);
 
     const char szLocalMode[] = "local_mode";
+    const char szStatsPeriod[] = "stats_period_s";
 
 #define THE_MACRO(type, name, def, comment) const char sz##name[] = #name;
     CfgFieldsAll(THE_MACRO)
@@ -948,6 +949,10 @@ int main_Guarded(int argc, char* argv[])
     options.add_options()
         (cli::SEED_PHRASE, po::value<std::string>()->default_value(""), "seed phrase")
         (szLocalMode, po::value<bool>()->default_value(false), "local mode")
+        (cli::TX_RECONCILE, po::value<bool>()->default_value(false), "tx announcements via reconciliation (compare bytes/tx in the logs)")
+        (cli::TX_RECONCILE_FLOOD_PEERS, po::value<uint32_t>()->default_value(4), "outbound peers still flooded with the reconciliation")
+        (cli::COMPACT_BLOCKS, po::value<bool>()->default_value(false), "new blocks in the compact form (compare the rebuilt/mismatch counts in the logs)")
+        (szStatsPeriod, po::value<uint32_t>()->default_value(60), "node stats logging period")
         
 #define THE_MACRO(type, name, def, comment) (sz##name, po::value<type>()->default_value(def), comment)
         CfgFieldsAll(THE_MACRO)
@@ -962,6 +967,11 @@ int main_Guarded(int argc, char* argv[])
     Node node;
     node.m_Cfg.m_VerificationThreads = -1;
     node.m_Cfg.m_sPathLocal = "node_net_sim.db";
+    node.m_Cfg.m_TxReconcile.m_Enabled = vm[cli::TX_RECONCILE].as<bool>();
+    node.m_Cfg.m_TxReconcile.m_FloodPeers = vm[cli::TX_RECONCILE_FLOOD_PEERS].as<uint32_t>();
+    node.m_Cfg.m_TxReconcile.m_StatsPeriod_ms = vm[szStatsPeriod].as<uint32_t>() * 1000;
+    node.m_Cfg.m_CompactBlocks.m_Enabled = vm[cli::COMPACT_BLOCKS].as<bool>();
+    node.m_Cfg.m_CompactBlocks.m_StatsPeriod_ms = node.m_Cfg.m_TxReconcile.m_StatsPeriod_ms;
 
     Context ctx;
     ctx.m_pProc = &node.get_Processor();
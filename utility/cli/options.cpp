@@ -144,6 +144,17 @@ namespace beam
         const char* MINING_THREADS = "mining_threads";
         const char* POW_SOLVE_TIME = "pow_solve_time";
         const char* VERIFICATION_THREADS = "verification_threads";
+        const char* TX_PIPELINE_INFLIGHT = "tx_pipeline_inflight";
+        const char* DB_READERS = "db_readers";
+        const char* SEAL_OFFLOAD_THRESHOLD = "seal_offload_threshold";
+        const char* COMPRESS_THRESHOLD = "compress_threshold";
+        const char* TX_RECONCILE = "tx_reconcile";
+        const char* TX_RECONCILE_FLOOD_PEERS = "tx_reconcile_flood_peers";
+        const char* COMPACT_BLOCKS = "compact_blocks";
+        const char* MMR_CACHE = "mmr_cache";
+        const char* MMR_CACHE_PINNED = "mmr_cache_pinned";
+        const char* CONTRACTS_PARALLEL = "contracts_parallel";
+        const char* BVM_PROFILE = "bvm_profile";
         const char* NONCEPREFIX_DIGITS = "nonceprefix_digits";
         const char* NODE_PEER = "peer";
         const char* NODE_PEERS_PERSISTENT = "peers_persistent";
@@ -423,6 +434,17 @@ namespace beam
             (cli::POW_SOLVE_TIME, po::value<uint32_t>()->default_value(15 * 1000), "pow solve time. It works if FakePoW is enabled")
 
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
+            (cli::TX_PIPELINE_INFLIGHT, po::value<uint32_t>()->default_value(0), "max number of received transactions verified concurrently by the verification threads (0 = verify in the node thread)")
+            (cli::DB_READERS, po::value<uint32_t>()->default_value(0), "number of threads serving read-only peer requests from the DB in WAL mode (0 = serve in the node thread)")
+            (cli::SEAL_OFFLOAD_THRESHOLD, po::value<uint32_t>()->default_value(0), "min size of an outbound p2p message to encrypt it by the verification threads (0 = encrypt in the node thread)")
+            (cli::COMPRESS_THRESHOLD, po::value<uint32_t>()->default_value(4096), "min size of a block body, header pack or shielded list reply to compress it for the peers that support it (0 = never compress)")
+            (cli::TX_RECONCILE, po::value<bool>()->default_value(false), "announce transactions to the supporting peers by periodic set reconciliation, instead of flooding")
+            (cli::TX_RECONCILE_FLOOD_PEERS, po::value<uint32_t>()->default_value(4), "number of outbound peers that are still flooded when the reconciliation is on")
+            (cli::COMPACT_BLOCKS, po::value<bool>()->default_value(false), "request new blocks in the compact form (kernel short IDs), and rebuild them from the transaction pool")
+            (cli::MMR_CACHE, po::value<uint32_t>()->default_value(0x4000), "number of cached elements per MMR (shielded, assets, states), rounded down to power of 2 (0 = disabled)")
+            (cli::MMR_CACHE_PINNED, po::value<uint32_t>()->default_value(8), "MMR elements at this height and above are kept in memory once loaded (64 = none)")
+            (cli::CONTRACTS_PARALLEL, po::value<uint32_t>()->default_value(0), "min contract calls in a block to pre-execute them concurrently on the verification threads (0 = always serial)")
+            (cli::BVM_PROFILE, po::value<bool>()->default_value(false), "collect per contract method execution stats, set at startup (dumped to the log on exit, see /contracts_profile in the explorer node)")
             (cli::NONCEPREFIX_DIGITS, po::value<unsigned>()->default_value(0), "number of hex digits for nonce prefix for stratum client (0..6)")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
             (cli::NODE_PEERS_PERSISTENT, po::value<bool>()->default_value(false), "Keep persistent connection to the specified peers, regardless to ratings")
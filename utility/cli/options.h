@@ -46,6 +46,17 @@ namespace beam
         extern const char* MINING_THREADS;
         extern const char* POW_SOLVE_TIME;
         extern const char* VERIFICATION_THREADS;
+        extern const char* TX_PIPELINE_INFLIGHT;
+        extern const char* DB_READERS;
+        extern const char* SEAL_OFFLOAD_THRESHOLD;
+        extern const char* COMPRESS_THRESHOLD;
+        extern const char* TX_RECONCILE;
+        extern const char* TX_RECONCILE_FLOOD_PEERS;
+        extern const char* COMPACT_BLOCKS;
+        extern const char* MMR_CACHE;
+        extern const char* MMR_CACHE_PINNED;
+        extern const char* CONTRACTS_PARALLEL;
+        extern const char* BVM_PROFILE;
         extern const char* NONCEPREFIX_DIGITS;
         extern const char* NODE_PEER;
         extern const char* NODE_PEERS_PERSISTENT;
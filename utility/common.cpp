@@ -140,6 +140,73 @@ namespace beam
 		}
 	}
 
+	void Executor::ExecItems(uint32_t nCount, const std::function<void(uint32_t)>& fn)
+	{
+		struct Shared
+		{
+			std::mutex m_Mutex;
+			std::condition_variable m_Idle;
+			const std::function<void(uint32_t)>* m_pFn; // valid only while there are items left or being executed
+			uint32_t m_iNext = 0;
+			uint32_t m_Count;
+			uint32_t m_Active = 0;
+
+			void RunAll()
+			{
+				while (true)
+				{
+					uint32_t i;
+					{
+						std::unique_lock<std::mutex> scope(m_Mutex);
+						if (m_iNext >= m_Count)
+							break;
+
+						i = m_iNext++;
+						m_Active++;
+					}
+
+					(*m_pFn)(i);
+
+					std::unique_lock<std::mutex> scope(m_Mutex);
+					if (!--m_Active)
+						m_Idle.notify_all();
+				}
+			}
+		};
+
+		struct Task
+			:public TaskAsync
+		{
+			std::shared_ptr<Shared> m_pShared; // the helper may start after the caller returned, it'd find nothing to do
+
+			virtual void Exec(Context&) override
+			{
+				m_pShared->RunAll();
+			}
+		};
+
+		auto pShared = std::make_shared<Shared>();
+		pShared->m_pFn = &fn;
+		pShared->m_Count = nCount;
+
+		uint32_t nHelpers = std::min(get_Threads(), nCount);
+		if (nHelpers)
+			nHelpers--; // the caller is one of them
+
+		for (uint32_t i = 0; i < nHelpers; i++)
+		{
+			auto pTask = std::make_unique<Task>();
+			pTask->m_pShared = pShared;
+			Push(std::move(pTask));
+		}
+
+		pShared->RunAll();
+
+		std::unique_lock<std::mutex> scope(pShared->m_Mutex);
+		while (pShared->m_Active)
+			pShared->m_Idle.wait(scope);
+	}
+
 	uint32_t Executor::Context::get_Pos(uint32_t nTotal, uint32_t iThread, uint32_t nThreads)
 	{
 		uint64_t val = nTotal;
@@ -17,6 +17,7 @@
 #include "common.h"
 #include <condition_variable>
 #include <thread>
+#include <functional>
 #include <boost/intrusive/list.hpp>
 #include "thread.h"
 
@@ -68,6 +69,10 @@ namespace beam
 		virtual uint32_t Flush(uint32_t nMaxTasks = 0) = 0;
 		virtual void ExecAll(TaskSync&) = 0;
 		virtual ~Executor() = default;
+
+		// Executes nCount independent items in the caller thread, and in the worker threads that become free meanwhile.
+		// Unlike ExecAll, waits only for its own items being executed, not for the other queued tasks.
+		void ExecItems(uint32_t nCount, const std::function<void(uint32_t)>&);
 	};
 
 	// standard multi-threaded executor. All threads are created with default stack and priority
@@ -0,0 +1,184 @@
+// Copyright 2018-2020 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lz.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+namespace beam
+{
+	// Format: sequence of [token][literals len ext][literals][offset:2][match len ext]
+	// token: hi nibble - num of literals, lo nibble - match len minus s_MinMatch. 15 means the value continues in the ext bytes (255 - continue).
+	// The last sequence has only literals (no offset), it ends where the data ends.
+
+	namespace
+	{
+		const uint32_t s_HashBits = 14;
+		const size_t s_MaxOffset = 0xffff;
+
+		uint32_t Load32(const uint8_t* p)
+		{
+			uint32_t x;
+			memcpy(&x, p, sizeof(x));
+			return x;
+		}
+
+		uint32_t get_Hash(uint32_t x)
+		{
+			return (x * 2654435761U) >> (32 - s_HashBits);
+		}
+	}
+
+	size_t Lz::get_MaxCompressed(size_t nSize)
+	{
+		return nSize + nSize / 255 + 16;
+	}
+
+	uint8_t* Lz::WriteLen(uint8_t* p, size_t n)
+	{
+		for (; n >= 0xff; n -= 0xff)
+			*p++ = 0xff;
+		*p++ = static_cast<uint8_t>(n);
+		return p;
+	}
+
+	bool Lz::ReadLen(size_t& n, const uint8_t*& p, const uint8_t* pEnd)
+	{
+		while (true)
+		{
+			if (p == pEnd)
+				return false;
+
+			uint8_t x = *p++;
+			n += x;
+			if (x != 0xff)
+				return true;
+		}
+	}
+
+	size_t Lz::Compress(uint8_t* pDst, const uint8_t* pSrc, size_t nSize)
+	{
+		std::vector<uint32_t> vTbl(size_t(1) << s_HashBits, 0); // pos + 1, 0 = empty
+
+		uint8_t* p = pDst;
+		size_t iAnchor = 0; // literals start
+
+		for (size_t i = 0; i + s_MinMatch <= nSize; )
+		{
+			uint32_t x = Load32(pSrc + i);
+			uint32_t& iSlot = vTbl[get_Hash(x)];
+			size_t iRef = iSlot;
+			iSlot = static_cast<uint32_t>(i + 1);
+
+			if (!iRef || (i - --iRef > s_MaxOffset) || (Load32(pSrc + iRef) != x))
+			{
+				// skip faster over the incompressible data
+				i += 1 + ((i - iAnchor) >> 6);
+				continue;
+			}
+
+			size_t nLen = s_MinMatch;
+			while ((i + nLen < nSize) && (pSrc[iRef + nLen] == pSrc[i + nLen]))
+				nLen++;
+
+			size_t nLit = i - iAnchor;
+			size_t nLenX = nLen - s_MinMatch;
+
+			uint8_t* pToken = p++;
+			*pToken = static_cast<uint8_t>((std::min<size_t>(nLit, 0xf) << 4) | std::min<size_t>(nLenX, 0xf));
+
+			if (nLit >= 0xf)
+				p = WriteLen(p, nLit - 0xf);
+
+			memcpy(p, pSrc + iAnchor, nLit);
+			p += nLit;
+
+			size_t nOffset = i - iRef;
+			*p++ = static_cast<uint8_t>(nOffset);
+			*p++ = static_cast<uint8_t>(nOffset >> 8);
+
+			if (nLenX >= 0xf)
+				p = WriteLen(p, nLenX - 0xf);
+
+			i += nLen;
+			iAnchor = i;
+		}
+
+		// last literals
+		size_t nLit = nSize - iAnchor;
+		*p++ = static_cast<uint8_t>(std::min<size_t>(nLit, 0xf) << 4);
+		if (nLit >= 0xf)
+			p = WriteLen(p, nLit - 0xf);
+
+		if (nLit)
+			memcpy(p, pSrc + iAnchor, nLit);
+		p += nLit;
+
+		return p - pDst;
+	}
+
+	bool Lz::Decompress(uint8_t* pDst, size_t nDst, const uint8_t* pSrc, size_t nSrc)
+	{
+		const uint8_t* pEnd = pSrc + nSrc;
+		size_t iPos = 0;
+
+		while (true)
+		{
+			if (pSrc == pEnd)
+				return false;
+
+			uint8_t nToken = *pSrc++;
+
+			size_t nLit = nToken >> 4;
+			if ((0xf == nLit) && !ReadLen(nLit, pSrc, pEnd))
+				return false;
+
+			if ((nLit > static_cast<size_t>(pEnd - pSrc)) || (nLit > nDst - iPos))
+				return false;
+
+			if (nLit)
+				memcpy(pDst + iPos, pSrc, nLit);
+			pSrc += nLit;
+			iPos += nLit;
+
+			if (pSrc == pEnd)
+				break; // last sequence
+
+			if (pEnd - pSrc < 2)
+				return false;
+
+			size_t nOffset = pSrc[0] | (size_t(pSrc[1]) << 8);
+			pSrc += 2;
+
+			size_t nLen = nToken & 0xf;
+			if ((0xf == nLen) && !ReadLen(nLen, pSrc, pEnd))
+				return false;
+			nLen += s_MinMatch;
+
+			if (!nOffset || (nOffset > iPos) || (nLen > nDst - iPos))
+				return false;
+
+			// may overlap, copy forward
+			const uint8_t* pRef = pDst + iPos - nOffset;
+			for (size_t i = 0; i < nLen; i++)
+				pDst[iPos + i] = pRef[i];
+
+			iPos += nLen;
+		}
+
+		return iPos == nDst;
+	}
+
+} // namespace beam
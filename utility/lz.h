@@ -0,0 +1,39 @@
+// Copyright 2018-2020 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+namespace beam
+{
+	// Fast LZ77-class codec (byte-oriented, LZ4-like sequences, 64K window). Self-contained, not compatible with other formats.
+	struct Lz
+	{
+		static const uint32_t s_MinMatch = 4;
+
+		static size_t get_MaxCompressed(size_t nSize);
+
+		// pDst must have at least get_MaxCompressed(nSize) bytes. Returns the compressed size
+		static size_t Compress(uint8_t* pDst, const uint8_t* pSrc, size_t nSize);
+
+		// The decompressed size must be known. Returns false if the data is malformed, or doesn't decompress into exactly nDst bytes
+		static bool Decompress(uint8_t* pDst, size_t nDst, const uint8_t* pSrc, size_t nSrc);
+
+	private:
+		static uint8_t* WriteLen(uint8_t* p, size_t n);
+		static bool ReadLen(size_t& n, const uint8_t*& p, const uint8_t* pEnd);
+	};
+
+} // namespace beam
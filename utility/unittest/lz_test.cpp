@@ -0,0 +1,95 @@
+// Copyright 2018-2020 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/lz.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <assert.h>
+
+using namespace beam;
+using namespace std;
+
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+size_t round_trip(const vector<uint8_t>& src) {
+    vector<uint8_t> packed(Lz::get_MaxCompressed(src.size()));
+    size_t n = Lz::Compress(packed.data(), src.data(), src.size());
+    CHECK(n <= packed.size());
+
+    vector<uint8_t> res(src.size());
+    CHECK(Lz::Decompress(res.data(), res.size(), packed.data(), n));
+    CHECK(res == src);
+
+    // wrong expected size must be rejected
+    res.resize(src.size() + 1);
+    CHECK(!Lz::Decompress(res.data(), res.size(), packed.data(), n));
+
+    // truncated input must be rejected (and must not overrun)
+    if (n > 1) {
+        res.resize(src.size());
+        CHECK(!Lz::Decompress(res.data(), res.size(), packed.data(), n - 1));
+    }
+
+    return n;
+}
+
+void lz_test() {
+    mt19937 rng(7);
+    vector<uint8_t> v;
+
+    round_trip(v);
+
+    for (size_t len : { 1, 3, 4, 15, 16, 270, 5000, 100000 }) {
+        // random - incompressible
+        v.resize(len);
+        for (auto& x : v) x = uint8_t(rng());
+        size_t n = round_trip(v);
+        CHECK(n <= Lz::get_MaxCompressed(len));
+
+        // repeated pattern, long overlapping matches
+        for (size_t i = 0; i < len; i++) v[i] = uint8_t(i % 7);
+        n = round_trip(v);
+        if (len >= 5000) CHECK(n * 20 < len);
+
+        // mostly zeroes with sparse noise, similar to the serialized block data
+        for (auto& x : v) x = (rng() % 8) ? 0 : uint8_t(rng());
+        round_trip(v);
+    }
+
+    // random garbage on input must not crash
+    v.resize(300);
+    vector<uint8_t> res(1000);
+    for (int i = 0; i < 1000; i++) {
+        for (auto& x : v) x = uint8_t(rng());
+        Lz::Decompress(res.data(), res.size(), v.data(), 1 + rng() % v.size());
+    }
+}
+
+int main() {
+    lz_test();
+    if (error_count) {
+        cout << "lz_test: " << error_count << " errors" << endl;
+        return 1;
+    }
+    return 0;
+}
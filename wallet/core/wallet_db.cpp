@@ -2811,6 +2811,11 @@ namespace beam::wallet
         MyParser p(*this, gateway, prog);
         p.Init(get_OwnerKdf());
 
+#ifndef __EMSCRIPTEN__
+        ExecutorMT_R exec;
+        Executor::Scope scope(exec); // the utxo tree is verified in parallel
+#endif // __EMSCRIPTEN__
+
         if (p.Proceed(path.c_str()))
         {
             storage::setTreasuryHandled(*this, true);